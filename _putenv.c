@@ -1,99 +1,142 @@
 #include "hsh.h"
 
-/* Global variables to track allocations */
-static char **allocated_vars = ((void *)0);
-static int alloc_count = 0;
+/*
+ * The shell's own copy of environ, grown geometrically, and for each
+ * entry whether the shell allocated its string. Strings inherited at
+ * startup belong to the process image and are never freed.
+ */
 static char **old_environ = ((void *)0);
+static unsigned char *owned = ((void *)0);
+static size_t environ_cap = 0;
+
+/**
+ * environ_own - Make sure environ is the shell's copy, with room to add
+ * @count: Number of entries in environ
+ * @extra: Number of entries about to be added
+ *
+ * Return: 0 on success, -1 on failure
+ */
+static int environ_own(size_t count, size_t extra)
+{
+	extern char **environ;
+	char **new_environ;
+	unsigned char *new_owned;
+	size_t cap = (count + extra + 1) * 2;
+
+	if (environ == old_environ && count + extra + 1 <= environ_cap)
+		return (0);
+	new_environ = pool_alloc(sizeof(char *) * cap);
+	new_owned = pool_alloc(cap);
+	if (!new_environ || !new_owned)
+	{
+		pool_free(new_environ);
+		pool_free(new_owned);
+		return (-1);
+	}
+	memcpy(new_environ, environ, sizeof(char *) * (count + 1));
+	memset(new_owned, 0, cap);
+	if (environ == old_environ && owned)
+		memcpy(new_owned, owned, count);
+	pool_free(old_environ);
+	pool_free(owned);
+	old_environ = new_environ;
+	owned = new_owned;
+	environ_cap = cap;
+	environ = new_environ;
+	return (0);
+}
+
+/**
+ * environ_find - Find a variable in environ
+ * @name: Name of the variable
+ * @name_len: Length of the name
+ * @count: Set to the number of entries in environ
+ *
+ * Return: Index of the variable, or -1 if it is not set
+ */
+static long environ_find(const char *name, size_t name_len, size_t *count)
+{
+	extern char **environ;
+	long found = -1;
+	size_t i;
+
+	for (i = 0; environ[i]; i++)
+		if (found == -1 && _strncmp(environ[i], name, name_len) == 0 &&
+			environ[i][name_len] == '=')
+			found = i;
+	*count = i;
+	return (found);
+}
 
 /**
  * _putenv - Set or update an environment variable
  * @string: Name of the environment variable.
  *
+ * The string a replaced entry held is freed at once when the shell
+ * allocated it, so updating a variable in a loop uses constant memory.
+ *
  * Return: 0 on success, -1 on failure
  */
 int _putenv(char *string)
 {
 	extern char **environ;
-	int i, j;
-	char *new_var, *name, *value;
-	size_t name_len;
-
-	/* Use custom tokenization instead of strtok */
-	name = string;
-	value = NULL;
-	for (i = 0; string[i] != '\0'; i++)
-	{
-		if (string[i] == '=')
-		{
-			string[i] = '\0'; /* Temporarily replace '=' with null terminator */
-			value = &string[i + 1];
-			break;
-		}
-	}
+	char *new_var, *eq;
+	size_t name_len, count;
+	long i;
 
-	if (!name || !value)
+	eq = _strchr(string, '=');
+	if (!eq)
 		return (-1);
-
-	name_len = _strlen(name);
+	name_len = eq - string;
 
 	/* Create the new environment variable string */
-	new_var = malloc(name_len + _strlen(value) + 2); /* +2 for '=' and null terminator */
+	new_var = pool_alloc(_strlen(string) + 1);
 	if (!new_var)
 		return (-1);
+	_strcpy(new_var, string);
 
-	_strcpy(new_var, name);
-	_strcat(new_var, "=");
-	_strcat(new_var, value);
-
-	/* Restore the '=' in the original string */
-	if (value)
-		string[i] = '=';
-
-	/* Track this new allocation */
-	char **temp = _realloc(allocated_vars, sizeof(char *) * (alloc_count + 1));
-	if (!temp)
+	i = environ_find(string, name_len, &count);
+	if (environ_own(count, i == -1) == -1)
 	{
-		free(new_var);
+		pool_free(new_var);
 		return (-1);
 	}
-	allocated_vars = temp;
-	allocated_vars[alloc_count++] = new_var;
-
-	/* Look for an existing variable with this name */
-	for (i = 0; environ[i]; i++)
-	{
-		if (_strncmp(environ[i], name, name_len) == 0 && environ[i][name_len] == '=')
-		{
-			/* Found it, replace it */
-			environ[i] = new_var;
-			return (0);
-		}
-	}
-
-	/* Variable not found, add it to the end */
-	/* First, make a copy of the environment */
-	char **new_environ = malloc((i + 2) * sizeof(char *));
-	if (!new_environ)
+	if (i == -1)
 	{
-		free(new_var);
-		return (-1);
+		/* Variable not found, add it to the end */
+		i = count;
+		environ[i + 1] = NULL;
 	}
+	else if (owned[i])
+		pool_free(environ[i]);
+	environ[i] = new_var;
+	owned[i] = 1;
+	return (0);
+}
 
-	/* Copy existing environment */
-	for (j = 0; j < i; j++)
-		new_environ[j] = environ[j];
-
-	/* Add new variable and NULL terminator */
-	new_environ[i] = new_var;
-	new_environ[i + 1] = NULL;
-
-	/* Keep track of this environment allocation */
-	if (old_environ != NULL && old_environ != environ)
-		free(old_environ);
+/**
+ * _unsetenv - Remove an environment variable
+ * @name: Name of the variable
+ *
+ * Return: 0 on success, even when the variable is not set, -1 on failure
+ */
+int _unsetenv(const char *name)
+{
+	extern char **environ;
+	size_t count;
+	long i;
 
-	old_environ = new_environ;
-	environ = new_environ;
+	i = environ_find(name, _strlen(name), &count);
+	if (i == -1)
+		return (0);
+	if (environ_own(count, 0) == -1)
+		return (-1);
+	if (owned[i])
+		pool_free(environ[i]);
 
+	/* Shift all the subsequent environment variables up */
+	memmove(environ + i, environ + i + 1, sizeof(char *) * (count - i));
+	memmove(owned + i, owned + i + 1, count - i);
 	return (0);
 }
 
@@ -103,25 +146,19 @@ int _putenv(char *string)
  */
 void cleanup_environment(void)
 {
-	int i;
+	extern char **environ;
+	size_t i;
 
-	/* Free all allocated environment variable strings */
-	if (allocated_vars)
-	{
-		for (i = 0; i < alloc_count; i++)
-		{
-			if (allocated_vars[i])
-				free(allocated_vars[i]);
-		}
-		free(allocated_vars);
-		allocated_vars = NULL;
-		alloc_count = 0;
-	}
+	if (environ != old_environ)
+		return;
 
-	/* Free the environment array itself if we allocated it */
-	if (old_environ != NULL)
-	{
-		free(old_environ);
-		old_environ = NULL;
-	}
+	/* Free the strings the shell allocated, then the array itself */
+	for (i = 0; environ[i]; i++)
+		if (owned[i])
+			pool_free(environ[i]);
+	pool_free(old_environ);
+	pool_free(owned);
+	old_environ = NULL;
+	owned = NULL;
+	environ_cap = 0;
 }
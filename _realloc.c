@@ -1,44 +1,40 @@
 #include "hsh.h"
 
 /**
- * _realloc - Reallocates a memory block using malloc and free
- * @ptr: Pointer to the memory previously allocated
- * @size: New size of memory block in bytes
+ * _realloc - Resize a pool block
+ * @ptr: Block from pool_alloc, or NULL
+ * @size: New size of the block in bytes
  *
- * Return: Pointer to the newly allocated memory, or NULL on failure
+ * The block grows in place while its size class has room; otherwise its
+ * content, as long as the size it records, is copied to a new block.
+ *
+ * Return: Pointer to the resized block, or NULL on failure
  */
 void *_realloc(void *ptr, size_t size)
 {
 	void *new_ptr;
-	char *src, *dest;
-	size_t i;
+	size_t old_size;
 
-	/* If ptr is NULL, equivalent to malloc */
+	/* If ptr is NULL, equivalent to pool_alloc */
 	if (ptr == NULL)
-		return (malloc(size));
+		return (pool_alloc(size));
 
-	/* If size is 0 and ptr is not NULL, equivalent to free */
+	/* If size is 0 and ptr is not NULL, equivalent to pool_free */
 	if (size == 0)
 	{
-		free(ptr);
+		pool_free(ptr);
 		return (NULL);
 	}
 
-	/* Allocate new memory block */
-	new_ptr = malloc(size);
+	new_ptr = pool_resize(ptr, size);
+	if (new_ptr)
+		return (new_ptr);
+
+	new_ptr = pool_alloc(size);
 	if (new_ptr == NULL)
 		return (NULL);
-
-	/* Copy data from old block to new block */
-	src = (char *)ptr;
-	dest = (char *)new_ptr;
-
-	/* Copy byte by byte to avoid buffer overrun */
-	for (i = 0; i < size && src[i] != '\0'; i++)
-		dest[i] = src[i];
-
-	/* Free old block */
-	free(ptr);
-
+	old_size = pool_size(ptr);
+	memcpy(new_ptr, ptr, old_size < size ? old_size : size);
+	pool_free(ptr);
 	return (new_ptr);
 }
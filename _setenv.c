@@ -5,6 +5,8 @@
  * @name: Name of the environment variable.
  * @value: Value to set for the environment variable
  *
+ * Setting PATH drops the executable index so it is rebuilt on next use.
+ *
  * Return: 0 on success, -1 on failure
  */
 int _setenv(const char *name, const char *value)
@@ -30,5 +32,7 @@ int _setenv(const char *name, const char *value)
 		perror("_setenv");
 		return (-1);
 	}
+	if (_strcmp(name, "PATH") == 0)
+		path_index_invalidate();
 	return (0);
 }
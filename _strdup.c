@@ -9,20 +9,16 @@
 char *_strdup(char *str)
 {
 	char *dup;
-	unsigned int i, len = 0;
+	size_t len;
 
 	if (str == NULL)
 		return (NULL);
 
-	while (str[len])
-		len++;
-
-	dup = malloc(sizeof(char) * (len + 1));
+	len = _strlen(str) + 1;
+	dup = malloc(len);
 	if (dup == NULL)
 		return (NULL);
 
-	for (i = 0; i <= len; i++)
-		dup[i] = str[i];
-
+	memcpy(dup, str, len);
 	return (dup);
 }
@@ -22,14 +22,24 @@ static int _isdigit(int c)
  * _strtol - Convert a string to a long integer
  * @str: The string to convert
  * @endptr: Pointer to the end of the converted string
- * @base: The base to use for conversion
+ * @base: The base to use for conversion, 0 to detect 0x and 0 prefixes
+ *
+ * Like strtol, a value out of range is clamped to LONG_MIN or LONG_MAX
+ * and errno is set to ERANGE; all its digits are still consumed. When no
+ * digit is found, endptr is set to str.
+ *
+ * Example:
+ *   _strtol("42abc", &end, 10)                - 42, end on "abc"
+ *   _strtol("0x1f", &end, 0)                  - 31
+ *   _strtol("99999999999999999999", &end, 10) - LONG_MAX, errno ERANGE
  *
  * Return: The converted long integer
  */
 long _strtol(const char *str, char **endptr, int base)
 {
-	long result = 0;
-	int sign = 1;
+	const char *start = str, *digits;
+	unsigned long result = 0, limit;
+	int sign = 1, overflow = 0, digit;
 
 	while (_isspace((unsigned char)*str))
 		str++;
@@ -41,35 +51,34 @@ long _strtol(const char *str, char **endptr, int base)
 		str++;
 	}
 
-	if (base == 0)
+	if ((base == 0 || base == 16) && str[0] == '0' &&
+		(str[1] == 'x' || str[1] == 'X') && _isdigit(str[2]) >= 0 &&
+		_isdigit(str[2]) < 16)
 	{
-		if (*str == '0')
-		{
-			if (*(str + 1) == 'x' || *(str + 1) == 'X')
-			{
-				base = 16;
-				str += 2;
-			}
-			else
-				base = 8;
-		}
-		else
-			base = 10;
+		base = 16;
+		str += 2;
 	}
+	else if (base == 0)
+		base = *str == '0' ? 8 : 10;
 
-	while (*str)
+	/* The magnitude of LONG_MIN is one more than LONG_MAX */
+	limit = sign < 0 ? (unsigned long)LONG_MAX + 1 : (unsigned long)LONG_MAX;
+	for (digits = str; (digit = _isdigit(*str)) >= 0 && digit < base; str++)
 	{
-		int digit = _isdigit(*str);
-
-		if (digit < 0 || digit >= base)
-			break;
-
-		result = result * base + digit;
-		str++;
+		if (overflow || result > (limit - digit) / base)
+			overflow = 1;
+		else
+			result = result * base + digit;
 	}
 
 	if (endptr)
-		*endptr = (char *)str;
-
-	return (result * sign);
+		*endptr = (char *)(str == digits ? start : str);
+	if (overflow)
+	{
+		errno = ERANGE;
+		return (sign < 0 ? LONG_MIN : LONG_MAX);
+	}
+	if (sign < 0)
+		return (result == (unsigned long)LONG_MAX + 1 ? LONG_MIN : -(long)result);
+	return ((long)result);
 }
@@ -0,0 +1,219 @@
+#include "hsh.h"
+
+#define POOL_CLASSES 8
+#define POOL_MIN 16
+#define POOL_CACHE_MAX 128
+
+/**
+ * union pool_header_u - Header in front of every pool block
+ * @b: The header fields
+ * @b.size: Size asked for
+ * @b.cls: Size class, POOL_CLASSES for a block too large for any
+ * @align: Keeps the data after the header aligned for any type
+ */
+typedef union pool_header_u
+{
+	struct
+	{
+		size_t	size;
+		size_t	cls;
+	} b;
+	long double	align;
+} pool_header_t;
+
+/**
+ * struct pool_free_s - Free block waiting in the list of its class
+ * @next: Next free block of the class
+ */
+typedef struct pool_free_s
+{
+	struct pool_free_s	*next;
+} pool_free_t;
+
+/**
+ * struct pool_stats_s - Counters of a size class
+ * @allocs: Blocks handed out
+ * @reused: Blocks handed out from the free list
+ * @in_use: Blocks not freed yet
+ * @cached: Blocks in the free list
+ */
+typedef struct pool_stats_s
+{
+	unsigned long	allocs;
+	unsigned long	reused;
+	unsigned long	in_use;
+	unsigned long	cached;
+} pool_stats_t;
+
+static pool_free_t *free_lists[POOL_CLASSES];
+static pool_stats_t stats[POOL_CLASSES + 1];
+static size_t bytes_in_use;
+
+/**
+ * pool_class - Get the size class of a size
+ * @size: The size
+ *
+ * Return: The class, POOL_CLASSES if the size is larger than all of them
+ */
+static size_t pool_class(size_t size)
+{
+	size_t cls = 0, cap = POOL_MIN;
+
+	while (cap < size && cls < POOL_CLASSES)
+	{
+		cap <<= 1;
+		cls++;
+	}
+	return (cls);
+}
+
+/**
+ * pool_alloc - Allocate a block from the pool
+ * @size: Size of the block
+ *
+ * Blocks up to 2 KiB are rounded up to a power of two and recycled
+ * through a free list per size; larger ones come straight from malloc.
+ * Every block records its size, so _realloc knows how much to copy and
+ * when the block can grow in place.
+ *
+ * Return: The block, to be freed with pool_free, or NULL on failure
+ */
+void *pool_alloc(size_t size)
+{
+	size_t cls = pool_class(size);
+	pool_header_t *h;
+
+	if (cls < POOL_CLASSES && free_lists[cls])
+	{
+		h = (pool_header_t *)free_lists[cls];
+		free_lists[cls] = free_lists[cls]->next;
+		stats[cls].cached--;
+		stats[cls].reused++;
+	}
+	else
+	{
+		h = malloc(sizeof(pool_header_t) +
+			(cls < POOL_CLASSES ? (size_t)POOL_MIN << cls : size));
+		if (!h)
+			return (NULL);
+	}
+	h->b.size = size;
+	h->b.cls = cls;
+	stats[cls].allocs++;
+	stats[cls].in_use++;
+	bytes_in_use += size;
+	return (h + 1);
+}
+
+/**
+ * pool_free - Give a block back to the pool
+ * @ptr: The block, from pool_alloc, may be NULL
+ */
+void pool_free(void *ptr)
+{
+	pool_header_t *h;
+	pool_free_t *f;
+	size_t cls;
+
+	if (!ptr)
+		return;
+	h = (pool_header_t *)ptr - 1;
+	cls = h->b.cls;
+	stats[cls].in_use--;
+	bytes_in_use -= h->b.size;
+	if (cls == POOL_CLASSES || stats[cls].cached >= POOL_CACHE_MAX)
+	{
+		free(h);
+		return;
+	}
+	f = (pool_free_t *)h;
+	f->next = free_lists[cls];
+	free_lists[cls] = f;
+	stats[cls].cached++;
+}
+
+/**
+ * pool_size - Get the size a block was asked with
+ * @ptr: The block, from pool_alloc
+ *
+ * Return: The size
+ */
+size_t pool_size(const void *ptr)
+{
+	return (((const pool_header_t *)ptr - 1)->b.size);
+}
+
+/**
+ * pool_resize - Resize a block without moving its content elsewhere
+ * @ptr: The block, from pool_alloc
+ * @size: New size
+ *
+ * A small block keeps its place while the new size fits its class; a
+ * large block that stays large is handed to realloc, which may extend it.
+ *
+ * Return: The block, possibly moved by realloc, or NULL when the caller
+ * must allocate a new block and copy
+ */
+void *pool_resize(void *ptr, size_t size)
+{
+	pool_header_t *h = (pool_header_t *)ptr - 1;
+	size_t cls = h->b.cls;
+
+	if (cls < POOL_CLASSES && size > (size_t)POOL_MIN << cls)
+		return (NULL);
+	if (cls == POOL_CLASSES && size > h->b.size &&
+		pool_class(size) == POOL_CLASSES)
+	{
+		h = realloc(h, sizeof(pool_header_t) + size);
+		if (!h)
+			return (NULL);
+	}
+	else if (cls == POOL_CLASSES && size > h->b.size)
+		return (NULL);
+	bytes_in_use += size - h->b.size;
+	h->b.size = size;
+	return (h + 1);
+}
+
+/**
+ * pool_release - Free the blocks waiting in the free lists
+ */
+void pool_release(void)
+{
+	pool_free_t *f;
+	int i;
+
+	for (i = 0; i < POOL_CLASSES; i++)
+	{
+		while ((f = free_lists[i]) != NULL)
+		{
+			free_lists[i] = f->next;
+			free(f);
+		}
+		stats[i].cached = 0;
+	}
+}
+
+/**
+ * pool_report - Print the counters of the pool
+ *
+ * Example:
+ *   class  allocs  reused  in use  cached
+ *      16      42      30       5       7
+ *   large       1       0       1       -
+ *   bytes in use: 4731
+ */
+void pool_report(void)
+{
+	int i;
+
+	out_printf(STDOUT_FILENO, "class  allocs  reused  in use  cached\n");
+	for (i = 0; i < POOL_CLASSES; i++)
+		out_printf(STDOUT_FILENO, "%5d %7lu %7lu %7lu %7lu\n", POOL_MIN << i,
+			stats[i].allocs, stats[i].reused, stats[i].in_use, stats[i].cached);
+	out_printf(STDOUT_FILENO, "large %7lu %7lu %7lu       -\n",
+		stats[POOL_CLASSES].allocs, stats[POOL_CLASSES].reused,
+		stats[POOL_CLASSES].in_use);
+	out_printf(STDOUT_FILENO, "bytes in use: %lu\n",
+		(unsigned long)bytes_in_use);
+}
@@ -0,0 +1,429 @@
+#include "hsh.h"
+
+/**
+ * struct arith_s - State of an arithmetic expression being evaluated
+ * @s: Next character of the expression
+ * @noeval: Set inside a branch that is parsed but not evaluated
+ * @error: Message of the first error, or NULL
+ */
+typedef struct arith_s
+{
+	const char	*s;
+	int			noeval;
+	const char	*error;
+} arith_t;
+
+/**
+ * enum arith_op_e - Binary operators, by increasing precedence level
+ * @OP_NONE: Not a binary operator
+ * @OP_OR: ||
+ * @OP_AND: &&
+ * @OP_BOR: |
+ * @OP_XOR: ^
+ * @OP_BAND: &
+ * @OP_EQ: ==
+ * @OP_NE: !=
+ * @OP_LT: <
+ * @OP_LE: <=
+ * @OP_GT: >
+ * @OP_GE: >=
+ * @OP_SHL: <<
+ * @OP_SHR: >>
+ * @OP_ADD: +
+ * @OP_SUB: -
+ * @OP_MUL: *
+ * @OP_DIV: /
+ * @OP_MOD: %
+ */
+typedef enum arith_op_e
+{
+	OP_NONE,
+	OP_OR,
+	OP_AND,
+	OP_BOR,
+	OP_XOR,
+	OP_BAND,
+	OP_EQ,
+	OP_NE,
+	OP_LT,
+	OP_LE,
+	OP_GT,
+	OP_GE,
+	OP_SHL,
+	OP_SHR,
+	OP_ADD,
+	OP_SUB,
+	OP_MUL,
+	OP_DIV,
+	OP_MOD
+} arith_op_t;
+
+/**
+ * struct arith_binop_s - Spelling and precedence of a binary operator
+ * @str: The operator
+ * @len: Length of the operator
+ * @op: The operator
+ * @prec: Precedence, higher binds tighter
+ */
+typedef struct arith_binop_s
+{
+	const char	*str;
+	int			len;
+	arith_op_t	op;
+	int			prec;
+} arith_binop_t;
+
+/* Longer operators first, so "<<" is not read as "<" */
+static const arith_binop_t binops[] = {
+	{"||", 2, OP_OR, 1}, {"&&", 2, OP_AND, 2},
+	{"==", 2, OP_EQ, 6}, {"!=", 2, OP_NE, 6},
+	{"<=", 2, OP_LE, 7}, {">=", 2, OP_GE, 7},
+	{"<<", 2, OP_SHL, 8}, {">>", 2, OP_SHR, 8},
+	{"|", 1, OP_BOR, 3}, {"^", 1, OP_XOR, 4}, {"&", 1, OP_BAND, 5},
+	{"<", 1, OP_LT, 7}, {">", 1, OP_GT, 7},
+	{"+", 1, OP_ADD, 9}, {"-", 1, OP_SUB, 9},
+	{"*", 1, OP_MUL, 10}, {"/", 1, OP_DIV, 10}, {"%", 1, OP_MOD, 10},
+	{NULL, 0, OP_NONE, 0}
+};
+
+static long arith_assign(arith_t *a);
+
+/**
+ * arith_fail - Record an error
+ * @a: The expression
+ * @msg: Message of the error
+ *
+ * Return: Always 0
+ */
+static long arith_fail(arith_t *a, const char *msg)
+{
+	if (!a->error)
+		a->error = msg;
+	return (0);
+}
+
+/**
+ * arith_skip - Move past blanks
+ * @a: The expression
+ */
+static void arith_skip(arith_t *a)
+{
+	while (*a->s == ' ' || *a->s == '\t' || *a->s == '\n')
+		a->s++;
+}
+
+/**
+ * arith_compound - Tell whether an operator has an assignment form
+ * @op: The operator
+ *
+ * Return: 1 if op= assigns, 0 otherwise
+ */
+static int arith_compound(arith_op_t op)
+{
+	return (op == OP_BOR || op == OP_XOR || op == OP_BAND || op >= OP_SHL);
+}
+
+/**
+ * arith_binop - Find the binary operator at the current position
+ * @a: The expression
+ *
+ * An operator followed by '=' is an assignment, not a binary operator,
+ * unless it is a comparison.
+ *
+ * Return: The operator, or the OP_NONE entry
+ */
+static const arith_binop_t *arith_binop(arith_t *a)
+{
+	const arith_binop_t *b;
+
+	arith_skip(a);
+	for (b = binops; b->str; b++)
+		if (_strncmp(a->s, b->str, b->len) == 0)
+			break;
+	if (b->str && a->s[b->len] == '=' && arith_compound(b->op))
+		return (&binops[sizeof(binops) / sizeof(binops[0]) - 1]);
+	return (b);
+}
+
+/**
+ * arith_number - Parse an integer constant
+ * @a: The expression
+ * @s: Start of the constant
+ * @end: Set to the first character after the constant
+ *
+ * Return: The value
+ */
+static long arith_number(arith_t *a, const char *s, const char **end)
+{
+	char *e;
+	long n;
+
+	errno = 0;
+	n = _strtol(s, &e, 0);
+	if (errno == ERANGE)
+		arith_fail(a, "number out of range");
+	if (e == s || (*e >= '0' && *e <= '9') || var_name_length(e))
+		arith_fail(a, "invalid number");
+	*end = e;
+	return (n);
+}
+
+/**
+ * arith_variable - Get the value of a variable
+ * @a: The expression
+ * @name: Name of the variable
+ * @len: Length of the name
+ *
+ * Return: The value, 0 if the variable is unset or empty
+ */
+static long arith_variable(arith_t *a, const char *name, size_t len)
+{
+	const char *value = var_lookup(name, len), *end;
+	long n;
+
+	if (!value)
+		return (0);
+	while (*value == ' ' || *value == '\t')
+		value++;
+	if (!*value)
+		return (0);
+	n = arith_number(a, value, &end);
+	while (*end == ' ' || *end == '\t')
+		end++;
+	if (*end)
+		arith_fail(a, "invalid number");
+	return (n);
+}
+
+/**
+ * arith_apply - Apply a binary operator
+ * @a: The expression
+ * @op: The operator
+ * @x: Left operand
+ * @y: Right operand
+ *
+ * Additions, subtractions, products and shifts wrap around on 64 bits
+ * instead of overflowing.
+ *
+ * Return: The result
+ */
+static long arith_apply(arith_t *a, arith_op_t op, long x, long y)
+{
+	switch (op)
+	{
+	case OP_OR: return (x || y);
+	case OP_AND: return (x && y);
+	case OP_BOR: return (x | y);
+	case OP_XOR: return (x ^ y);
+	case OP_BAND: return (x & y);
+	case OP_EQ: return (x == y);
+	case OP_NE: return (x != y);
+	case OP_LT: return (x < y);
+	case OP_LE: return (x <= y);
+	case OP_GT: return (x > y);
+	case OP_GE: return (x >= y);
+	case OP_SHL: return ((long)((unsigned long)x << (y & 63)));
+	case OP_SHR: return (x >> (y & 63));
+	case OP_ADD: return ((long)((unsigned long)x + (unsigned long)y));
+	case OP_SUB: return ((long)((unsigned long)x - (unsigned long)y));
+	case OP_MUL: return ((long)((unsigned long)x * (unsigned long)y));
+	case OP_DIV:
+	case OP_MOD:
+		if (a->noeval)
+			return (0);
+		if (y == 0)
+			return (arith_fail(a, "division by zero"));
+		if (y == -1)
+			return (op == OP_DIV ? (long)(0 - (unsigned long)x) : 0);
+		return (op == OP_DIV ? x / y : x % y);
+	default:
+		return (0);
+	}
+}
+
+/**
+ * arith_unary - Parse and evaluate a unary expression or a primary
+ * @a: The expression
+ *
+ * Return: The value
+ */
+static long arith_unary(arith_t *a)
+{
+	const char *end;
+	size_t len;
+	long n;
+	char c;
+
+	arith_skip(a);
+	c = *a->s;
+	if (c == '+' || c == '-' || c == '!' || c == '~')
+	{
+		a->s++;
+		n = arith_unary(a);
+		if (c == '-')
+			return ((long)(0 - (unsigned long)n));
+		return (c == '!' ? !n : c == '~' ? ~n : n);
+	}
+	if (c == '(')
+	{
+		a->s++;
+		n = arith_assign(a);
+		arith_skip(a);
+		if (*a->s != ')')
+			return (arith_fail(a, "expecting ')'"));
+		a->s++;
+		return (n);
+	}
+	if (c >= '0' && c <= '9')
+	{
+		n = arith_number(a, a->s, &end);
+		a->s = end;
+		return (n);
+	}
+	len = var_name_length(a->s);
+	if (!len)
+		return (arith_fail(a, "expecting primary"));
+	n = arith_variable(a, a->s, len);
+	a->s += len;
+	return (n);
+}
+
+/**
+ * arith_binary - Parse and evaluate binary operators by precedence climbing
+ * @a: The expression
+ * @min_prec: Lowest precedence an operator may have to be consumed here
+ *
+ * The right operand of && or || is parsed without being evaluated when
+ * the left operand already decides the result.
+ *
+ * Return: The value
+ */
+static long arith_binary(arith_t *a, int min_prec)
+{
+	const arith_binop_t *b;
+	long x = arith_unary(a), y;
+	int noeval = a->noeval;
+
+	while (!a->error)
+	{
+		b = arith_binop(a);
+		if (!b->str || b->prec < min_prec)
+			break;
+		a->s += b->len;
+		if ((b->op == OP_AND && !x) || (b->op == OP_OR && x))
+			a->noeval = 1;
+		y = arith_binary(a, b->prec + 1);
+		a->noeval = noeval;
+		x = arith_apply(a, b->op, x, y);
+	}
+	return (x);
+}
+
+/**
+ * arith_cond - Parse and evaluate a conditional expression
+ * @a: The expression
+ *
+ * Return: The value
+ */
+static long arith_cond(arith_t *a)
+{
+	long c = arith_binary(a, 1), x, y;
+	int noeval = a->noeval;
+
+	arith_skip(a);
+	if (*a->s != '?' || a->error)
+		return (c);
+	a->s++;
+	a->noeval = noeval || !c;
+	x = arith_assign(a);
+	arith_skip(a);
+	if (*a->s != ':')
+		return (arith_fail(a, "expecting ':'"));
+	a->s++;
+	a->noeval = noeval || c;
+	y = arith_cond(a);
+	a->noeval = noeval;
+	return (c ? x : y);
+}
+
+/**
+ * arith_assign - Parse and evaluate an assignment or a conditional
+ * @a: The expression
+ *
+ * Return: The value
+ */
+static long arith_assign(arith_t *a)
+{
+	const arith_binop_t *b = NULL;
+	const char *name, *s;
+	char buf[256], num[24];
+	size_t len;
+	long x, y;
+
+	arith_skip(a);
+	name = a->s;
+	len = var_name_length(name);
+	for (s = name + len; *s == ' ' || *s == '\t'; s++)
+		;
+	if (!len || len >= sizeof(buf) || !*s)
+		return (arith_cond(a));
+	if (*s != '=')
+	{
+		for (b = binops; b->str; b++)
+			if (_strncmp(s, b->str, b->len) == 0 && s[b->len] == '=' &&
+				arith_compound(b->op))
+				break;
+		if (!b->str)
+			return (arith_cond(a));
+		s += b->len;
+	}
+	else if (s[1] == '=')
+		return (arith_cond(a));
+
+	a->s = s + 1;
+	y = arith_assign(a);
+	if (a->error || a->noeval)
+		return (y);
+	x = b ? arith_apply(a, b->op, arith_variable(a, name, len), y) : y;
+	if (a->error)
+		return (0);
+	memcpy(buf, name, len);
+	buf[len] = '\0';
+	snprintf(num, sizeof(num), "%ld", x);
+	if (var_set(buf, num) == -1)
+		return (arith_fail(a, "cannot assign"));
+	return (x);
+}
+
+/**
+ * arith_eval - Evaluate an arithmetic expression
+ * @expr: The expression, with its parameters already expanded
+ * @result: Set to the value of the expression
+ * @error: Set to a message when the expression is invalid
+ *
+ * Supports the POSIX integer operators with their C precedence, on 64-bit
+ * values: unary + - ! ~, * / %, + -, << >>, comparisons, & ^ |, && ||,
+ * ?: and the assignments = *= /= %= += -= <<= >>= &= ^= |=. Variables
+ * are read by name. Nothing is allocated but assigned values.
+ *
+ * Example:
+ *   arith_eval("i += 2 * (3 + 1)", &n, &err) - i and n are i + 8
+ *   arith_eval("1 / 0", &n, &err)            - -1, err is "division by zero"
+ *   arith_eval(" ", &n, &err)                - n is 0
+ *
+ * Return: 0 on success, -1 on error
+ */
+int arith_eval(const char *expr, long *result, const char **error)
+{
+	arith_t a = {NULL, 0, NULL};
+
+	a.s = expr;
+	arith_skip(&a);
+	/* An empty expression is 0, as $(( )) is in other shells */
+	*result = *a.s ? arith_assign(&a) : 0;
+	arith_skip(&a);
+	if (!a.error && *a.s)
+		arith_fail(&a, "expecting end of expression");
+	*error = a.error;
+	return (a.error ? -1 : 0);
+}
@@ -0,0 +1,469 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_RUNS 1000
+#define MAX_WORKLOADS 64
+#define LINE_MAX_LEN 4096
+
+/**
+ * struct workload_s - Script run under each shell
+ * @path: File of the workload
+ * @name: Name reported, the file name without directory and extension
+ * @script: Path of the script fed to the shells, generated when repeated
+ * @env: Number of extra environment variables, from "# env: N"
+ * @path_dirs: Number of missing directories put before PATH, "# path: N"
+ * @repeat: Times the body is repeated, from "# repeat: N"
+ */
+typedef struct workload_s
+{
+	const char	*path;
+	char		name[256];
+	char		script[PATH_MAX];
+	int			env;
+	int			path_dirs;
+	int			repeat;
+} workload_t;
+
+/**
+ * struct sample_s - Measures of one shell on one workload
+ * @wall: Wall-clock times, in milliseconds
+ * @user: User CPU times, in milliseconds
+ * @sys: System CPU times, in milliseconds
+ * @rss: Peak resident sizes, in KiB
+ * @runs: Number of runs
+ * @failed: Number of runs that did not exit with status 0
+ */
+typedef struct sample_s
+{
+	double	wall[MAX_RUNS];
+	double	user[MAX_RUNS];
+	double	sys[MAX_RUNS];
+	double	rss[MAX_RUNS];
+	int		runs;
+	int		failed;
+} sample_t;
+
+/**
+ * struct options_s - Command line of the runner
+ * @runs: Samples per shell and workload
+ * @threshold: Allowed slowdown against the baseline, in percent
+ * @baseline: File of medians to compare hsh against, or NULL
+ * @save: File to write the medians of hsh to, or NULL
+ * @hsh: The shell under test
+ * @sh: The reference shell
+ */
+typedef struct options_s
+{
+	int			runs;
+	double		threshold;
+	const char	*baseline;
+	const char	*save;
+	const char	*hsh;
+	const char	*sh;
+} options_t;
+
+/**
+ * compare_double - Compare two doubles, for qsort
+ * @a: Pointer to the first value
+ * @b: Pointer to the second value
+ *
+ * Return: Negative, zero or positive
+ */
+static int compare_double(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+
+	return ((x > y) - (x < y));
+}
+
+/**
+ * median - Median of values
+ * @v: The values, sorted in place
+ * @n: Number of values
+ *
+ * Return: The median
+ */
+static double median(double *v, int n)
+{
+	qsort(v, n, sizeof(double), compare_double);
+	return (n % 2 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2);
+}
+
+/**
+ * t_critical - Two-sided 95% critical value of Student's t distribution
+ * @df: Degrees of freedom, at least 1
+ *
+ * Past 30 degrees of freedom, the value of the nearest smaller row of the
+ * usual table is used, which keeps the interval on the wide side.
+ *
+ * Return: The critical value
+ */
+static double t_critical(int df)
+{
+	static const double t[] = {
+		12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262,
+		2.228, 2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101,
+		2.093, 2.086, 2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052,
+		2.048, 2.045, 2.042
+	};
+
+	if (df <= 30)
+		return (t[df - 1]);
+	if (df <= 40)
+		return (2.042);
+	if (df <= 60)
+		return (2.021);
+	if (df <= 120)
+		return (2.000);
+	return (1.980);
+}
+
+/**
+ * confidence - Half-width of the 95% confidence interval of the mean
+ * @v: The values
+ * @n: Number of values
+ *
+ * With a handful of runs the standard deviation is itself a rough
+ * estimate, so the interval uses Student's t with n - 1 degrees of
+ * freedom rather than the normal 1.96.
+ *
+ * Return: The half-width, 0 with fewer than two values
+ */
+static double confidence(const double *v, int n)
+{
+	double mean = 0, var = 0;
+	int i;
+
+	if (n < 2)
+		return (0);
+	for (i = 0; i < n; i++)
+		mean += v[i];
+	mean /= n;
+	for (i = 0; i < n; i++)
+		var += (v[i] - mean) * (v[i] - mean);
+	return (t_critical(n - 1) * sqrt(var / (n - 1)) / sqrt(n));
+}
+
+/**
+ * workload_load - Read the settings of a workload, generate its script
+ * @w: The workload, path set
+ *
+ * Settings are comment lines at the top of the file. With "# repeat: N"
+ * the rest of the file is written N times to a temporary script.
+ *
+ * Return: 0 on success, -1 on failure
+ */
+static int workload_load(workload_t *w)
+{
+	char line[LINE_MAX_LEN], *body = NULL, *base, *dot;
+	size_t len = 0, n;
+	FILE *f = fopen(w->path, "r");
+	int fd, i;
+
+	if (!f)
+		return (-1);
+	base = strrchr(w->path, '/');
+	snprintf(w->name, sizeof(w->name), "%s", base ? base + 1 : w->path);
+	dot = strrchr(w->name, '.');
+	if (dot)
+		*dot = '\0';
+	while (fgets(line, sizeof(line), f))
+	{
+		if (sscanf(line, "# env: %d", &w->env) == 1 ||
+			sscanf(line, "# path: %d", &w->path_dirs) == 1 ||
+			sscanf(line, "# repeat: %d", &w->repeat) == 1)
+			continue;
+		n = strlen(line);
+		body = realloc(body, len + n + 1);
+		if (!body)
+			return (-1);
+		memcpy(body + len, line, n + 1);
+		len += n;
+	}
+	fclose(f);
+	snprintf(w->script, sizeof(w->script), "%s", w->path);
+	if (w->repeat > 1 && body)
+	{
+		snprintf(w->script, sizeof(w->script), "/tmp/hsh-bench-XXXXXX");
+		fd = mkstemp(w->script);
+		for (i = 0; fd != -1 && i < w->repeat; i++)
+			if (write(fd, body, len) != (ssize_t)len)
+				break;
+		if (fd != -1)
+			close(fd);
+	}
+	free(body);
+	return (0);
+}
+
+/**
+ * workload_env - Build the environment of a workload
+ * @w: The workload
+ *
+ * Return: The environment, or NULL on failure
+ */
+static char **workload_env(workload_t *w)
+{
+	extern char **environ;
+	char **env, *path, *old = getenv("PATH");
+	int count = 0, i, j = 0;
+	size_t len;
+
+	while (environ[count])
+		count++;
+	env = calloc(count + w->env + 2, sizeof(char *));
+	len = (old ? strlen(old) : 0) + (size_t)w->path_dirs * 32 + 8;
+	path = malloc(len);
+	if (!env || !path)
+		return (NULL);
+	strcpy(path, "PATH=");
+	for (i = 0; i < w->path_dirs; i++)
+		sprintf(path + strlen(path), "/nonexistent/bench/%d:", i);
+	strcat(path, old ? old : "/bin:/usr/bin");
+	env[j++] = path;
+	for (i = 0; i < count; i++)
+		if (strncmp(environ[i], "PATH=", 5) != 0)
+			env[j++] = environ[i];
+	for (i = 0; i < w->env; i++)
+	{
+		env[j] = malloc(48);
+		if (!env[j])
+			return (NULL);
+		sprintf(env[j++], "BENCH_VAR_%d=value_of_variable_%d", i, i);
+	}
+	env[j] = NULL;
+	return (env);
+}
+
+/**
+ * run_once - Run a workload once under a shell
+ * @shell: Path of the shell
+ * @w: The workload
+ * @env: Environment of the run
+ * @s: Samples, one added
+ *
+ * The script is fed on standard input, and output is discarded.
+ */
+static void run_once(const char *shell, workload_t *w, char **env, sample_t *s)
+{
+	struct timespec t0, t1;
+	struct rusage ru;
+	int status = 1, in;
+	pid_t pid;
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	pid = fork();
+	if (pid == 0)
+	{
+		in = open(w->script, O_RDONLY);
+		if (in == -1)
+			_exit(127);
+		dup2(in, STDIN_FILENO);
+		close(in);
+		in = open("/dev/null", O_WRONLY);
+		dup2(in, STDOUT_FILENO);
+		execle(shell, shell, (char *)NULL, env);
+		_exit(127);
+	}
+	if (pid == -1 || wait4(pid, &status, 0, &ru) == -1)
+	{
+		s->failed++;
+		return;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+		s->failed++;
+	s->wall[s->runs] = (t1.tv_sec - t0.tv_sec) * 1e3 +
+		(t1.tv_nsec - t0.tv_nsec) / 1e6;
+	s->user[s->runs] = ru.ru_utime.tv_sec * 1e3 + ru.ru_utime.tv_usec / 1e3;
+	s->sys[s->runs] = ru.ru_stime.tv_sec * 1e3 + ru.ru_stime.tv_usec / 1e3;
+	s->rss[s->runs] = ru.ru_maxrss;
+	s->runs++;
+}
+
+/**
+ * measure - Sample a workload under a shell
+ * @shell: Path of the shell
+ * @w: The workload
+ * @env: Environment of the runs
+ * @runs: Number of samples
+ * @s: Samples, filled in
+ *
+ * One unmeasured run warms the caches first.
+ */
+static void measure(const char *shell, workload_t *w, char **env, int runs,
+	sample_t *s)
+{
+	int i;
+
+	memset(s, 0, sizeof(*s));
+	run_once(shell, w, env, s);
+	memset(s, 0, sizeof(*s));
+	for (i = 0; i < runs; i++)
+		run_once(shell, w, env, s);
+}
+
+/**
+ * report - Print the measures of one shell on one workload
+ * @w: The workload
+ * @label: Name of the shell
+ * @s: The samples
+ *
+ * Return: Median wall-clock time, in milliseconds
+ */
+static double report(workload_t *w, const char *label, sample_t *s)
+{
+	double ci = confidence(s->wall, s->runs), wall;
+
+	if (s->runs == 0)
+	{
+		printf("%-16s %-4s %10s\n", w->name, label, "failed");
+		return (0);
+	}
+	wall = median(s->wall, s->runs);
+	printf("%-16s %-4s %10.2f %8.2f %9.2f %9.2f %8.0f %6d\n", w->name, label,
+		wall, ci, median(s->user, s->runs), median(s->sys, s->runs),
+		median(s->rss, s->runs), s->failed);
+	return (wall);
+}
+
+/**
+ * baseline_lookup - Find the median of a workload in a baseline file
+ * @file: The baseline, lines of "name median"
+ * @name: Name of the workload
+ *
+ * Return: The median, or -1 if the workload is not in the file
+ */
+static double baseline_lookup(const char *file, const char *name)
+{
+	char line[LINE_MAX_LEN], found[256];
+	double value, result = -1;
+	FILE *f = fopen(file, "r");
+
+	if (!f)
+		return (-1);
+	while (fgets(line, sizeof(line), f))
+		if (sscanf(line, "%255s %lf", found, &value) == 2 &&
+			strcmp(found, name) == 0)
+			result = value;
+	fclose(f);
+	return (result);
+}
+
+/**
+ * parse_options - Read the command line
+ * @argc: Argument count
+ * @argv: Argument vector
+ * @o: Options, filled in
+ *
+ * Return: Index of the first workload, or -1 on a usage error
+ */
+static int parse_options(int argc, char **argv, options_t *o)
+{
+	int c;
+
+	o->runs = 10;
+	o->threshold = 10;
+	while ((c = getopt(argc, argv, "n:t:b:s:")) != -1)
+	{
+		if (c == 'n')
+			o->runs = atoi(optarg);
+		else if (c == 't')
+			o->threshold = atof(optarg);
+		else if (c == 'b')
+			o->baseline = optarg;
+		else if (c == 's')
+			o->save = optarg;
+		else
+			return (-1);
+	}
+	if (o->runs < 1 || o->runs > MAX_RUNS || argc - optind < 3)
+		return (-1);
+	o->hsh = argv[optind];
+	o->sh = argv[optind + 1];
+	return (optind + 2);
+}
+
+/**
+ * main - Run every workload under hsh and the reference shell
+ * @argc: Argument count
+ * @argv: Argument vector
+ *
+ * Prints, per workload and shell, the median wall-clock time with the
+ * 95% confidence interval of its mean, the median user and system CPU
+ * times, the peak RSS and the number of failed runs, then hsh/sh.
+ *
+ * Example:
+ *   bench -n 20 -b base.txt -t 5 ./hsh /bin/sh bench/workloads/fork_loop.sh
+ *
+ * Return: 0, 1 when hsh is slower than the baseline by more than the
+ * threshold on any workload, 2 on a usage error
+ */
+int main(int argc, char **argv)
+{
+	static sample_t s;
+	options_t o = {0, 0, NULL, NULL, NULL, NULL};
+	workload_t w;
+	double hsh_ms, sh_ms, base;
+	FILE *save = NULL;
+	char **env;
+	int i, first, regressions = 0;
+
+	first = parse_options(argc, argv, &o);
+	if (first == -1)
+	{
+		fprintf(stderr, "usage: %s [-n runs] [-t percent] [-b baseline] "
+			"[-s save] hsh sh workload...\n", argv[0]);
+		return (2);
+	}
+	if (o.save)
+		save = fopen(o.save, "w");
+	printf("%-16s %-4s %10s %8s %9s %9s %8s %6s\n", "workload", "run",
+		"wall ms", "+/- ms", "user ms", "sys ms", "rss KiB", "failed");
+	for (i = first; i < argc && i - first < MAX_WORKLOADS; i++)
+	{
+		memset(&w, 0, sizeof(w));
+		w.path = argv[i];
+		if (workload_load(&w) == -1 || !(env = workload_env(&w)))
+		{
+			fprintf(stderr, "%s: cannot load %s\n", argv[0], argv[i]);
+			return (2);
+		}
+		measure(o.hsh, &w, env, o.runs, &s);
+		hsh_ms = report(&w, "hsh", &s);
+		measure(o.sh, &w, env, o.runs, &s);
+		sh_ms = report(&w, "sh", &s);
+		printf("%-16s hsh/sh %.2f\n", w.name, sh_ms > 0 ? hsh_ms / sh_ms : 0);
+		if (save)
+			fprintf(save, "%s %.3f\n", w.name, hsh_ms);
+		base = o.baseline ? baseline_lookup(o.baseline, w.name) : -1;
+		if (base > 0 && hsh_ms > base * (1 + o.threshold / 100))
+		{
+			printf("%-16s REGRESSION %.2f ms against %.2f ms (+%.1f%%)\n",
+				w.name, hsh_ms, base, (hsh_ms / base - 1) * 100);
+			regressions++;
+		}
+		if (w.repeat > 1)
+			unlink(w.script);
+	}
+	if (save)
+		fclose(save);
+	fflush(stdout);
+	if (!o.baseline)
+		fprintf(stderr, "%s: no baseline given with -b, regressions are not "
+			"checked\n", argv[0]);
+	return (regressions ? 1 : 0);
+}
@@ -0,0 +1,41 @@
+#!/bin/sh
+# Check that the peak RSS of hsh stays flat however many times a loop
+# replaces and unsets environment variables.
+#
+# Usage: bench/rss_check.sh [hsh] [rounds]
+#   The loop runs rounds / 10 times, then rounds times; the second peak may
+#   exceed the first by at most SLACK KiB (default 256).
+
+hsh=${1:-./hsh}
+rounds=${2:-1000000}
+slack=${SLACK:-256}
+
+# peak ROUNDS - Print the peak RSS of hsh, in KiB, after ROUNDS rounds
+peak()
+{
+	"$hsh" <<EOF | awk '/^VmHWM:/ { print $2 }'
+i=0
+while [ \$i -lt $1 ]
+do
+	setenv HSH_RSS_COUNTER \$i
+	setenv HSH_RSS_GONE \$i
+	unsetenv HSH_RSS_GONE
+	i=\$((i + 1))
+done
+grep VmHWM /proc/\$\$/status
+EOF
+}
+
+small=$(peak $((rounds / 10)))
+large=$(peak "$rounds")
+if [ -z "$small" ] || [ -z "$large" ]
+then
+	echo "rss_check: could not read the peak RSS of $hsh" >&2
+	exit 2
+fi
+echo "rss_check: $((rounds / 10)) rounds: $small KiB, $rounds rounds: $large KiB"
+if [ $((large - small)) -gt "$slack" ]
+then
+	echo "rss_check: peak RSS grew by $((large - small)) KiB" >&2
+	exit 1
+fi
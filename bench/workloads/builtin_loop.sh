@@ -0,0 +1,10 @@
+# Builtins, expansion and case matching, no fork
+i=0
+while [ $i -lt 20000 ]
+do
+	case "file$i.txt" in
+	*.c) ;;
+	file*.txt) n=$((n + i % 7)) ;;
+	esac
+	i=$((i + 1))
+done
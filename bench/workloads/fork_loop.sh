@@ -0,0 +1,8 @@
+# Many short external commands, one fork and exec each
+i=0
+while [ $i -lt 1000 ]
+do
+	/bin/true
+	ls / >/dev/null
+	i=$((i + 1))
+done
@@ -0,0 +1,11 @@
+# Here-documents expanded and fed to a command on every iteration
+i=0
+while [ $i -lt 300 ]
+do
+	cat <<END
+iteration $i of the here-document workload
+with a few lines of text
+and a variable $HOME to expand
+END
+	i=$((i + 1))
+done
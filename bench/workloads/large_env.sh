@@ -0,0 +1,9 @@
+# env: 5000
+# Commands started with a large environment
+i=0
+while [ $i -lt 200 ]
+do
+	/bin/true
+	i=$((i + 1))
+done
+env >/dev/null
@@ -0,0 +1,9 @@
+# path: 300
+# Commands found through a long PATH
+i=0
+while [ $i -lt 300 ]
+do
+	cat /dev/null
+	ls -d / >/dev/null
+	i=$((i + 1))
+done
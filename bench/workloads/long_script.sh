@@ -0,0 +1,3 @@
+# repeat: 10000
+# Ten thousand lines of builtins, parsed and run once each
+x=$((x + 1))
@@ -0,0 +1,7 @@
+# Long pipelines of short commands
+i=0
+while [ $i -lt 100 ]
+do
+	echo line | cat | cat | cat | cat | cat | cat | cat | cat | cat | wc -c
+	i=$((i + 1))
+done
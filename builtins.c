@@ -22,11 +22,12 @@ static int builtin_exit(char **args, int *status, char *program_name, int line_c
 
 	if (args[1])
 	{
+		errno = 0;
 		val = _strtol(args[1], &endptr, 10);
 
-		if (*endptr != '\0' || val < 0)
+		if (*endptr != '\0' || endptr == args[1] || val < 0 || errno == ERANGE)
 		{
-			fprintf(stderr, "%s: %d: exit: Illegal number: %s\n",
+			out_printf(STDERR_FILENO, "%s: %d: exit: Illegal number: %s\n",
 					program_name, line_count, args[1]);
 			*status = 2;
 			return (0);
@@ -35,12 +36,42 @@ static int builtin_exit(char **args, int *status, char *program_name, int line_c
 	}
 
 	*status = exit_status;
-	if (isatty(STDIN_FILENO))
-		printf("exit\n");
+	if (shell_interactive())
+		out_printf(STDOUT_FILENO, "exit\n");
 
 	return (-1);
 }
 
+/**
+ * builtin_exec - Handle the exec built-in command
+ * @args: Arguments passed to the exec command
+ * @program_name: Name of the shell program
+ * @line_count: Current line count for error messages
+ *
+ * Without a command, the redirections written with exec stay in place for
+ * the rest of the shell, and every later command inherits them.
+ *
+ * Examples:
+ *   exec 3>>log    - Later commands write to the log with >&3
+ *   exec <input    - The shell and its commands read input from now on
+ *   exec 3>&-      - Closes descriptor 3
+ *   exec ls -l     - Replaces the shell with ls
+ *
+ * Return: 0; with a command, does not return
+ */
+static int builtin_exec(char **args, char *program_name, int line_count)
+{
+	if (!args[1])
+	{
+		redirect_keep();
+		return (0);
+	}
+	out_flush_all();
+	input_sync_stdin();
+	exec_args(args + 1, program_name, line_count);
+	return (0);
+}
+
 /**
  * builtin_cd - Handle the cd built-in command
  * @args: Arguments passed to the cd command
@@ -64,7 +95,7 @@ static int builtin_cd(char **args, char *program_name, int line_count)
 	/* Get current working directory */
 	if (getcwd(cwd, sizeof(cwd)) == NULL)
 	{
-		perror("getcwd");
+		out_printf(STDERR_FILENO, "getcwd: %s\n", strerror(errno));
 		return (-1);
 	}
 
@@ -74,7 +105,7 @@ static int builtin_cd(char **args, char *program_name, int line_count)
 		dir = _getenv("HOME");
 		if (!dir || dir[0] == '\0')
 		{
-			fprintf(stderr, "%s: %d: cd: HOME not set\n",
+			out_printf(STDERR_FILENO, "%s: %d: cd: HOME not set\n",
 					program_name, line_count);
 			return (-1);
 		}
@@ -84,11 +115,11 @@ static int builtin_cd(char **args, char *program_name, int line_count)
 		dir = _getenv("OLDPWD");
 		if (!dir || dir[0] == '\0')
 		{
-			fprintf(stderr, "%s: %d: cd: OLDPWD not set\n",
+			out_printf(STDERR_FILENO, "%s: %d: cd: OLDPWD not set\n",
 					program_name, line_count);
 			return (-1);
 		}
-		printf("%s\n", dir);
+		out_printf(STDOUT_FILENO, "%s\n", dir);
 	}
 	else
 		dir = args[1];
@@ -97,14 +128,14 @@ static int builtin_cd(char **args, char *program_name, int line_count)
 	oldpwd = _strdup(cwd);
 	if (!oldpwd)
 	{
-		perror("_strdup");
+		out_printf(STDERR_FILENO, "_strdup: %s\n", strerror(errno));
 		return (-1);
 	}
 
 	/* Change directory */
 	if (chdir(dir) == -1)
 	{
-		fprintf(stderr, "%s: %d: cd: can't cd to %s\n",
+		out_printf(STDERR_FILENO, "%s: %d: cd: can't cd to %s\n",
 				program_name, line_count, dir);
 		free(oldpwd);
 		return (-1);
@@ -113,7 +144,7 @@ static int builtin_cd(char **args, char *program_name, int line_count)
 	/* Get new current directory */
 	if (getcwd(cwd, sizeof(cwd)) == NULL)
 	{
-		perror("getcwd");
+		out_printf(STDERR_FILENO, "getcwd: %s\n", strerror(errno));
 		free(oldpwd);
 		return (-1);
 	}
@@ -121,7 +152,7 @@ static int builtin_cd(char **args, char *program_name, int line_count)
 	/* Update environment variables */
 	if (_setenv("OLDPWD", oldpwd) == -1)
 	{
-		perror("_setenv");
+		out_printf(STDERR_FILENO, "_setenv: %s\n", strerror(errno));
 		free(oldpwd);
 		return (-1);
 	}
@@ -129,7 +160,7 @@ static int builtin_cd(char **args, char *program_name, int line_count)
 
 	if (_setenv("PWD", cwd) == -1)
 	{
-		perror("_setenv");
+		out_printf(STDERR_FILENO, "_setenv: %s\n", strerror(errno));
 		return (-1);
 	}
 
@@ -149,11 +180,246 @@ static int builtin_env(void)
 	int i;
 
 	for (i = 0; environ[i]; i++)
-		printf("%s\n", environ[i]);
+		out_printf(STDOUT_FILENO, "%s\n", environ[i]);
+
+	return (0);
+}
 
+/**
+ * builtin_loop - Handle the break and continue built-in commands
+ * @args: Arguments passed to the command
+ * @program_name: Name of the shell program
+ * @line_count: Current line count for error messages
+ *
+ * Examples:
+ *   break      - Leaves the innermost loop
+ *   continue 2 - Goes on with the next iteration of the enclosing loop
+ *
+ * Return: 0 on success, 1 on failure
+ */
+static int builtin_loop(char **args, char *program_name, int line_count)
+{
+	long levels = 1;
+	char *endptr;
+
+	if (args[1])
+	{
+		errno = 0;
+		levels = _strtol(args[1], &endptr, 10);
+		if (*endptr != '\0' || levels <= 0 || errno == ERANGE)
+		{
+			out_printf(STDERR_FILENO, "%s: %d: %s: Illegal number: %s\n",
+					program_name, line_count, args[0], args[1]);
+			return (1);
+		}
+	}
+	loop_control((int)(levels > 1000 ? 1000 : levels),
+		_strcmp(args[0], "continue") == 0);
 	return (0);
 }
 
+/**
+ * builtin_return - Handle the return built-in command
+ * @args: Arguments passed to the command
+ * @program_name: Name of the shell program
+ * @line_count: Current line count for error messages
+ *
+ * Examples:
+ *   return   - Returns with the status of the last command
+ *   return 3 - Returns with status 3
+ *
+ * Return: Status of the function, or 2 on failure
+ */
+static int builtin_return(char **args, char *program_name, int line_count)
+{
+	long status = shell_status();
+	char *endptr;
+
+	if (args[1])
+	{
+		errno = 0;
+		status = _strtol(args[1], &endptr, 10);
+		if (*endptr != '\0' || endptr == args[1] || status < 0 ||
+			errno == ERANGE)
+		{
+			out_printf(STDERR_FILENO, "%s: %d: return: Illegal number: %s\n",
+					program_name, line_count, args[1]);
+			return (2);
+		}
+	}
+	if (shell_return((int)(status & 0xFF)) == -1)
+	{
+		out_printf(STDERR_FILENO, "%s: %d: return: not in a function\n",
+				program_name, line_count);
+		return (1);
+	}
+	return ((int)(status & 0xFF));
+}
+
+/**
+ * builtin_local - Handle the local built-in command
+ * @args: Arguments passed to the command
+ * @program_name: Name of the shell program
+ * @line_count: Current line count for error messages
+ *
+ * Example:
+ *   local i=0 name - i and name are restored when the function returns
+ *
+ * Return: 0 on success, 1 on failure
+ */
+static int builtin_local(char **args, char *program_name, int line_count)
+{
+	int i, status = 0, r;
+
+	for (i = 1; args[i]; i++)
+	{
+		r = var_local(args[i]);
+		if (r == -2)
+		{
+			out_printf(STDERR_FILENO, "%s: %d: local: not in a function\n",
+					program_name, line_count);
+			return (1);
+		}
+		if (r == -1)
+		{
+			out_printf(STDERR_FILENO, "%s: %d: local: %s: bad variable name\n",
+					program_name, line_count, args[i]);
+			status = 1;
+		}
+	}
+	return (status);
+}
+
+/**
+ * enum builtin_e - Index of each built-in, in the order of builtin_name
+ * @BUILTIN_COLON: :
+ * @BUILTIN_BRACKET: [
+ * @BUILTIN_BREAK: break
+ * @BUILTIN_CD: cd
+ * @BUILTIN_CONTINUE: continue
+ * @BUILTIN_ENV: env
+ * @BUILTIN_EXEC: exec
+ * @BUILTIN_EXIT: exit
+ * @BUILTIN_FALSE: false
+ * @BUILTIN_LOCAL: local
+ * @BUILTIN_MEMSTATS: memstats
+ * @BUILTIN_READ: read
+ * @BUILTIN_RETURN: return
+ * @BUILTIN_SETENV: setenv
+ * @BUILTIN_STATS: stats
+ * @BUILTIN_TEST: test
+ * @BUILTIN_TIMEOUT: timeout
+ * @BUILTIN_TRUE: true
+ * @BUILTIN_UNSETENV: unsetenv
+ * @BUILTIN_COUNT: Number of built-ins
+ */
+enum builtin_e
+{
+	BUILTIN_COLON,
+	BUILTIN_BRACKET,
+	BUILTIN_BREAK,
+	BUILTIN_CD,
+	BUILTIN_CONTINUE,
+	BUILTIN_ENV,
+	BUILTIN_EXEC,
+	BUILTIN_EXIT,
+	BUILTIN_FALSE,
+	BUILTIN_LOCAL,
+	BUILTIN_MEMSTATS,
+	BUILTIN_READ,
+	BUILTIN_RETURN,
+	BUILTIN_SETENV,
+	BUILTIN_STATS,
+	BUILTIN_TEST,
+	BUILTIN_TIMEOUT,
+	BUILTIN_TRUE,
+	BUILTIN_UNSETENV,
+	BUILTIN_COUNT
+};
+
+/**
+ * builtin_name - Get the name of a built-in command
+ * @i: Index of the built-in
+ *
+ * Example:
+ *   for (i = 0; builtin_name(i); i++)   - Walks every built-in
+ *
+ * Return: The name, or NULL past the last built-in
+ */
+const char *builtin_name(int i)
+{
+	static const char *const names[] = {
+		":", "[", "break", "cd", "continue", "env", "exec", "exit",
+		"false", "local", "memstats", "read", "return", "setenv", "stats",
+		"test", "timeout", "true", "unsetenv", NULL
+	};
+
+	if (i < 0 || i >= (int)(sizeof(names) / sizeof(names[0])))
+		return (NULL);
+	return (names[i]);
+}
+
+/**
+ * builtin_index - Find a built-in by name
+ * @name: The command name
+ *
+ * Return: Index of the built-in, as given to builtin_name, or -1
+ */
+int builtin_index(const char *name)
+{
+	static int syms[BUILTIN_COUNT];
+	static int ready;
+	const char *b;
+	int i, sym;
+
+	/* The names are interned once; a lookup then compares ids */
+	if (!ready)
+	{
+		for (i = 0; (b = builtin_name(i)) != NULL; i++)
+			syms[i] = intern(b, _strlen(b));
+		ready = 1;
+	}
+	sym = intern_find(name, _strlen(name));
+	if (sym == -1)
+		return (-1);
+	for (i = 0; i < BUILTIN_COUNT; i++)
+		if (syms[i] == sym)
+			return (i);
+	return (-1);
+}
+
+/**
+ * builtin_threadable - Tell whether a built-in can run on a thread
+ * @i: Index of the built-in
+ *
+ * Only built-ins that leave the shell as they found it and never read
+ * stdin qualify: in a pipeline, a stage must not change the shell, and
+ * the shell's stdin is not the stage's.
+ *
+ * Return: 1 if it can, 0 otherwise
+ */
+int builtin_threadable(int i)
+{
+	static const char threadable[BUILTIN_COUNT] = {
+		[BUILTIN_COLON] = 1, [BUILTIN_BRACKET] = 1, [BUILTIN_ENV] = 1,
+		[BUILTIN_FALSE] = 1, [BUILTIN_MEMSTATS] = 1, [BUILTIN_TEST] = 1,
+		[BUILTIN_TRUE] = 1
+	};
+
+	return (i >= 0 && i < BUILTIN_COUNT && threadable[i]);
+}
+
+/**
+ * is_builtin - Tell whether a command name is a built-in
+ * @name: The command name
+ *
+ * Return: 1 if it is, 0 otherwise
+ */
+int is_builtin(const char *name)
+{
+	return (builtin_index(name) != -1);
+}
+
 /**
  * handle_builtin - Check if command is a built-in and execute it
  * @args: Command and its arguments
@@ -165,40 +431,99 @@ static int builtin_env(void)
  *   args={"exit", NULL}                - Exits shell
  *   args={"cd", "/tmp", NULL}          - Changes directory
  *   args={"env", NULL}                 - Shows environment
+ *   args={"[", "-d", "/tmp", "]", NULL} - Sets status to 0
  *
  * Return: 1 if a built-in was executed, 0 otherwise, -1 on exit
  */
 int handle_builtin(char **args, int *status, char *program_name, int line_count)
 {
+	int i;
+
 	if (!args || !args[0])
 		return (0);
+	i = builtin_index(args[0]);
+	if (i == -1)
+		return (0);
+	stats_builtin(i);
 
-	if (_strcmp(args[0], "exit") == 0)
+	if (i == BUILTIN_EXIT)
 	{
 		if (builtin_exit(args, status, program_name, line_count) == -1)
 			return (-1);
 		return (1);
 	}
-	else if (_strcmp(args[0], "cd") == 0)
+	else if (i == BUILTIN_CD)
 	{
 		*status = builtin_cd(args, program_name, line_count) == 0 ? 0 : 1;
 		return (1);
 	}
-	else if (_strcmp(args[0], "env") == 0)
+	else if (i == BUILTIN_ENV)
 	{
 		*status = builtin_env();
 		return (1);
 	}
-	else if (_strcmp(args[0], "setenv") == 0)
+	else if (i == BUILTIN_EXEC)
+	{
+		*status = builtin_exec(args, program_name, line_count);
+		return (1);
+	}
+	else if (i == BUILTIN_SETENV)
 	{
 		*status = builtin_setenv(args, program_name, line_count) == 0 ? 0 : 1;
 		return (1);
 	}
-	else if (_strcmp(args[0], "unsetenv") == 0)
+	else if (i == BUILTIN_UNSETENV)
 	{
 		*status = builtin_unsetenv(args, program_name, line_count) == 0 ? 0 : 1;
 		return (1);
 	}
+	else if (i == BUILTIN_TRUE || i == BUILTIN_COLON ||
+		i == BUILTIN_FALSE)
+	{
+		*status = args[0][0] == 'f';
+		return (1);
+	}
+	else if (i == BUILTIN_TEST || i == BUILTIN_BRACKET)
+	{
+		*status = builtin_test(args, program_name, line_count);
+		return (1);
+	}
+	else if (i == BUILTIN_BREAK || i == BUILTIN_CONTINUE)
+	{
+		*status = builtin_loop(args, program_name, line_count);
+		return (1);
+	}
+	else if (i == BUILTIN_RETURN)
+	{
+		*status = builtin_return(args, program_name, line_count);
+		return (1);
+	}
+	else if (i == BUILTIN_LOCAL)
+	{
+		*status = builtin_local(args, program_name, line_count);
+		return (1);
+	}
+	else if (i == BUILTIN_READ)
+	{
+		*status = builtin_read(args, program_name, line_count);
+		return (1);
+	}
+	else if (i == BUILTIN_MEMSTATS)
+	{
+		pool_report();
+		*status = 0;
+		return (1);
+	}
+	else if (i == BUILTIN_STATS)
+	{
+		*status = builtin_stats(args, program_name, line_count);
+		return (1);
+	}
+	else if (i == BUILTIN_TIMEOUT)
+	{
+		*status = builtin_timeout(args, program_name, line_count);
+		return (1);
+	}
 
 	return (0);
 }
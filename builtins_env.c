@@ -18,7 +18,7 @@ int builtin_setenv(char **args, char *program_name, int line_count)
 	/* Check if both name and value are provided */
 	if (!args[1] || !args[2])
 	{
-		fprintf(stderr, "%s: %d: setenv: Too few arguments\n",
+		out_printf(STDERR_FILENO, "%s: %d: setenv: Too few arguments\n",
 				program_name, line_count);
 		return (-1);
 	}
@@ -31,7 +31,7 @@ int builtin_setenv(char **args, char *program_name, int line_count)
 		  (name[0] >= 'A' && name[0] <= 'Z') ||
 		  name[0] == '_'))
 	{
-		fprintf(stderr, "%s: %d: setenv: Invalid variable name\n",
+		out_printf(STDERR_FILENO, "%s: %d: setenv: Invalid variable name\n",
 				program_name, line_count);
 		return (-1);
 	}
@@ -39,7 +39,8 @@ int builtin_setenv(char **args, char *program_name, int line_count)
 	/* Update environment variable */
 	if (_setenv(name, value) == -1)
 	{
-		fprintf(stderr, "%s: %d: setenv: Failed to set environment variable\n",
+		out_printf(STDERR_FILENO,
+				"%s: %d: setenv: Failed to set environment variable\n",
 				program_name, line_count);
 		return (-1);
 	}
@@ -60,33 +61,24 @@ int builtin_setenv(char **args, char *program_name, int line_count)
  */
 int builtin_unsetenv(char **args, char *program_name, int line_count)
 {
-	char *name;
-	size_t name_len;
-	int i, j;
-
 	/* Check if variable name is provided */
 	if (!args[1])
 	{
-		fprintf(stderr, "%s: %d: unsetenv: Too few arguments\n",
+		out_printf(STDERR_FILENO, "%s: %d: unsetenv: Too few arguments\n",
 				program_name, line_count);
 		return (-1);
 	}
 
-	name = args[1];
-	name_len = _strlen(name);
-
-	/* Find and remove the environment variable */
-	for (i = 0; environ[i]; i++)
+	/* Remove the variable, freeing its string if the shell set it */
+	if (_unsetenv(args[1]) == -1)
 	{
-		if (_strncmp(environ[i], name, name_len) == 0 && environ[i][name_len] == '=')
-		{
-			/* Shift all the subsequent environment variables up */
-			for (j = i; environ[j]; j++)
-				environ[j] = environ[j + 1];
-			return (0);
-		}
+		out_printf(STDERR_FILENO,
+				"%s: %d: unsetenv: Failed to unset environment variable\n",
+				program_name, line_count);
+		return (-1);
 	}
+	if (_strcmp(args[1], "PATH") == 0)
+		path_index_invalidate();
 
-	/* Variable not found, but still return success */
 	return (0);
 }
@@ -0,0 +1,242 @@
+#include "hsh.h"
+
+/**
+ * struct read_line_s - Line read by the read built-in
+ * @buf: The bytes, backslashes removed unless raw
+ * @quoted: For each byte, whether a backslash quoted it
+ * @len: Number of bytes
+ * @cap: Size of buf and quoted
+ */
+typedef struct read_line_s
+{
+	char	*buf;
+	char	*quoted;
+	size_t	len;
+	size_t	cap;
+} read_line_t;
+
+/**
+ * read_append - Append a segment to the line
+ * @l: The line
+ * @s: The segment
+ * @len: Length of the segment
+ * @raw: Whether backslashes are kept as they are
+ *
+ * Return: 1 if the segment ends with a backslash continuing the line, 0 if
+ * not, -1 on failure
+ */
+static int read_append(read_line_t *l, const char *s, size_t len, int raw)
+{
+	size_t i, cap;
+	char *buf, *quoted = NULL;
+
+	if (l->len + len + 1 > l->cap)
+	{
+		/* On failure the old blocks stay in the line, to be freed */
+		cap = (l->len + len + 1) * 2;
+		buf = _realloc(l->buf, cap);
+		if (buf)
+		{
+			l->buf = buf;
+			quoted = _realloc(l->quoted, cap);
+		}
+		if (!quoted)
+			return (-1);
+		l->quoted = quoted;
+		l->cap = cap;
+	}
+	for (i = 0; i < len; i++)
+	{
+		l->quoted[l->len] = 0;
+		if (!raw && s[i] == '\\')
+		{
+			if (++i == len)
+				return (1);
+			l->quoted[l->len] = 1;
+		}
+		l->buf[l->len++] = s[i];
+	}
+	return (0);
+}
+
+/**
+ * read_input - Read one line from stdin
+ * @l: The line, filled in
+ * @delim: Byte ending the line
+ * @raw: Whether backslashes are kept as they are
+ *
+ * The line comes from the reader shared with the shell. Seekable input
+ * is read in blocks and rewound over the unused bytes afterwards; a pipe
+ * or a terminal is read a byte at a time, so nothing the next command
+ * should see is consumed.
+ *
+ * Return: 0 if the delimiter was found, 1 at end of input, -1 on failure
+ */
+static int read_input(read_line_t *l, int delim, int raw)
+{
+	input_t *in = input_read_stdin();
+	char *seg;
+	ssize_t len;
+	int ended = 0, more = 1;
+
+	if (!in)
+		return (-1);
+	while (more == 1)
+	{
+		len = input_until(in, delim, &seg, &ended);
+		if (len == -1)
+		{
+			/* A terminal may deliver more after an end-of-file key */
+			if (isatty(in->fd))
+				in->eof = 0;
+			ended = 0;
+			break;
+		}
+		more = read_append(l, seg, len, raw);
+		if (more == -1)
+			return (-1);
+		if (!ended)
+			break;
+	}
+	return (ended ? 0 : 1);
+}
+
+/**
+ * read_is_ifs - Tell whether a byte of the line separates fields
+ * @l: The line
+ * @i: Index of the byte
+ * @ifs: The field separators
+ * @space: 1 to only accept white space separators, 0 for any
+ *
+ * Return: 1 if it does, 0 otherwise
+ */
+static int read_is_ifs(read_line_t *l, size_t i, const char *ifs, int space)
+{
+	char c;
+
+	if (i >= l->len || l->quoted[i])
+		return (0);
+	c = l->buf[i];
+	if (!c || !_strchr(ifs, c))
+		return (0);
+	return (!space || c == ' ' || c == '\t' || c == '\n');
+}
+
+/**
+ * read_assign - Split the line into fields and assign the variables
+ * @l: The line
+ * @names: The variables, the last one taking the rest of the line
+ *
+ * White space in IFS around fields is dropped and runs of it count as a
+ * single separator; any other IFS byte separates two fields on its own.
+ *
+ * Return: 0 on success, -1 on failure
+ */
+static int read_assign(read_line_t *l, char **names)
+{
+	const char *ifs = var_get("IFS");
+	size_t i = 0, start, end;
+	char saved;
+	int n, r;
+
+	if (!ifs)
+		ifs = " \t\n";
+	for (n = 0; names[n]; n++)
+	{
+		while (read_is_ifs(l, i, ifs, 1))
+			i++;
+		start = i;
+		if (names[n + 1])
+		{
+			while (i < l->len && !read_is_ifs(l, i, ifs, 0))
+				i++;
+			end = i;
+			/* The separator: white space, at most one other byte */
+			while (read_is_ifs(l, i, ifs, 1))
+				i++;
+			if (read_is_ifs(l, i, ifs, 0))
+				i++;
+		}
+		else
+		{
+			end = i = l->len;
+			while (end > start && read_is_ifs(l, end - 1, ifs, 1))
+				end--;
+		}
+		saved = l->buf[end];
+		l->buf[end] = '\0';
+		r = var_set(names[n], l->buf + start);
+		l->buf[end] = saved;
+		if (r == -1)
+			return (-1);
+	}
+	return (0);
+}
+
+/**
+ * builtin_read - Handle the read built-in command
+ * @args: Arguments passed to the read command
+ * @program_name: Name of the shell program
+ * @line_count: Current line count for error messages
+ *
+ * Reads a line from stdin, splits it on IFS and assigns the fields to the
+ * variables, REPLY when none is named. Without -r, a backslash quotes the
+ * next byte and a backslash before the delimiter joins the next line.
+ *
+ * Examples:
+ *   read -r line           - Reads a line as is
+ *   read -d : user rest    - Reads up to the first colon
+ *   while read a b; do ...; done < file
+ *
+ * Return: 0 on success, 1 at end of input, 2 on a usage error
+ */
+int builtin_read(char **args, char *program_name, int line_count)
+{
+	static char *reply[] = {"REPLY", NULL};
+	read_line_t l = {NULL, NULL, 0, 0};
+	int i = 1, raw = 0, delim = '\n', status;
+	char **names;
+
+	for (; args[i] && args[i][0] == '-' && args[i][1]; i++)
+	{
+		if (_strcmp(args[i], "--") == 0)
+		{
+			i++;
+			break;
+		}
+		if (_strcmp(args[i], "-r") == 0)
+			raw = 1;
+		else if (_strncmp(args[i], "-d", 2) == 0 && (args[i][2] || args[i + 1]))
+			delim = (unsigned char)(args[i][2] ? args[i][2] : args[++i][0]);
+		else
+		{
+			out_printf(STDERR_FILENO, "%s: %d: read: Illegal option %s\n",
+					program_name, line_count, args[i]);
+			return (2);
+		}
+	}
+	names = args[i] ? args + i : reply;
+	for (i = 0; names[i]; i++)
+		if (var_name_length(names[i]) != (size_t)_strlen(names[i]))
+		{
+			out_printf(STDERR_FILENO, "%s: %d: read: %s: bad variable name\n",
+					program_name, line_count, names[i]);
+			return (2);
+		}
+
+	l.cap = 128;
+	l.buf = pool_alloc(l.cap);
+	l.quoted = pool_alloc(l.cap);
+	status = l.buf && l.quoted ? read_input(&l, delim, raw) : -1;
+	if (status != -1 && read_assign(&l, names) == -1)
+		status = -1;
+	pool_free(l.buf);
+	pool_free(l.quoted);
+	if (status == -1)
+	{
+		out_printf(STDERR_FILENO, "%s: %d: read: %s\n", program_name,
+				line_count, strerror(errno));
+		return (2);
+	}
+	return (status);
+}
@@ -0,0 +1,277 @@
+#include "hsh.h"
+
+/**
+ * struct test_s - State of a test expression being evaluated
+ * @argv: Operands and operators, without the command name
+ * @argc: Number of operands and operators
+ * @pos: Current position
+ * @error: Set when the expression is invalid
+ * @name: Command name, "test" or "["
+ * @program_name: Name of the shell program
+ * @line_count: Current line count for error messages
+ */
+typedef struct test_s
+{
+	char	**argv;
+	int		argc;
+	int		pos;
+	int		error;
+	char	*name;
+	char	*program_name;
+	int		line_count;
+} test_t;
+
+static int test_or(test_t *t);
+
+/**
+ * test_number - Parse an integer operand
+ * @t: The expression
+ * @s: The operand
+ *
+ * Return: The integer, or 0 after reporting an error
+ */
+static long test_number(test_t *t, const char *s)
+{
+	char *endptr;
+	long n;
+
+	errno = 0;
+	n = _strtol(s, &endptr, 10);
+	if (endptr == s || *endptr != '\0' || errno == ERANGE)
+	{
+		if (!t->error)
+			out_printf(STDERR_FILENO, "%s: %d: %s: Illegal number: %s\n",
+				t->program_name, t->line_count, t->name, s);
+		t->error = 1;
+		return (0);
+	}
+	return (n);
+}
+
+/**
+ * test_unary - Evaluate a unary test
+ * @op: The operator
+ * @arg: The operand
+ *
+ * Return: 1 if true, 0 if false, -1 if op is not a unary operator
+ */
+static int test_unary(const char *op, const char *arg)
+{
+	struct stat st;
+
+	if (op[0] != '-' || !op[1] || op[2])
+		return (-1);
+	if (op[1] == 'n' || op[1] == 'z')
+		return ((arg[0] != '\0') == (op[1] == 'n'));
+	if (op[1] == 'r' || op[1] == 'w' || op[1] == 'x')
+		return (access(arg, op[1] == 'r' ? R_OK : op[1] == 'w' ? W_OK : X_OK) == 0);
+	if (op[1] == 'h' || op[1] == 'L')
+		return (lstat(arg, &st) == 0 && S_ISLNK(st.st_mode));
+	if (!_strchr("efdsbcpS", op[1]))
+		return (-1);
+	if (stat(arg, &st) == -1)
+		return (0);
+	switch (op[1])
+	{
+	case 'f':
+		return (S_ISREG(st.st_mode));
+	case 'd':
+		return (S_ISDIR(st.st_mode));
+	case 's':
+		return (st.st_size > 0);
+	case 'b':
+		return (S_ISBLK(st.st_mode));
+	case 'c':
+		return (S_ISCHR(st.st_mode));
+	case 'p':
+		return (S_ISFIFO(st.st_mode));
+	case 'S':
+		return (S_ISSOCK(st.st_mode));
+	default:
+		return (1);
+	}
+}
+
+/**
+ * test_binary - Evaluate a binary test
+ * @t: The expression
+ * @a: Left operand
+ * @op: The operator
+ * @b: Right operand
+ *
+ * Return: 1 if true, 0 if false, -1 if op is not a binary operator
+ */
+static int test_binary(test_t *t, const char *a, const char *op, const char *b)
+{
+	static const char *const ops[] = {
+		"-eq", "-ne", "-lt", "-le", "-gt", "-ge", NULL
+	};
+	long x, y;
+	int i;
+
+	if (_strcmp(op, "=") == 0 || _strcmp(op, "==") == 0)
+		return (_strcmp(a, b) == 0);
+	if (_strcmp(op, "!=") == 0)
+		return (_strcmp(a, b) != 0);
+	for (i = 0; ops[i] && _strcmp(op, ops[i]) != 0; i++)
+		;
+	if (!ops[i])
+		return (-1);
+	x = test_number(t, a);
+	y = test_number(t, b);
+	switch (i)
+	{
+	case 0:
+		return (x == y);
+	case 1:
+		return (x != y);
+	case 2:
+		return (x < y);
+	case 3:
+		return (x <= y);
+	case 4:
+		return (x > y);
+	default:
+		return (x >= y);
+	}
+}
+
+/**
+ * test_primary - Evaluate a parenthesized expression or a single test
+ * @t: The expression
+ *
+ * Return: 1 if true, 0 if false
+ */
+static int test_primary(test_t *t)
+{
+	char **v = t->argv + t->pos;
+	int left = t->argc - t->pos, r;
+
+	if (left <= 0)
+	{
+		t->error = 1;
+		return (0);
+	}
+	if (_strcmp(v[0], "(") == 0 && left > 1)
+	{
+		t->pos++;
+		r = test_or(t);
+		if (t->pos >= t->argc || _strcmp(t->argv[t->pos], ")") != 0)
+			t->error = 1;
+		t->pos++;
+		return (r);
+	}
+	if (left >= 3 && (r = test_binary(t, v[0], v[1], v[2])) != -1)
+	{
+		t->pos += 3;
+		return (r);
+	}
+	if (left >= 2 && (r = test_unary(v[0], v[1])) != -1)
+	{
+		t->pos += 2;
+		return (r);
+	}
+	t->pos++;
+	return (v[0][0] != '\0');
+}
+
+/**
+ * test_not - Evaluate a possibly negated test
+ * @t: The expression
+ *
+ * Return: 1 if true, 0 if false
+ */
+static int test_not(test_t *t)
+{
+	if (t->pos < t->argc - 1 && _strcmp(t->argv[t->pos], "!") == 0)
+	{
+		t->pos++;
+		return (!test_not(t));
+	}
+	return (test_primary(t));
+}
+
+/**
+ * test_or - Evaluate tests joined by -a and -o
+ * @t: The expression
+ *
+ * Return: 1 if true, 0 if false
+ */
+static int test_or(test_t *t)
+{
+	int r = test_not(t), and_r;
+
+	while (t->pos < t->argc && !t->error)
+	{
+		if (_strcmp(t->argv[t->pos], "-a") == 0)
+		{
+			t->pos++;
+			and_r = test_not(t);
+			r = r && and_r;
+		}
+		else if (_strcmp(t->argv[t->pos], "-o") == 0)
+		{
+			t->pos++;
+			and_r = test_not(t);
+			while (t->pos < t->argc && _strcmp(t->argv[t->pos], "-a") == 0)
+			{
+				t->pos++;
+				and_r = test_not(t) && and_r;
+			}
+			r = r || and_r;
+		}
+		else
+			break;
+	}
+	return (r);
+}
+
+/**
+ * builtin_test - Handle the test and [ built-in commands
+ * @args: Arguments passed to the command
+ * @program_name: Name of the shell program
+ * @line_count: Current line count for error messages
+ *
+ * Runs in the shell, so loop conditions made of tests never fork.
+ *
+ * Examples:
+ *   [ -d /tmp ]          - Status 0
+ *   test "$a" = b        - Status 0 when $a is b
+ *   [ "$i" -lt 10 -a ! -e stop ]
+ *
+ * Return: 0 if the expression is true, 1 if false, 2 on error
+ */
+int builtin_test(char **args, char *program_name, int line_count)
+{
+	test_t t = {NULL, 0, 0, 0, NULL, NULL, 0};
+	int r;
+
+	t.name = args[0];
+	t.program_name = program_name;
+	t.line_count = line_count;
+	t.argv = args + 1;
+	while (t.argv[t.argc])
+		t.argc++;
+	if (_strcmp(args[0], "[") == 0)
+	{
+		if (t.argc == 0 || _strcmp(t.argv[t.argc - 1], "]") != 0)
+		{
+			out_printf(STDERR_FILENO, "%s: %d: [: missing ]\n",
+				program_name, line_count);
+			return (2);
+		}
+		t.argc--;
+	}
+	if (t.argc == 0)
+		return (1);
+
+	r = test_or(&t);
+	if (t.error || t.pos != t.argc)
+	{
+		if (t.pos != t.argc && !t.error)
+			out_printf(STDERR_FILENO, "%s: %d: %s: unexpected operator\n",
+				program_name, line_count, t.name);
+		return (2);
+	}
+	return (!r);
+}
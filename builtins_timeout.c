@@ -0,0 +1,258 @@
+#include "hsh.h"
+
+#define TIMEOUT_TIMED_OUT 124
+#define TIMEOUT_FAILED 125
+
+/**
+ * timeout_duration - Parse a duration
+ * @s: Number of seconds, with an optional fraction and unit s, m, h or d
+ *
+ * Example:
+ *   timeout_duration("1.5")   - 1500
+ *   timeout_duration("2m")    - 120000
+ *
+ * Return: The duration in milliseconds, 0 for none, or -1 if invalid or
+ * too long to count; a duration shorter than a millisecond counts as one
+ */
+static long long timeout_duration(const char *s)
+{
+	long long ms = 0, scale = 1000, unit = 1;
+	int digits = 0, nonzero = 0, big = 0;
+
+	for (; *s >= '0' && *s <= '9'; s++, digits++)
+	{
+		/* The seconds must still fit once made milliseconds */
+		big |= ms > (LLONG_MAX / 1000 - 1 - (*s - '0')) / 10;
+		if (!big)
+			ms = ms * 10 + *s - '0';
+	}
+	ms *= 1000;
+	if (*s == '.')
+		for (s++; *s >= '0' && *s <= '9'; s++, digits++)
+		{
+			scale /= 10;
+			ms += (*s - '0') * scale;
+			nonzero |= *s != '0';
+		}
+	if (!digits || big || (*s && s[1]) || (*s && !_strchr("smhd", *s)))
+		return (-1);
+	if (*s == 'm')
+		unit = 60;
+	else if (*s == 'h')
+		unit = 3600;
+	else if (*s == 'd')
+		unit = 86400;
+	if (ms > LLONG_MAX / unit)
+		return (-1);
+	ms *= unit;
+	return (ms == 0 && nonzero ? 1 : ms);
+}
+
+/**
+ * timeout_signal - Parse a signal name or number
+ * @s: The signal, such as TERM, SIGTERM or 15
+ *
+ * Return: The signal number, or -1 if unknown
+ */
+static int timeout_signal(const char *s)
+{
+	static const struct
+	{
+		const char *name;
+		int sig;
+	} sigs[] = {
+		{"HUP", SIGHUP}, {"INT", SIGINT}, {"QUIT", SIGQUIT}, {"KILL", SIGKILL},
+		{"USR1", SIGUSR1}, {"USR2", SIGUSR2}, {"PIPE", SIGPIPE},
+		{"ALRM", SIGALRM}, {"TERM", SIGTERM}, {"CONT", SIGCONT},
+		{"STOP", SIGSTOP}, {"TSTP", SIGTSTP}, {NULL, 0}
+	};
+	char *end;
+	long n;
+	int i;
+
+	if (*s >= '0' && *s <= '9')
+	{
+		n = _strtol(s, &end, 10);
+		return (*end || n >= NSIG ? -1 : (int)n);
+	}
+	if (_strncmp(s, "SIG", 3) == 0)
+		s += 3;
+	for (i = 0; sigs[i].name; i++)
+		if (_strcmp(sigs[i].name, s) == 0)
+			return (sigs[i].sig);
+	return (-1);
+}
+
+/**
+ * timeout_wait - Wait for a process to end, up to a deadline
+ * @pidfd: Process descriptor of the process
+ * @ms: Time to wait in milliseconds, 0 to wait as long as it takes
+ *
+ * The descriptor becomes readable when the process ends; poll sleeps
+ * until then or until the deadline, with no timer process or signal.
+ *
+ * Return: 1 if the process ended, 0 if the deadline passed
+ */
+static int timeout_wait(int pidfd, long long ms)
+{
+	struct pollfd p;
+	struct timespec now, end;
+	long long left = ms;
+	int n;
+
+	p.fd = pidfd;
+	p.events = POLLIN;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	end.tv_sec += ms / 1000;
+	end.tv_nsec += ms % 1000 * 1000000;
+	while (1)
+	{
+		n = poll(&p, 1, ms == 0 ? -1 : left > INT_MAX ? INT_MAX : (int)left);
+		if (n > 0 || (n == -1 && errno != EINTR))
+			return (1);
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		left = (end.tv_sec - now.tv_sec) * 1000LL +
+			(end.tv_nsec - now.tv_nsec) / 1000000;
+		if (ms != 0 && left <= 0)
+			return (0);
+	}
+}
+
+/**
+ * timeout_run - Run the command and enforce the deadline
+ * @args: The command and its arguments
+ * @ms: Time the command may run, 0 for no limit
+ * @sig: Signal sent when the time is up
+ * @kill_ms: Time after which KILL follows, 0 for never
+ * @program_name: Name of the shell program
+ * @line_count: Line of the command
+ *
+ * The command leads a process group of its own, so the signal reaches the
+ * processes it started as well. In an interactive shell it stays in the
+ * shell's group instead, as with coreutils timeout --foreground: that is
+ * the group the terminal reads for and sends Ctrl-C to.
+ *
+ * Return: Exit status, as coreutils timeout would give it
+ */
+static int timeout_run(char **args, long long ms, int sig, long long kill_ms,
+	char *program_name, int line_count)
+{
+	int pidfd, status, sent = 0, group = !shell_interactive();
+	pid_t pid, target;
+
+	out_flush_all();
+	input_sync_stdin();
+	path_index_refresh();
+	pid = fork();
+	if (pid == 0)
+	{
+		if (group)
+			setpgid(0, 0);
+		exec_args(args, program_name, line_count);
+	}
+	if (pid == -1)
+	{
+		out_printf(STDERR_FILENO, "%s: %d: timeout: fork: %s\n",
+				program_name, line_count, strerror(errno));
+		return (TIMEOUT_FAILED);
+	}
+	stats_add(STAT_FORKS, 1);
+	if (group)
+		setpgid(pid, pid);
+	target = group ? -pid : pid;
+	pidfd = syscall(SYS_pidfd_open, pid, 0);
+	if (pidfd == -1)
+	{
+		/* Without a deadline to enforce, do not run the command at all */
+		out_printf(STDERR_FILENO, "%s: %d: timeout: pidfd_open: %s\n",
+				program_name, line_count, strerror(errno));
+		kill(target, SIGKILL);
+		stats_wait(pid, NULL);
+		return (TIMEOUT_FAILED);
+	}
+	if (!timeout_wait(pidfd, ms))
+	{
+		sent = sig;
+		kill(target, sig);
+		if (sig != SIGKILL && sig != SIGCONT)
+			kill(target, SIGCONT);
+		if (kill_ms && sig != SIGKILL && !timeout_wait(pidfd, kill_ms))
+		{
+			sent = SIGKILL;
+			kill(target, SIGKILL);
+		}
+	}
+	close(pidfd);
+	if (stats_wait(pid, &status) == -1)
+		return (TIMEOUT_FAILED);
+	if (sent)
+		return (sent == SIGKILL ? 128 + SIGKILL : TIMEOUT_TIMED_OUT);
+	return (WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status));
+}
+
+/**
+ * builtin_timeout - Handle the timeout built-in command
+ * @args: Arguments passed to the timeout command
+ * @program_name: Name of the shell program
+ * @line_count: Current line count for error messages
+ *
+ * Runs a command and signals it when it runs too long, without the extra
+ * process /usr/bin/timeout costs. Exit statuses follow coreutils.
+ *
+ * Examples:
+ *   timeout 10 make              - TERM after 10 seconds
+ *   timeout -s INT 1.5 ./server  - INT after 1.5 seconds
+ *   timeout -k 5 1m ./tests      - TERM after a minute, KILL 5 s later
+ *
+ * Return: The command's status; 124 if it timed out, 137 if it had to be
+ * killed; 125 if timeout failed, 126 if the command could not be run, 127
+ * if it was not found
+ */
+int builtin_timeout(char **args, char *program_name, int line_count)
+{
+	int i = 1, sig = SIGTERM, opt;
+	long long ms, kill_ms = 0;
+	const char *v;
+
+	for (; args[i] && args[i][0] == '-' && args[i][1]; i++)
+	{
+		if (_strcmp(args[i], "--") == 0)
+		{
+			i++;
+			break;
+		}
+		opt = args[i][1];
+		if ((opt != 's' && opt != 'k') || (!args[i][2] && !args[i + 1]))
+		{
+			out_printf(STDERR_FILENO, "%s: %d: timeout: Illegal option %s\n",
+					program_name, line_count, args[i]);
+			return (TIMEOUT_FAILED);
+		}
+		v = args[i][2] ? args[i] + 2 : args[++i];
+		if (opt == 's')
+			sig = timeout_signal(v);
+		else
+			kill_ms = timeout_duration(v);
+		if (sig == -1 || kill_ms == -1)
+		{
+			out_printf(STDERR_FILENO, "%s: %d: timeout: invalid %s: %s\n",
+					program_name, line_count, sig == -1 ? "signal" : "time", v);
+			return (TIMEOUT_FAILED);
+		}
+	}
+	if (!args[i] || !args[i + 1])
+	{
+		out_printf(STDERR_FILENO, "%s: %d: timeout: usage: timeout [-s sig] "
+				"[-k time] time command [arg...]\n", program_name, line_count);
+		return (TIMEOUT_FAILED);
+	}
+	ms = timeout_duration(args[i]);
+	if (ms == -1)
+	{
+		out_printf(STDERR_FILENO, "%s: %d: timeout: invalid time interval: %s\n",
+				program_name, line_count, args[i]);
+		return (TIMEOUT_FAILED);
+	}
+	return (timeout_run(args + i + 1, ms, sig, kill_ms, program_name,
+		line_count));
+}
@@ -0,0 +1,204 @@
+#include "hsh.h"
+
+/**
+ * struct matches_s - Growing list of completion candidates
+ * @list: The candidates
+ * @count: Number of candidates
+ * @cap: Allocated number of candidates
+ */
+typedef struct matches_s
+{
+	char	**list;
+	int		count;
+	int		cap;
+} matches_t;
+
+/**
+ * matches_add - Append a candidate made of two parts
+ * @m: The list
+ * @head: First part, may be empty
+ * @head_len: Length of the first part
+ * @tail: Second part
+ * @suffix: Character appended after the candidate, or '\0'
+ *
+ * Return: 0 on success, -1 on failure
+ */
+static int matches_add(matches_t *m, const char *head, size_t head_len,
+	const char *tail, char suffix)
+{
+	size_t tail_len = _strlen(tail);
+	char **tmp, *s;
+	int cap;
+
+	if (m->count == m->cap)
+	{
+		cap = m->cap ? m->cap * 2 : 32;
+		tmp = malloc(sizeof(char *) * cap);
+		if (!tmp)
+			return (-1);
+		if (m->list)
+			memcpy(tmp, m->list, sizeof(char *) * m->count);
+		free(m->list);
+		m->list = tmp;
+		m->cap = cap;
+	}
+	s = malloc(head_len + tail_len + 2);
+	if (!s)
+		return (-1);
+	memcpy(s, head, head_len);
+	memcpy(s + head_len, tail, tail_len);
+	s[head_len + tail_len] = suffix;
+	s[head_len + tail_len + 1] = '\0';
+	m->list[m->count++] = s;
+	return (0);
+}
+
+/**
+ * matches_cmp - qsort comparator for candidates
+ * @a: First candidate
+ * @b: Second candidate
+ *
+ * Return: Negative, zero or positive as for strcmp
+ */
+static int matches_cmp(const void *a, const void *b)
+{
+	return (strcmp(*(char * const *)a, *(char * const *)b));
+}
+
+/**
+ * complete_command - Collect builtins and PATH commands with a prefix
+ * @m: The list receiving the candidates
+ * @word: The prefix typed so far
+ */
+static void complete_command(matches_t *m, const char *word)
+{
+	size_t first, n, i, len = _strlen(word);
+	const char *name;
+	int b;
+
+	for (b = 0; (name = builtin_name(b)) != NULL; b++)
+		if (strncmp(name, word, len) == 0)
+			matches_add(m, "", 0, name, ' ');
+
+	n = path_index_prefix(word, &first);
+	for (i = first; i < first + n; i++)
+		matches_add(m, "", 0, path_index_name(i), ' ');
+}
+
+/**
+ * complete_file - Collect the file names completing a word
+ * @m: The list receiving the candidates
+ * @word: The word typed so far, possibly with a directory part
+ */
+static void complete_file(matches_t *m, const char *word)
+{
+	const char *slash = strrchr(word, '/'), *base;
+	char dir[PATH_MAX], full[PATH_MAX];
+	size_t dir_len = slash ? (size_t)(slash - word) + 1 : 0, base_len;
+	struct dirent *d;
+	struct stat st;
+	DIR *dp;
+	int is_dir;
+
+	base = word + dir_len;
+	base_len = _strlen(base);
+	if (dir_len >= sizeof(dir))
+		return;
+	if (dir_len)
+	{
+		memcpy(dir, word, dir_len);
+		dir[dir_len] = '\0';
+	}
+	else
+		_strcpy(dir, ".");
+
+	dp = opendir(dir);
+	if (!dp)
+		return;
+	while ((d = readdir(dp)) != NULL)
+	{
+		if (strncmp(d->d_name, base, base_len) != 0 ||
+			(d->d_name[0] == '.' && base[0] != '.') ||
+			_strcmp(d->d_name, ".") == 0 || _strcmp(d->d_name, "..") == 0)
+			continue;
+		is_dir = d->d_type == DT_DIR;
+		if ((d->d_type == DT_LNK || d->d_type == DT_UNKNOWN) &&
+			snprintf(full, sizeof(full), "%s/%s", dir, d->d_name) <
+			(int)sizeof(full) && stat(full, &st) == 0)
+			is_dir = S_ISDIR(st.st_mode);
+		matches_add(m, word, dir_len, d->d_name, is_dir ? '/' : ' ');
+	}
+	closedir(dp);
+}
+
+/**
+ * complete_word - Find the completions of the word before the cursor
+ * @line: The line being edited
+ * @pos: Cursor position
+ * @start: Set to the offset where the word starts
+ * @list: Set to a sorted array of candidates, to free with free_matches
+ *
+ * A word in command position completes against builtins and the PATH
+ * index; any other word, or one holding a '/', completes file names.
+ * Each candidate ends with a '/' for directories or a space otherwise.
+ *
+ * Example:
+ *   line "ec", pos 2    - {"echo "}
+ *   line "ls /u", pos 5 - {"/usr/"}
+ *
+ * Return: Number of candidates
+ */
+int complete_word(const char *line, size_t pos, size_t *start, char ***list)
+{
+	matches_t m = {NULL, 0, 0};
+	char word[PATH_MAX];
+	size_t s = pos, p;
+	int i, j;
+
+	while (s > 0 && !_strchr(" \t|;&<>", line[s - 1]))
+		s--;
+	*start = s;
+	*list = NULL;
+	if (pos - s >= sizeof(word))
+		return (0);
+	memcpy(word, line + s, pos - s);
+	word[pos - s] = '\0';
+
+	for (p = s; p > 0 && (line[p - 1] == ' ' || line[p - 1] == '\t'); p--)
+		;
+	if ((p == 0 || _strchr("|;&", line[p - 1])) && !_strchr(word, '/'))
+		complete_command(&m, word);
+	else
+		complete_file(&m, word);
+
+	if (m.count == 0)
+	{
+		free(m.list);
+		return (0);
+	}
+	/* Sort and drop duplicates, a builtin may also exist in PATH */
+	qsort(m.list, m.count, sizeof(char *), matches_cmp);
+	for (i = 1, j = 1; i < m.count; i++)
+	{
+		if (_strcmp(m.list[i], m.list[j - 1]) == 0)
+			free(m.list[i]);
+		else
+			m.list[j++] = m.list[i];
+	}
+	*list = m.list;
+	return (j);
+}
+
+/**
+ * free_matches - Free a list of completion candidates
+ * @list: The list
+ * @count: Number of candidates
+ */
+void free_matches(char **list, int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++)
+		free(list[i]);
+	free(list);
+}
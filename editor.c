@@ -0,0 +1,659 @@
+#include "hsh.h"
+
+#define CTRL_KEY(k) ((k) & 0x1f)
+
+/* Key codes for escape sequences, above the byte range */
+enum editor_key
+{
+	KEY_LEFT = 1000,
+	KEY_RIGHT,
+	KEY_UP,
+	KEY_DOWN,
+	KEY_HOME,
+	KEY_END,
+	KEY_DELETE,
+	KEY_WORD_LEFT,
+	KEY_WORD_RIGHT,
+	KEY_NONE
+};
+
+/**
+ * struct editor_s - State of the line being edited
+ * @prmt: Prompt structure owning the input buffer
+ * @prompt: Prompt string shown before the line
+ * @plen: Length of the prompt string
+ * @len: Length of the line
+ * @pos: Cursor position in the line
+ * @age: History entry being shown, -1 for the line being typed
+ */
+typedef struct editor_s
+{
+	prompt_t	*prmt;
+	const char	*prompt;
+	size_t		plen;
+	size_t		len;
+	size_t		pos;
+	int			age;
+} editor_t;
+
+static struct termios orig_termios;
+static char *kill_buf;
+static size_t kill_cap;
+static char *saved_line;
+static size_t saved_cap;
+static char *screen;
+static size_t screen_cap;
+
+/**
+ * editor_reserve - Grow a buffer to hold at least size bytes
+ * @buf: Pointer to the buffer
+ * @cap: Pointer to the current capacity
+ * @size: Required size
+ *
+ * Return: 0 on success, -1 on failure
+ */
+static int editor_reserve(char **buf, size_t *cap, size_t size)
+{
+	size_t new_cap;
+	char *tmp;
+
+	if (*buf && *cap >= size)
+		return (0);
+
+	new_cap = *cap ? *cap : 128;
+	while (new_cap < size)
+		new_cap *= 2;
+	tmp = _realloc(*buf, new_cap);
+	if (!tmp)
+		return (-1);
+	if (!*buf)
+		tmp[0] = '\0';
+	*buf = tmp;
+	*cap = new_cap;
+	return (0);
+}
+
+/**
+ * editor_set - Replace the content of a buffer
+ * @buf: Pointer to the buffer
+ * @cap: Pointer to the current capacity
+ * @s: New content
+ * @len: Length of the new content
+ *
+ * Return: 0 on success, -1 on failure
+ */
+static int editor_set(char **buf, size_t *cap, const char *s, size_t len)
+{
+	if (editor_reserve(buf, cap, len + 1) == -1)
+		return (-1);
+	memmove(*buf, s, len);
+	(*buf)[len] = '\0';
+	return (0);
+}
+
+/**
+ * editor_raw - Switch the terminal in or out of raw mode
+ * @on: 1 to enable raw mode, 0 to restore the original settings
+ *
+ * Return: 0 on success, -1 on failure
+ */
+static int editor_raw(int on)
+{
+	struct termios raw;
+
+	if (!on)
+		return (tcsetattr(STDIN_FILENO, TCSADRAIN, &orig_termios));
+
+	if (tcgetattr(STDIN_FILENO, &orig_termios) == -1)
+		return (-1);
+	raw = orig_termios;
+	raw.c_iflag &= ~(BRKINT | ICRNL | INPCK | ISTRIP | IXON);
+	raw.c_cflag |= CS8;
+	raw.c_lflag &= ~(ECHO | ICANON | IEXTEN | ISIG);
+	raw.c_cc[VMIN] = 1;
+	raw.c_cc[VTIME] = 0;
+	return (tcsetattr(STDIN_FILENO, TCSADRAIN, &raw));
+}
+
+/**
+ * editor_columns - Get the width of the terminal
+ *
+ * Return: Number of columns, 80 if unknown
+ */
+static size_t editor_columns(void)
+{
+	struct winsize ws;
+
+	if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == -1 || ws.ws_col == 0)
+		return (80);
+	return (ws.ws_col);
+}
+
+/**
+ * editor_render - Redraw the prompt and a line in a single write
+ * @prompt: Prompt string
+ * @plen: Length of the prompt
+ * @text: Line to show
+ * @len: Length of the line
+ * @pos: Cursor position in the line
+ *
+ * Lines wider than the terminal scroll horizontally around the cursor.
+ */
+static void editor_render(const char *prompt, size_t plen,
+	const char *text, size_t len, size_t pos)
+{
+	size_t cols = editor_columns(), n = 0;
+	char seq[32];
+	int seq_len;
+
+	while (plen + pos >= cols && pos > 0)
+	{
+		text++;
+		len--;
+		pos--;
+	}
+	while (plen + len > cols)
+		len--;
+
+	if (editor_reserve(&screen, &screen_cap, plen + len + 64) == -1)
+		return;
+	screen[n++] = '\r';
+	memcpy(screen + n, prompt, plen);
+	n += plen;
+	memcpy(screen + n, text, len);
+	n += len;
+	seq_len = snprintf(seq, sizeof(seq), "\x1b[0K\r\x1b[%dC", (int)(plen + pos));
+	if (plen + pos == 0)
+		seq_len = snprintf(seq, sizeof(seq), "\x1b[0K\r");
+	memcpy(screen + n, seq, seq_len);
+	n += seq_len;
+	write(STDOUT_FILENO, screen, n);
+}
+
+/**
+ * editor_refresh - Redraw the line being edited
+ * @ed: Editor state
+ */
+static void editor_refresh(editor_t *ed)
+{
+	editor_render(ed->prompt, ed->plen, ed->prmt->input, ed->len, ed->pos);
+}
+
+/**
+ * editor_read_key - Read one key, decoding escape sequences
+ *
+ * Return: The byte read, a KEY_* code, or -1 on end of input
+ */
+static int editor_read_key(void)
+{
+	input_t *in = input_stdin();
+	int c, seq[3];
+
+	if (!in)
+		return (-1);
+	c = input_getc(in);
+	if (c != 27)
+		return (c);
+
+	seq[0] = input_getc(in);
+	if (seq[0] == -1)
+		return (27);
+	if (seq[0] == 'b')
+		return (KEY_WORD_LEFT);
+	if (seq[0] == 'f')
+		return (KEY_WORD_RIGHT);
+	if (seq[0] != '[' && seq[0] != 'O')
+		return (KEY_NONE);
+	seq[1] = input_getc(in);
+	if (seq[1] == -1)
+		return (KEY_NONE);
+
+	if (seq[1] >= '0' && seq[1] <= '9')
+	{
+		seq[2] = input_getc(in);
+		if (seq[2] != '~')
+			return (KEY_NONE);
+		if (seq[1] == '1' || seq[1] == '7')
+			return (KEY_HOME);
+		if (seq[1] == '4' || seq[1] == '8')
+			return (KEY_END);
+		if (seq[1] == '3')
+			return (KEY_DELETE);
+		return (KEY_NONE);
+	}
+	switch (seq[1])
+	{
+		case 'A':
+			return (KEY_UP);
+		case 'B':
+			return (KEY_DOWN);
+		case 'C':
+			return (KEY_RIGHT);
+		case 'D':
+			return (KEY_LEFT);
+		case 'H':
+			return (KEY_HOME);
+		case 'F':
+			return (KEY_END);
+	}
+	return (KEY_NONE);
+}
+
+/**
+ * editor_insert - Insert bytes at the cursor
+ * @ed: Editor state
+ * @s: Bytes to insert
+ * @n: Number of bytes
+ *
+ * Return: 0 on success, -1 on failure
+ */
+static int editor_insert(editor_t *ed, const char *s, size_t n)
+{
+	prompt_t *p = ed->prmt;
+
+	if (editor_reserve(&p->input, &p->capacity, ed->len + n + 1) == -1)
+		return (-1);
+	memmove(p->input + ed->pos + n, p->input + ed->pos, ed->len - ed->pos);
+	memcpy(p->input + ed->pos, s, n);
+	ed->len += n;
+	ed->pos += n;
+	p->input[ed->len] = '\0';
+	return (0);
+}
+
+/**
+ * editor_kill - Cut a range of the line into the kill buffer
+ * @ed: Editor state
+ * @from: Start of the range
+ * @to: End of the range
+ */
+static void editor_kill(editor_t *ed, size_t from, size_t to)
+{
+	char *buf = ed->prmt->input;
+
+	if (from >= to)
+		return;
+	if (editor_set(&kill_buf, &kill_cap, buf + from, to - from) == -1)
+		return;
+	memmove(buf + from, buf + to, ed->len - to + 1);
+	ed->len -= to - from;
+	ed->pos = from;
+}
+
+/**
+ * editor_word_start - Find the start of the word before a position
+ * @buf: The line
+ * @pos: Position to search back from
+ *
+ * Return: Offset of the word start
+ */
+static size_t editor_word_start(const char *buf, size_t pos)
+{
+	while (pos > 0 && buf[pos - 1] == ' ')
+		pos--;
+	while (pos > 0 && buf[pos - 1] != ' ')
+		pos--;
+	return (pos);
+}
+
+/**
+ * editor_word_end - Find the end of the word after a position
+ * @buf: The line
+ * @len: Length of the line
+ * @pos: Position to search forward from
+ *
+ * Return: Offset just past the word
+ */
+static size_t editor_word_end(const char *buf, size_t len, size_t pos)
+{
+	while (pos < len && buf[pos] == ' ')
+		pos++;
+	while (pos < len && buf[pos] != ' ')
+		pos++;
+	return (pos);
+}
+
+/**
+ * editor_show - Load a line into the editor with the cursor at its end
+ * @ed: Editor state
+ * @line: The line to load
+ */
+static void editor_show(editor_t *ed, const char *line)
+{
+	prompt_t *p = ed->prmt;
+	size_t len = _strlen(line);
+
+	if (editor_set(&p->input, &p->capacity, line, len) == -1)
+		return;
+	ed->len = len;
+	ed->pos = len;
+}
+
+/**
+ * editor_history - Move through the history
+ * @ed: Editor state
+ * @step: 1 to go to an older line, -1 to go to a newer one
+ */
+static void editor_history(editor_t *ed, int step)
+{
+	int age = ed->age + step;
+
+	if (age < -1 || (age >= 0 && !hist_get(age)))
+		return;
+	/* Keep the line being typed so it can be restored */
+	if (ed->age == -1 &&
+		editor_set(&saved_line, &saved_cap, ed->prmt->input, ed->len) == -1)
+		return;
+	ed->age = age;
+	editor_show(ed, age == -1 ? saved_line : hist_get(age));
+}
+
+/**
+ * editor_search - Run an incremental reverse history search
+ * @ed: Editor state
+ *
+ * Every typed character narrows the search, Ctrl-R jumps to the next older
+ * match, Ctrl-G gives up. Any other key accepts the match into the line.
+ *
+ * Return: The key that ended the search, to be handled by the caller
+ */
+static int editor_search(editor_t *ed)
+{
+	static const char label[] = "(reverse-i-search)`";
+	char query[256], prompt[sizeof(query) + sizeof(label) + 4];
+	size_t qlen = 0, mpos = 0;
+	int match = -1, m, c;
+	const char *line, *hit;
+
+	query[0] = '\0';
+	while (1)
+	{
+		line = match >= 0 ? hist_get(match) : ed->prmt->input;
+		hit = match >= 0 ? strstr(line, query) : NULL;
+		mpos = hit ? (size_t)(hit - line) : (match >= 0 ? 0 : ed->pos);
+		snprintf(prompt, sizeof(prompt), "%s%s': ", label, query);
+		editor_render(prompt, _strlen(prompt), line, _strlen(line), mpos);
+
+		c = editor_read_key();
+		if (c == CTRL_KEY('r'))
+			m = qlen ? hist_search(query, match + 1) : -1;
+		else if ((c == 127 || c == CTRL_KEY('h')) && qlen > 0)
+		{
+			query[--qlen] = '\0';
+			m = qlen ? hist_search(query, 0) : -1;
+			match = -1;
+		}
+		else if (c >= 32 && c < 127 && qlen < sizeof(query) - 1)
+		{
+			query[qlen++] = c;
+			query[qlen] = '\0';
+			m = hist_search(query, match < 0 ? 0 : match);
+		}
+		else
+			break;
+		if (m >= 0)
+			match = m;
+		else if (c != 127 && c != CTRL_KEY('h'))
+			write(STDOUT_FILENO, "\a", 1);
+	}
+
+	if (c == CTRL_KEY('g') || c == CTRL_KEY('c'))
+		return (KEY_NONE);
+	if (match >= 0)
+	{
+		editor_show(ed, hist_get(match));
+		ed->pos = mpos;
+		ed->age = match;
+	}
+	return (c);
+}
+
+/**
+ * editor_list - Print completion candidates in columns under the line
+ * @list: The candidates
+ * @count: Number of candidates
+ */
+static void editor_list(char **list, int count)
+{
+	size_t cols = editor_columns(), width = 0, len, per_line, n = 0;
+	int i;
+
+	for (i = 0; i < count; i++)
+	{
+		len = _strlen(list[i]);
+		if (len > width)
+			width = len;
+	}
+	width += 1;
+	per_line = cols / width ? cols / width : 1;
+
+	write(STDOUT_FILENO, "\r\n", 2);
+	for (i = 0; i < count; i++)
+	{
+		len = _strlen(list[i]);
+		if (editor_reserve(&screen, &screen_cap, n + width + 2) == -1)
+			return;
+		memcpy(screen + n, list[i], len);
+		n += len;
+		if ((i + 1) % per_line == 0 || i == count - 1)
+			screen[n++] = '\n';
+		else
+			while (len++ < width)
+				screen[n++] = ' ';
+	}
+	write(STDOUT_FILENO, screen, n);
+}
+
+/**
+ * editor_complete - Complete the word before the cursor
+ * @ed: Editor state
+ *
+ * The longest prefix shared by all candidates is inserted. When that adds
+ * nothing and several candidates remain, they are listed instead.
+ */
+static void editor_complete(editor_t *ed)
+{
+	char **list;
+	size_t start, word_len, common, j;
+	int count, i;
+
+	count = complete_word(ed->prmt->input, ed->pos, &start, &list);
+	if (count == 0)
+	{
+		write(STDOUT_FILENO, "\a", 1);
+		return;
+	}
+
+	/* Candidates end with ' ' or '/', keep it only for a single match */
+	common = _strlen(list[0]) - (count > 1);
+	for (i = 1; i < count; i++)
+	{
+		for (j = 0; j < common && list[i][j] == list[0][j]; j++)
+			;
+		common = j;
+	}
+	word_len = ed->pos - start;
+	if (common > word_len)
+		editor_insert(ed, list[0] + word_len, common - word_len);
+	else if (count > 1)
+		editor_list(list, count);
+	free_matches(list, count);
+}
+
+/**
+ * editor_key - Apply one key to the line
+ * @ed: Editor state
+ * @c: The key
+ *
+ * Return: 1 when the line is complete, -1 on end of input, 0 otherwise
+ */
+static int editor_key(editor_t *ed, int c)
+{
+	char *buf = ed->prmt->input, ch;
+
+	switch (c)
+	{
+		case -1:
+			return (-1);
+		case '\r':
+		case '\n':
+			return (1);
+		case CTRL_KEY('d'):
+			if (ed->len == 0)
+				return (-1);
+			/* fall through */
+		case KEY_DELETE:
+			if (ed->pos < ed->len)
+				editor_kill(ed, ed->pos, ed->pos + 1);
+			break;
+		case 127:
+		case CTRL_KEY('h'):
+			if (ed->pos > 0)
+			{
+				memmove(buf + ed->pos - 1, buf + ed->pos, ed->len - ed->pos + 1);
+				ed->pos--;
+				ed->len--;
+			}
+			break;
+		case CTRL_KEY('c'):
+			write(STDOUT_FILENO, "^C\n", 3);
+			ed->len = 0;
+			ed->pos = 0;
+			buf[0] = '\0';
+			ed->age = -1;
+			break;
+		case KEY_LEFT:
+		case CTRL_KEY('b'):
+			if (ed->pos > 0)
+				ed->pos--;
+			break;
+		case KEY_RIGHT:
+		case CTRL_KEY('f'):
+			if (ed->pos < ed->len)
+				ed->pos++;
+			break;
+		case KEY_WORD_LEFT:
+			ed->pos = editor_word_start(buf, ed->pos);
+			break;
+		case KEY_WORD_RIGHT:
+			ed->pos = editor_word_end(buf, ed->len, ed->pos);
+			break;
+		case KEY_HOME:
+		case CTRL_KEY('a'):
+			ed->pos = 0;
+			break;
+		case KEY_END:
+		case CTRL_KEY('e'):
+			ed->pos = ed->len;
+			break;
+		case KEY_UP:
+		case CTRL_KEY('p'):
+			editor_history(ed, 1);
+			break;
+		case KEY_DOWN:
+		case CTRL_KEY('n'):
+			editor_history(ed, -1);
+			break;
+		case CTRL_KEY('k'):
+			editor_kill(ed, ed->pos, ed->len);
+			break;
+		case CTRL_KEY('u'):
+			editor_kill(ed, 0, ed->pos);
+			break;
+		case CTRL_KEY('w'):
+			editor_kill(ed, editor_word_start(buf, ed->pos), ed->pos);
+			break;
+		case CTRL_KEY('y'):
+			if (kill_buf)
+				editor_insert(ed, kill_buf, _strlen(kill_buf));
+			break;
+		case CTRL_KEY('t'):
+			if (ed->pos > 0 && ed->len > 1)
+			{
+				if (ed->pos == ed->len)
+					ed->pos--;
+				ch = buf[ed->pos - 1];
+				buf[ed->pos - 1] = buf[ed->pos];
+				buf[ed->pos] = ch;
+				ed->pos++;
+			}
+			break;
+		case CTRL_KEY('l'):
+			write(STDOUT_FILENO, "\x1b[H\x1b[2J", 7);
+			break;
+		case CTRL_KEY('r'):
+			return (editor_key(ed, editor_search(ed)));
+		case '\t':
+			editor_complete(ed);
+			break;
+		default:
+			if (c >= 32 && c < 256 && c != 127)
+			{
+				ch = (char)c;
+				editor_insert(ed, &ch, 1);
+			}
+			break;
+	}
+	return (0);
+}
+
+/**
+ * line_edit - Read a line from the terminal with editing and history
+ * @prmt: Prompt structure whose input buffer receives the line
+ * @prompt_str: Prompt string to display
+ *
+ * The input buffer of the prompt is reused from one line to the next and
+ * only grows. The terminal is in raw mode only while the line is edited.
+ *
+ * Example:
+ *   ($) ls -l<Ctrl-A>      - Cursor jumps to the start of the line
+ *   ($) <Ctrl-R>mak        - Recalls the newest line containing "mak"
+ *
+ * Return: Length of the line, or -1 on end of input
+ */
+int line_edit(prompt_t *prmt, const char *prompt_str)
+{
+	editor_t ed;
+	int done = 0;
+
+	if (editor_reserve(&prmt->input, &prmt->capacity, 128) == -1)
+		return (-1);
+	prmt->input[0] = '\0';
+	ed.prmt = prmt;
+	ed.prompt = prompt_str;
+	ed.plen = _strlen(prompt_str);
+	ed.len = 0;
+	ed.pos = 0;
+	ed.age = -1;
+
+	if (editor_raw(1) == -1)
+		return (-1);
+	editor_refresh(&ed);
+	while (!done)
+	{
+		done = editor_key(&ed, editor_read_key());
+		editor_refresh(&ed);
+	}
+	editor_raw(0);
+
+	if (done == -1)
+		return (-1);
+	write(STDOUT_FILENO, "\n", 1);
+	return ((int)ed.len);
+}
+
+/**
+ * line_edit_free - Release the buffers kept by the line editor
+ */
+void line_edit_free(void)
+{
+	pool_free(kill_buf);
+	pool_free(saved_line);
+	pool_free(screen);
+	kill_buf = NULL;
+	saved_line = NULL;
+	screen = NULL;
+	kill_cap = 0;
+	saved_cap = 0;
+	screen_cap = 0;
+}
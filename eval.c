@@ -0,0 +1,626 @@
+#include "hsh.h"
+
+/**
+ * struct run_state_s - State of the running shell
+ * @name: Name of the shell program, $0
+ * @pid: Process id of the shell, $$
+ * @status: Status of the last command, $?
+ * @exiting: Set once exit was requested
+ * @interactive: Set when commands are typed at a prompt
+ * @breaking: Number of loops left to break out of
+ * @continuing: Number of loops left to continue
+ * @loops: Number of loops currently running
+ * @returning: Set once return was requested
+ * @calls: Number of functions currently running
+ * @line: Line of the command being run, for error messages
+ * @tail: Simple command after which the shell has nothing left to do, so
+ * it may run in place of the shell, or NULL
+ */
+typedef struct run_state_s
+{
+	char	*name;
+	pid_t	pid;
+	int		status;
+	int		exiting;
+	int		interactive;
+	int		breaking;
+	int		continuing;
+	int		loops;
+	int		returning;
+	int		calls;
+	int		line;
+	node_t	*tail;
+} run_state_t;
+
+static run_state_t rs = {"hsh", 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, NULL};
+
+/**
+ * shell_init - Record the name and process id of the shell
+ * @program_name: Name of the shell program
+ */
+void shell_init(char *program_name)
+{
+	rs.name = program_name;
+	rs.pid = getpid();
+}
+
+/**
+ * shell_name - Get the name of the shell program
+ *
+ * Return: The name, as given to shell_init
+ */
+char *shell_name(void)
+{
+	return (rs.name);
+}
+
+/**
+ * shell_pid - Get the process id of the shell
+ *
+ * Return: The process id, the same in subshells
+ */
+pid_t shell_pid(void)
+{
+	return (rs.pid);
+}
+
+/**
+ * shell_line - Get the line of the command being run
+ *
+ * Return: The line, for error messages
+ */
+int shell_line(void)
+{
+	return (rs.line);
+}
+
+/**
+ * shell_status - Get the status of the last command
+ *
+ * Return: The status
+ */
+int shell_status(void)
+{
+	return (rs.status);
+}
+
+/**
+ * shell_set_status - Set the status reported by $?
+ * @status: The status
+ */
+void shell_set_status(int status)
+{
+	rs.status = status;
+}
+
+/**
+ * shell_exit - Ask the shell to exit once the current command unwinds
+ * @status: Exit status
+ */
+void shell_exit(int status)
+{
+	rs.status = status;
+	rs.exiting = 1;
+}
+
+/**
+ * shell_set_interactive - Record whether commands are typed at a prompt
+ * @interactive: 1 for an interactive shell, 0 otherwise
+ */
+void shell_set_interactive(int interactive)
+{
+	rs.interactive = interactive;
+}
+
+/**
+ * shell_expand_error - Fail the command after an expansion error
+ *
+ * The error is already reported. As in other shells, a script or a -c
+ * command stops there with status 2; at a prompt, only the command fails.
+ *
+ * Return: Always 2, the status of the command
+ */
+int shell_expand_error(void)
+{
+	rs.status = 2;
+	if (!rs.interactive)
+		shell_exit(2);
+	return (2);
+}
+
+/**
+ * shell_exiting - Tell whether exit was requested
+ *
+ * Return: 1 if it was, 0 otherwise
+ */
+int shell_exiting(void)
+{
+	return (rs.exiting);
+}
+
+/**
+ * loop_control - Break out of or continue enclosing loops
+ * @levels: Number of loops, 1 for the innermost
+ * @is_continue: 1 for continue, 0 for break
+ *
+ * Return: 0 on success, -1 when no loop is running
+ */
+int loop_control(int levels, int is_continue)
+{
+	if (rs.loops == 0)
+		return (-1);
+	if (levels > rs.loops)
+		levels = rs.loops;
+	if (is_continue)
+		rs.continuing = levels;
+	else
+		rs.breaking = levels;
+	return (0);
+}
+
+/**
+ * shell_return - Return from the running function
+ * @status: Status of the function
+ *
+ * Return: 0 on success, -1 when no function is running
+ */
+int shell_return(int status)
+{
+	if (rs.calls == 0)
+		return (-1);
+	rs.status = status;
+	rs.returning = 1;
+	return (0);
+}
+
+/**
+ * interrupted - Tell whether the commands being run must be skipped
+ *
+ * Return: 1 after exit, return, break or continue, 0 otherwise
+ */
+static int interrupted(void)
+{
+	return (rs.exiting || rs.returning || rs.breaking || rs.continuing);
+}
+
+/**
+ * loop_stop - Tell whether a loop must stop once its body ran
+ *
+ * Return: 1 if the loop must stop, 0 to go on with the next iteration
+ */
+static int loop_stop(void)
+{
+	if (rs.exiting || rs.returning)
+		return (1);
+	if (rs.breaking)
+	{
+		rs.breaking--;
+		return (1);
+	}
+	if (rs.continuing)
+	{
+		rs.continuing--;
+		return (rs.continuing > 0);
+	}
+	return (0);
+}
+
+/**
+ * eval_function - Run the body of a function being called
+ * @body: The body
+ * @program_name: Name of the shell program
+ * @line_count: Line of the call
+ *
+ * Loops of the caller cannot be broken out of from the function.
+ *
+ * Return: Status of the function
+ */
+int eval_function(node_t *body, char *program_name, int line_count)
+{
+	int loops = rs.loops, status;
+
+	rs.loops = 0;
+	rs.calls++;
+	status = eval_node(body, program_name, line_count);
+	rs.calls--;
+	rs.loops = loops;
+	rs.breaking = 0;
+	rs.continuing = 0;
+	rs.returning = 0;
+	return (status);
+}
+
+/**
+ * tail_command - Find the simple command a list ends with
+ * @node: First command of the list
+ *
+ * Follows the right side of && and || and the inside of { }, which run
+ * last when they run at all. Commands whose status is changed afterwards,
+ * or whose redirections are undone afterwards, are not tails.
+ *
+ * Return: The command, or NULL when the list does not end with one
+ */
+static node_t *tail_command(node_t *node)
+{
+	while (node && node->next)
+		node = node->next;
+	if (!node || node->redirs)
+		return (NULL);
+	if (node->type == NODE_AND || node->type == NODE_OR)
+		return (tail_command(node->right));
+	if (node->type == NODE_BRACE)
+		return (tail_command(node->left));
+	return (node->type == NODE_COMMAND ? node : NULL);
+}
+
+/**
+ * shell_set_tail - Let the last command of a tree replace the shell
+ * @root: The tree, the last the shell will run, or NULL to forget it
+ *
+ * Example:
+ *   hsh -c 'cd /tmp && exec-something' - exec-something replaces hsh
+ */
+void shell_set_tail(node_t *root)
+{
+	rs.tail = tail_command(root);
+}
+
+/**
+ * eval_simple - Run a simple command or a pipeline of simple commands
+ * @node: The command
+ * @program_name: Name of the shell program
+ * @line_count: Line of the command
+ *
+ * The words are expanded on every run; the parsed tokens are not touched.
+ * A command made only of assignments sets the variables without forking.
+ *
+ * Return: Status of the command
+ */
+static int eval_simple(node_t *node, char *program_name, int line_count)
+{
+	char ***tokens = expand_tokens(node->cmd);
+	int i, status = 0;
+
+	if (!tokens)
+		return (2);
+	if (tokens[0] && !tokens[1] && tokens[0][0])
+	{
+		for (i = 0; tokens[0][i] && var_name_length(tokens[0][i]) &&
+			tokens[0][i][var_name_length(tokens[0][i])] == '='; i++)
+			;
+		if (!tokens[0][i])
+		{
+			for (i = 0; tokens[0][i]; i++)
+				if (var_assign(tokens[0][i]) == -1)
+					status = 1;
+			free_tokens(tokens);
+			return (status);
+		}
+	}
+	status = execute_command(tokens, program_name, line_count,
+		node == rs.tail && rs.calls == 0 && rs.loops == 0 &&
+		!stats_exit_pending());
+	free_tokens(tokens);
+	return (status);
+}
+
+/**
+ * eval_fork - Run commands in a child process
+ * @node: The first command of the list to run
+ * @program_name: Name of the shell program
+ * @line_count: Line of the command
+ * @in: Descriptor to use as stdin, or -1
+ * @out: Descriptor to use as stdout, or -1
+ *
+ * Return: Process id of the child, or -1 on failure
+ */
+static pid_t eval_fork(node_t *node, char *program_name, int line_count,
+	int in, int out)
+{
+	pid_t pid;
+
+	out_flush_all();
+	input_sync_stdin();
+	path_index_refresh();
+	pid = fork();
+	if (pid == -1)
+	{
+		perror("fork");
+		return (-1);
+	}
+	if (pid != 0)
+		stats_add(STAT_FORKS, 1);
+	if (pid == 0)
+	{
+		if (in != -1)
+		{
+			input_stdin_moved();
+			dup2(in, STDIN_FILENO);
+		}
+		if (out != -1)
+			dup2(out, STDOUT_FILENO);
+		if (in != -1)
+			close(in);
+		if (out != -1)
+			close(out);
+		exit(eval_list(node, program_name, line_count));
+	}
+	return (pid);
+}
+
+/**
+ * eval_pipe - Run a pipe with a compound command on one side
+ * @node: The pipe
+ * @program_name: Name of the shell program
+ * @line_count: Line of the command
+ *
+ * Return: Status of the right side
+ */
+static int eval_pipe(node_t *node, char *program_name, int line_count)
+{
+	int fds[2], status = 1;
+	pid_t left, right;
+
+	if (pipe(fds) == -1)
+	{
+		perror("pipe");
+		return (1);
+	}
+	left = eval_fork(node->left, program_name, line_count, -1, fds[1]);
+	close(fds[1]);
+	right = eval_fork(node->right, program_name, line_count, fds[0], -1);
+	close(fds[0]);
+	if (left != -1)
+		stats_wait(left, NULL);
+	if (right != -1 && stats_wait(right, &status) != -1)
+		return (WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status));
+	return (1);
+}
+
+/**
+ * eval_loop - Run a while or until loop
+ * @node: The loop
+ * @program_name: Name of the shell program
+ * @line_count: Line of the command
+ *
+ * Return: Status of the last body run, 0 if it never ran
+ */
+static int eval_loop(node_t *node, char *program_name, int line_count)
+{
+	int status = 0, cond;
+
+	rs.loops++;
+	while (1)
+	{
+		cond = eval_list(node->left, program_name, line_count);
+		if (interrupted())
+		{
+			if (loop_stop())
+				break;
+			continue;
+		}
+		if ((cond == 0) != (node->type == NODE_WHILE))
+			break;
+		status = eval_list(node->right, program_name, line_count);
+		if (loop_stop())
+			break;
+	}
+	rs.loops--;
+	return (status);
+}
+
+/**
+ * eval_for - Run a for loop
+ * @node: The loop
+ * @program_name: Name of the shell program
+ * @line_count: Line of the command
+ *
+ * Return: Status of the last body run, 0 if it never ran
+ */
+static int eval_for(node_t *node, char *program_name, int line_count)
+{
+	dir_cache_t *cache = NULL;
+	char **words = expand_args(node->words, &cache);
+	int status = 0, i;
+
+	dir_cache_free(cache);
+	if (!words)
+		return (2);
+	rs.loops++;
+	for (i = 0; words[i]; i++)
+	{
+		var_set(node->name, words[i]);
+		status = eval_list(node->right, program_name, line_count);
+		if (loop_stop())
+			break;
+	}
+	rs.loops--;
+	for (i = 0; words[i]; i++)
+		free(words[i]);
+	free(words);
+	return (status);
+}
+
+/**
+ * case_pattern - Get the compiled form of a pattern of a case arm
+ * @arm: The arm
+ * @i: Index of the pattern
+ *
+ * The compiled pattern is kept on the arm, so a case in a loop compiles
+ * each pattern once; a pattern with parameters is compiled again only
+ * when their values change it.
+ *
+ * Return: The compiled pattern, or NULL on failure
+ */
+static pattern_t *case_pattern(case_arm_t *arm, int i)
+{
+	char *word = arm->patterns[i], *expanded;
+	pattern_t *p = arm->compiled[i];
+
+	/* Without parameters or a tilde, the pattern is the same on every run */
+	if (p && !_strchr(word, '$') && word[0] != '~')
+		return (p);
+	expanded = expand_string(word, EXPAND_PATTERN);
+	if (!expanded)
+		return (NULL);
+	if (!p || _strcmp(pattern_source(p), expanded) != 0)
+	{
+		pattern_free(p);
+		p = pattern_compile(expanded);
+		arm->compiled[i] = p;
+	}
+	free(expanded);
+	return (p);
+}
+
+/**
+ * eval_case - Run the first arm of a case command matching its word
+ * @node: The case command
+ * @program_name: Name of the shell program
+ * @line_count: Line of the command
+ *
+ * Return: Status of the arm run, 0 if none matched
+ */
+static int eval_case(node_t *node, char *program_name, int line_count)
+{
+	char *subject = expand_string(node->name, 0);
+	pattern_t *pattern;
+	case_arm_t *arm;
+	int i, match = 0;
+
+	if (!subject)
+		return (2);
+	for (arm = node->arms; arm && !match && !interrupted(); arm = arm->next)
+	{
+		for (i = 0; arm->patterns[i] && !match && !interrupted(); i++)
+		{
+			pattern = case_pattern(arm, i);
+			match = pattern && pattern_match(pattern, subject);
+		}
+		if (match)
+		{
+			free(subject);
+			return (eval_list(arm->body, program_name, line_count));
+		}
+	}
+	free(subject);
+	return (0);
+}
+
+/**
+ * eval_compound - Run a command that is not a simple command
+ * @node: The command
+ * @program_name: Name of the shell program
+ * @line_count: Line of the command
+ *
+ * Return: Status of the command
+ */
+static int eval_compound(node_t *node, char *program_name, int line_count)
+{
+	int status = 0;
+	pid_t pid;
+
+	switch (node->type)
+	{
+	case NODE_PIPE:
+		return (eval_pipe(node, program_name, line_count));
+	case NODE_AND:
+	case NODE_OR:
+		status = eval_node(node->left, program_name, line_count);
+		if (interrupted() || (status == 0) != (node->type == NODE_AND))
+			return (status);
+		return (eval_node(node->right, program_name, line_count));
+	case NODE_NOT:
+		return (!eval_node(node->left, program_name, line_count));
+	case NODE_BRACE:
+		return (eval_list(node->left, program_name, line_count));
+	case NODE_SUBSHELL:
+		pid = eval_fork(node->left, program_name, line_count, -1, -1);
+		if (pid == -1 || stats_wait(pid, &status) == -1)
+			return (1);
+		return (WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status));
+	case NODE_IF:
+		status = eval_list(node->left, program_name, line_count);
+		if (interrupted())
+			return (status);
+		if (status == 0)
+			return (eval_list(node->right, program_name, line_count));
+		return (node->alt ? eval_node(node->alt, program_name, line_count) : 0);
+	case NODE_WHILE:
+	case NODE_UNTIL:
+		return (eval_loop(node, program_name, line_count));
+	case NODE_FOR:
+		return (eval_for(node, program_name, line_count));
+	case NODE_CASE:
+		return (eval_case(node, program_name, line_count));
+	case NODE_FUNCTION:
+		return (func_define(node->name, node->left) == -1);
+	default:
+		return (eval_simple(node, program_name, line_count));
+	}
+}
+
+/**
+ * eval_node - Run one command of a tree
+ * @node: The command; its next commands are not run
+ * @program_name: Name of the shell program
+ * @line_count: Line of the command
+ *
+ * Redirections of a compound command apply to the whole command, in the
+ * shell itself.
+ *
+ * Example:
+ *   "while read l; do echo $l; done < file" - The loop reads from file
+ *
+ * Return: Status of the command
+ */
+int eval_node(node_t *node, char *program_name, int line_count)
+{
+	int mark = subst_mark();
+	redir_save_t saved;
+	char ***redirs = NULL;
+
+	if (!node)
+		return (0);
+	rs.line = line_count;
+	if (node->redirs)
+	{
+		redirs = expand_tokens(node->redirs);
+		if (!redirs ||
+			setup_redirections(redirs, 0, &saved, program_name, line_count) == -1)
+		{
+			if (redirs)
+				restore_redirections(&saved);
+			rs.status = redirs ? 1 : 2;
+			free_tokens(redirs);
+			subst_close(mark);
+			return (rs.status);
+		}
+	}
+	rs.status = eval_compound(node, program_name, line_count);
+	if (redirs)
+	{
+		restore_redirections(&saved);
+		free_tokens(redirs);
+	}
+	/* Process substitutions end with the command that named them */
+	subst_close(mark);
+	return (rs.status);
+}
+
+/**
+ * eval_list - Run a list of commands
+ * @node: First command of the list
+ * @program_name: Name of the shell program
+ * @line_count: Line of the command
+ *
+ * Return: Status of the last command run, 0 for an empty list
+ */
+int eval_list(node_t *node, char *program_name, int line_count)
+{
+	int status = 0;
+
+	for (; node && !interrupted(); node = node->next)
+		status = eval_node(node, program_name, line_count);
+	return (status);
+}
@@ -0,0 +1,604 @@
+#include "hsh.h"
+
+/**
+ * struct expand_s - Fields produced while expanding words
+ * @fields: Finished fields
+ * @count: Number of finished fields
+ * @cap: Allocated number of fields
+ * @buf: Field being built
+ * @len: Length of the field being built
+ * @size: Allocated size of the field being built
+ * @open: Set when the field being built exists, even if empty
+ * @flags: EXPAND_* flags
+ * @failed: Set when an allocation or an expansion failed
+ * @cache: Directories read by pathname expansion, for EXPAND_GLOB
+ */
+typedef struct expand_s
+{
+	char	**fields;
+	int		count;
+	int		cap;
+	char	*buf;
+	size_t	len;
+	size_t	size;
+	int		open;
+	int		flags;
+	int		failed;
+	dir_cache_t	**cache;
+} expand_t;
+
+/**
+ * expand_putc - Append a character to the field being built
+ * @e: The expansion
+ * @c: The character
+ * @quoted: Whether the character was quoted in the word
+ *
+ * In a pattern, quoted special characters and every backslash are escaped
+ * with a backslash so they only match themselves.
+ */
+static void expand_putc(expand_t *e, char c, int quoted)
+{
+	char *tmp;
+
+	if (e->len + 3 > e->size)
+	{
+		tmp = malloc(e->size ? e->size * 2 : 64);
+		if (!tmp)
+		{
+			e->failed = 1;
+			return;
+		}
+		if (e->buf)
+			memcpy(tmp, e->buf, e->len);
+		free(e->buf);
+		e->buf = tmp;
+		e->size = e->size ? e->size * 2 : 64;
+	}
+	if ((e->flags & (EXPAND_PATTERN | EXPAND_GLOB)) &&
+		((quoted && _strchr("*?[]", c)) || c == '\\'))
+		e->buf[e->len++] = '\\';
+	e->buf[e->len++] = c;
+	e->open = 1;
+}
+
+/**
+ * expand_push - Append a finished field
+ * @e: The expansion
+ * @field: The field, owned by the expansion from now on
+ */
+static void expand_push(expand_t *e, char *field)
+{
+	char **tmp;
+
+	if (e->count + 1 >= e->cap)
+	{
+		tmp = malloc(sizeof(char *) * (e->cap ? e->cap * 2 : 8));
+		if (!tmp)
+		{
+			free(field);
+			e->failed = 1;
+			return;
+		}
+		if (e->fields)
+			memcpy(tmp, e->fields, sizeof(char *) * e->count);
+		free(e->fields);
+		e->fields = tmp;
+		e->cap = e->cap ? e->cap * 2 : 8;
+	}
+	e->fields[e->count++] = field;
+	e->fields[e->count] = NULL;
+}
+
+/**
+ * expand_field - Finish the field being built
+ * @e: The expansion
+ *
+ * With EXPAND_GLOB, a field holding an unquoted pattern is replaced by the
+ * paths it matches, if any; otherwise its escapes are removed.
+ */
+static void expand_field(expand_t *e)
+{
+	char *field, **paths;
+	int i;
+
+	if (!e->open)
+		return;
+	if ((e->flags & EXPAND_GLOB) && e->buf)
+	{
+		e->buf[e->len] = '\0';
+		paths = glob_pattern(e->buf) ? glob_expand(e->buf, e->cache) : NULL;
+		if (paths)
+		{
+			for (i = 0; paths[i]; i++)
+				expand_push(e, paths[i]);
+			free(paths);
+			e->len = 0;
+			e->open = 0;
+			return;
+		}
+		e->len = glob_unescape(e->buf, e->len);
+	}
+	field = malloc(e->len + 1);
+	if (!field)
+	{
+		e->failed = 1;
+		return;
+	}
+	if (e->len)
+		memcpy(field, e->buf, e->len);
+	field[e->len] = '\0';
+	expand_push(e, field);
+	e->len = 0;
+	e->open = 0;
+}
+
+/**
+ * expand_value - Append the value of a parameter
+ * @e: The expansion
+ * @value: The value, may be NULL
+ * @quoted: Whether the parameter was inside double quotes
+ *
+ * Unquoted values are split into fields on blanks and newlines when the
+ * expansion splits fields.
+ */
+static void expand_value(expand_t *e, const char *value, int quoted)
+{
+	if (!value)
+		return;
+	for (; *value; value++)
+	{
+		if (!quoted && (e->flags & EXPAND_SPLIT) && _strchr(" \t\n", *value))
+			expand_field(e);
+		else
+			expand_putc(e, *value, quoted);
+	}
+}
+
+/**
+ * expand_positional - Append all positional parameters
+ * @e: The expansion
+ * @c: '@' or '*'
+ * @quoted: Whether the parameter was inside double quotes
+ *
+ * When fields are split, "$@" gives one field per parameter, and no field
+ * at all when there are none; "$*" joins them with spaces. Unquoted, both
+ * are split further. Without splitting, the parameters are joined.
+ */
+static void expand_positional(expand_t *e, char c, int quoted)
+{
+	int count, i;
+	char **args = positional_args(&count);
+
+	if (count == 0 && quoted && c == '@' && e->len == 0)
+		e->open = 0;
+	for (i = 0; i < count; i++)
+	{
+		if (i > 0 && (e->flags & EXPAND_SPLIT) && !(quoted && c == '*'))
+			expand_field(e);
+		else if (i > 0)
+			expand_putc(e, ' ', quoted);
+		if (quoted)
+			e->open = 1;
+		expand_value(e, args[i], quoted);
+	}
+}
+
+/**
+ * expand_arith - Expand an arithmetic expansion
+ * @e: The expansion
+ * @s: The "((" following the '$'
+ *
+ * Parameters in the expression are expanded first, then it is evaluated.
+ *
+ * Return: Pointer to the first character after the closing "))"
+ */
+static const char *expand_arith(expand_t *e, const char *s)
+{
+	const char *p, *error = "missing \"))\"";
+	char *expr = NULL, *value = NULL, num[24];
+	int depth = 0;
+	long n;
+
+	for (p = s + 2; *p; p++)
+	{
+		if (*p == '(')
+			depth++;
+		else if (*p == ')' && depth > 0)
+			depth--;
+		else if (*p == ')' && p[1] == ')')
+			break;
+	}
+	if (*p)
+	{
+		expr = malloc(p - s - 1);
+		if (!expr)
+		{
+			e->failed = 1;
+			return (p);
+		}
+		memcpy(expr, s + 2, p - s - 2);
+		expr[p - s - 2] = '\0';
+		value = expand_string(expr, 0);
+		if (value && arith_eval(value, &n, &error) == 0)
+		{
+			snprintf(num, sizeof(num), "%ld", n);
+			expand_value(e, num, 1);
+			free(expr);
+			free(value);
+			return (p + 2);
+		}
+	}
+	fprintf(stderr, "%s: %d: arithmetic expression: %s: \"%s\"\n",
+		shell_name(), shell_line(), error, value ? value : expr ? expr : s + 2);
+	free(expr);
+	free(value);
+	e->failed = 1;
+	shell_expand_error();
+	return (*p ? p + 2 : p);
+}
+
+/**
+ * expand_param - Expand the parameter following a '$'
+ * @e: The expansion
+ * @s: The characters after the '$'
+ * @quoted: Whether the '$' was inside double quotes
+ *
+ * Handles $name, ${name}, $?, $$, $#, $@, $*, $0 to $9, ${10} on and
+ * $((expression)). A '$' that does not start a parameter is kept as is,
+ * any other ${...} form is a bad substitution.
+ *
+ * Return: Pointer to the first character after the parameter
+ */
+static const char *expand_param(expand_t *e, const char *s, int quoted)
+{
+	char num[24], **args;
+	size_t len;
+	int braced = *s == '{', count, n;
+
+	if (s[0] == '(' && s[1] == '(')
+		return (expand_arith(e, s));
+	if (braced)
+		s++;
+	len = var_name_length(s);
+	if (len)
+		expand_value(e, var_lookup(s, len), quoted);
+	else if (*s == '?' || *s == '$' || *s == '#')
+	{
+		args = positional_args(&count);
+		snprintf(num, sizeof(num), "%d", *s == '?' ? shell_status() :
+			*s == '$' ? (int)shell_pid() : count);
+		expand_value(e, num, quoted);
+		len = 1;
+	}
+	else if (*s == '@' || *s == '*')
+	{
+		expand_positional(e, *s, quoted);
+		len = 1;
+	}
+	else if (*s >= '0' && *s <= '9')
+	{
+		/* Only braces allow more than one digit */
+		for (n = 0, len = 0; s[len] >= '0' && s[len] <= '9' &&
+			(braced || len == 0) && n < 100000; len++)
+			n = n * 10 + (s[len] - '0');
+		args = positional_args(&count);
+		expand_value(e, n == 0 ? shell_name() : n <= count ? args[n - 1] : NULL,
+			quoted);
+	}
+	else if (!braced)
+	{
+		expand_putc(e, '$', quoted);
+		return (s);
+	}
+	s += len;
+	if (braced && (len == 0 || *s != '}'))
+	{
+		/* Only ${name} and ${special} are supported, not ${name:-word} */
+		fprintf(stderr, "%s: %d: Bad substitution\n",
+			shell_name(), shell_line());
+		e->failed = 1;
+		shell_expand_error();
+		while (*s && *s != '}')
+			s++;
+		return (*s ? s + 1 : s);
+	}
+	return (braced ? s + 1 : s);
+}
+
+/**
+ * expand_subst - Expand a process substitution
+ * @e: The expansion
+ * @s: The "<(" or ">(" starting it
+ *
+ * The command is started at once and replaced by the /dev/fd path of its
+ * pipe, as a single quoted field.
+ *
+ * Return: Pointer to the character after the substitution
+ */
+static const char *expand_subst(expand_t *e, const char *s)
+{
+	const char *end = skip_subst(s);
+	char path[32], *command;
+	size_t len = end - s - 2 - (end[-1] == ')');
+	int fd = -1;
+
+	command = malloc(len + 1);
+	if (command)
+	{
+		memcpy(command, s + 2, len);
+		command[len] = '\0';
+		fd = subst_open(command, *s == '<');
+		free(command);
+	}
+	if (fd == -1)
+	{
+		e->failed = 1;
+		return (end);
+	}
+	sprintf(path, "/dev/fd/%d", fd);
+	expand_value(e, path, 1);
+	return (end);
+}
+
+/**
+ * expand_run - Expand one word into the fields being built
+ * @e: The expansion
+ * @word: The word, with its quotes
+ *
+ * Single quotes keep everything literal, double quotes keep everything but
+ * parameters literal, a backslash quotes the next character. A heredoc
+ * body only expands parameters and backslashes before '$', '`' or '\'.
+ * An unquoted <(command) or >(command) becomes a /dev/fd path.
+ */
+static void expand_run(expand_t *e, const char *word)
+{
+	int dquote = 0, heredoc = e->flags & EXPAND_HEREDOC;
+	const char *s = word;
+
+	/* A leading ~ names the home directory */
+	if (!heredoc && s[0] == '~' && (s[1] == '\0' || s[1] == '/'))
+	{
+		expand_value(e, var_get("HOME"), 1);
+		s++;
+	}
+	while (*s && !e->failed)
+	{
+		if (*s == '\'' && !dquote && !heredoc)
+		{
+			for (e->open = 1, s++; *s && *s != '\''; s++)
+				expand_putc(e, *s, 1);
+			if (*s)
+				s++;
+		}
+		else if (*s == '"' && !heredoc)
+		{
+			/* An empty "" is still a field, an empty "$@" is not */
+			dquote = !dquote;
+			if (dquote)
+				e->open = 1;
+			s++;
+		}
+		else if (*s == '\\' && s[1])
+		{
+			if ((dquote || heredoc) && !_strchr(heredoc ? "$`\\" : "$`\"\\", s[1]))
+				expand_putc(e, *s, 1);
+			expand_putc(e, s[1], 1);
+			s += 2;
+		}
+		else if (*s == '$')
+			s = expand_param(e, s + 1, dquote || heredoc);
+		else if ((*s == '<' || *s == '>') && s[1] == '(' && !dquote &&
+			!(e->flags & (EXPAND_HEREDOC | EXPAND_PATTERN)))
+			s = expand_subst(e, s);
+		else
+			expand_putc(e, *s++, dquote || heredoc);
+	}
+}
+
+/**
+ * expand_string - Expand a word into a single string
+ * @word: The word
+ * @flags: EXPAND_PATTERN or EXPAND_HEREDOC, fields are never split
+ *
+ * Example:
+ *   expand_string("\"$HOME\"/bin", 0)   - "/home/me/bin"
+ *   expand_string("'*'.c", EXPAND_PATTERN) - "\*.c"
+ *
+ * Return: Newly allocated string, or NULL on failure
+ */
+char *expand_string(const char *word, int flags)
+{
+	expand_t e = {NULL, 0, 0, NULL, 0, 0, 0, 0, 0, NULL};
+	char *result;
+
+	e.flags = flags & ~(EXPAND_SPLIT | EXPAND_GLOB);
+	expand_run(&e, word);
+	e.open = 1;
+	expand_field(&e);
+	free(e.buf);
+	if (e.failed)
+	{
+		while (e.count > 0)
+			free(e.fields[--e.count]);
+		free(e.fields);
+		return (NULL);
+	}
+	result = e.fields[0];
+	free(e.fields);
+	return (result);
+}
+
+/**
+ * expand_args - Expand the words of a command into its arguments
+ * @words: NULL-terminated words
+ * @cache: Directories read by pathname expansion, shared by the words of
+ * a command; NULL to leave patterns as they are
+ *
+ * Leading assignments are expanded without field splitting or pathname
+ * expansion.
+ *
+ * Example:
+ *   x="a b"; expand_args({"echo", "$x", "'$x'"}, NULL) - {"echo", "a", "b", "$x"}
+ *   expand_args({"ls", "*.c"}, &cache)                   - {"ls", "a.c", "b.c"}
+ *
+ * Return: Newly allocated NULL-terminated arguments, or NULL on failure
+ */
+char **expand_args(char **words, dir_cache_t **cache)
+{
+	expand_t e = {NULL, 0, 0, NULL, 0, 0, 0, 0, 0, NULL};
+	size_t len;
+	int i, assigning = 1;
+
+	e.cache = cache;
+	for (i = 0; words[i] && !e.failed; i++)
+	{
+		len = var_name_length(words[i]);
+		assigning = assigning && len && words[i][len] == '=';
+		e.flags = assigning ? 0 : EXPAND_SPLIT | (cache ? EXPAND_GLOB : 0);
+		expand_run(&e, words[i]);
+		expand_field(&e);
+	}
+	free(e.buf);
+	if (!e.failed && !e.fields)
+		e.fields = malloc(sizeof(char *));
+	if (e.failed || !e.fields)
+	{
+		while (e.count > 0)
+			free(e.fields[--e.count]);
+		free(e.fields);
+		return (NULL);
+	}
+	e.fields[e.count] = NULL;
+	return (e.fields);
+}
+
+/**
+ * is_redirection - Tell whether a segment is a redirection operator
+ * @segment: The segment
+ *
+ * Return: 1 if it is, 0 otherwise
+ */
+int is_redirection(char **segment)
+{
+	tok_kind_t kind;
+
+	if (!segment || !segment[0])
+		return (0);
+	kind = token_kind(segment[0]);
+	return (kind == TOK_IN || kind == TOK_HEREDOC || kind == TOK_OUT ||
+		kind == TOK_APPEND || kind == TOK_DUP_IN || kind == TOK_DUP_OUT);
+}
+
+/**
+ * copy_operator - Copy an operator segment
+ * @segment: The segment, with the descriptor number of a redirection
+ * after the operator
+ *
+ * The operator itself is shared, as operators are never freed.
+ *
+ * Return: Newly allocated segment, or NULL on failure
+ */
+static char **copy_operator(char **segment)
+{
+	char **copy;
+
+	copy = malloc(sizeof(char *) * 3);
+	if (!copy)
+		return (NULL);
+	copy[0] = segment[0];
+	copy[1] = NULL;
+	copy[2] = NULL;
+	if (segment[0] && segment[1])
+	{
+		copy[1] = _strdup(segment[1]);
+		if (!copy[1])
+		{
+			free(copy);
+			return (NULL);
+		}
+	}
+	return (copy);
+}
+
+/**
+ * expand_target - Expand a redirection target or heredoc segment
+ * @op: The redirection operator before it
+ * @segment: The target segment
+ *
+ * A heredoc segment holds the delimiter and the body; the body is expanded
+ * unless the delimiter was quoted.
+ *
+ * Return: Newly allocated segment, or NULL on failure
+ */
+static char **expand_target(const char *op, char **segment)
+{
+	char **copy;
+	int heredoc = token_kind(op) == TOK_HEREDOC;
+
+	copy = malloc(sizeof(char *) * 3);
+	if (!copy)
+		return (NULL);
+	copy[1] = NULL;
+	copy[2] = NULL;
+	copy[0] = heredoc ? _strdup(segment[0]) : expand_string(segment[0], 0);
+	if (copy[0] && heredoc && segment[1])
+	{
+		if (strpbrk(segment[0], "'\"\\"))
+			copy[1] = _strdup(segment[1]);
+		else
+			copy[1] = expand_string(segment[1], EXPAND_HEREDOC);
+		if (!copy[1])
+		{
+			free(copy[0]);
+			copy[0] = NULL;
+		}
+	}
+	if (!copy[0])
+	{
+		free(copy);
+		return (NULL);
+	}
+	return (copy);
+}
+
+/**
+ * expand_tokens - Expand every word of a command
+ * @tokens: Segments as produced by tokenize_command
+ *
+ * Commands are expanded with field splitting and pathname expansion,
+ * redirection targets into a single word, and operators are kept as they
+ * are, so the copy tells them from words the same way. A directory is read at most once for all the patterns of the
+ * command.
+ *
+ * Return: Newly allocated segments, to free with free_tokens, or NULL
+ */
+char ***expand_tokens(char ***tokens)
+{
+	dir_cache_t *cache = NULL;
+	char ***copy;
+	int n, i;
+
+	for (n = 0; tokens[n]; n++)
+		;
+	copy = malloc(sizeof(char **) * (n + 1));
+	if (!copy)
+		return (NULL);
+	for (i = 0; i < n; i++)
+	{
+		if (i > 0 && is_redirection(tokens[i - 1]))
+			copy[i] = expand_target(tokens[i - 1][0], tokens[i]);
+		else if (!tokens[i][0] || is_operator(tokens[i][0]))
+			copy[i] = copy_operator(tokens[i]);
+		else
+			copy[i] = expand_args(tokens[i], &cache);
+		if (!copy[i])
+		{
+			dir_cache_free(cache);
+			free_tokens(copy);
+			return (NULL);
+		}
+	}
+	dir_cache_free(cache);
+	copy[n] = NULL;
+	return (copy);
+}
@@ -0,0 +1,147 @@
+#include "hsh.h"
+
+#define FANOUT_CHUNK (64 * 1024)
+
+/**
+ * fanout_move - Move bytes waiting in a pipe to a file
+ * @from: Read end of the pipe
+ * @to: The file, or -1 to drop the bytes
+ * @len: Number of bytes to move
+ *
+ * splice moves the pages without copying them to user space. A file it
+ * cannot write to, such as a terminal or, on older kernels, a file opened
+ * for appending, gets a plain read and write. The bytes are consumed
+ * from the pipe even when writing fails, so every file stays in step.
+ */
+static void fanout_move(int from, int to, size_t len)
+{
+	char buf[4096];
+	ssize_t n;
+
+	while (len > 0)
+	{
+		n = to == -1 ? 0 : splice(from, NULL, to, NULL, len, SPLICE_F_MOVE);
+		if (n == -1 && errno == EINTR)
+			continue;
+		if (n <= 0)
+		{
+			n = read(from, buf, len < sizeof(buf) ? len : sizeof(buf));
+			if (n <= 0)
+				return;
+			if (to != -1)
+				write(to, buf, n);
+		}
+		len -= n;
+	}
+}
+
+/**
+ * fanout_loop - Copy everything written to a pipe into several files
+ * @in: Read end of the pipe
+ * @fds: The files
+ * @n: Number of files, from 2 to FANOUT_MAX
+ *
+ * Each round, tee duplicates the pages waiting in the pipe into one spare
+ * pipe per extra file, without consuming them; the spare pipes are
+ * spliced into their files, then the pipe itself into the first file.
+ * tee copies whole pages by reference, so no byte enters user space.
+ */
+static void fanout_loop(int in, int *fds, int n)
+{
+	int spare[FANOUT_MAX][2], i;
+	ssize_t len, copied[FANOUT_MAX];
+
+	for (i = 1; i < n; i++)
+		if (pipe(spare[i]) == -1)
+			return;
+	while (1)
+	{
+		len = tee(in, spare[1][1], FANOUT_CHUNK, 0);
+		if (len == -1 && errno == EINTR)
+			continue;
+		if (len <= 0)
+			break;
+		copied[1] = len;
+		for (i = 2; i < n; i++)
+		{
+			copied[i] = tee(in, spare[i][1], len, 0);
+			if (copied[i] == -1)
+				return;
+			if (copied[i] < len)
+				len = copied[i];
+		}
+		/* Bytes a spare pipe got beyond the others are teed again next round */
+		for (i = 1; i < n; i++)
+		{
+			fanout_move(spare[i][0], fds[i], len);
+			fanout_move(spare[i][0], -1, copied[i] - len);
+		}
+		fanout_move(in, fds[0], len);
+	}
+}
+
+/**
+ * fanout_start - Send stdout to several files at once
+ * @fds: The files, closed by this call
+ * @n: Number of files, from 2 to FANOUT_MAX
+ *
+ * stdout becomes a pipe read by a forked helper, which writes the stream
+ * to every file with tee and splice.
+ *
+ * Example:
+ *   cmd > all.log > copy.log   - Both files get the whole output
+ *
+ * Return: Process id of the helper, or -1 on failure
+ */
+pid_t fanout_start(int *fds, int n)
+{
+	int p[2], i;
+	pid_t pid;
+
+	if (pipe(p) == -1)
+		return (-1);
+	pid = fork();
+	if (pid == 0)
+	{
+		close(p[1]);
+		fanout_loop(p[0], fds, n);
+		_exit(0);
+	}
+	close(p[0]);
+	for (i = 0; i < n; i++)
+		close(fds[i]);
+	if (pid != -1)
+	{
+		stats_add(STAT_FORKS, 1);
+		dup2(p[1], STDOUT_FILENO);
+	}
+	close(p[1]);
+	return (pid);
+}
+
+/**
+ * fanout_detach - Stay until the files of a fan-out are written
+ * @helper: The fan-out helper
+ *
+ * Called in a child about to run a command whose stdout goes through a
+ * fan-out: the command goes on in a new process, and this one waits for
+ * it, then for the helper, and exits with the command's status. The shell
+ * waiting for this child thus finds the files complete.
+ */
+void fanout_detach(pid_t helper)
+{
+	int status, fd;
+	pid_t pid;
+
+	pid = fork();
+	if (pid <= 0)
+		return;
+	stats_add(STAT_FORKS, 1);
+	/* Any of them may be a copy of the pipe, as after "2>&1" */
+	for (fd = 0; fd < REDIR_FDS; fd++)
+		close(fd);
+	if (waitpid(pid, &status, 0) == -1)
+		status = 1 << 8;
+	waitpid(helper, NULL, 0);
+	_exit(WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status));
+}
@@ -0,0 +1,241 @@
+#include "hsh.h"
+
+#define FUNC_BUCKETS 64
+
+/**
+ * struct func_s - Shell function
+ * @sym: Interned name of the function
+ * @body: Compound command run by a call
+ * @script: Script holding the body and the tokens it points into
+ * @next: Next function in the same bucket
+ */
+typedef struct func_s
+{
+	int				sym;
+	node_t			*body;
+	script_t		*script;
+	struct func_s	*next;
+} func_t;
+
+/**
+ * struct args_frame_s - Positional parameters of a running function
+ * @argv: The parameters, $1 first
+ * @argc: Number of parameters, $#
+ * @up: Parameters of the caller
+ */
+typedef struct args_frame_s
+{
+	char				**argv;
+	int					argc;
+	struct args_frame_s	*up;
+} args_frame_t;
+
+static func_t *func_table[FUNC_BUCKETS];
+static script_t *current_script;
+static char *no_args[] = {NULL};
+static args_frame_t top_frame = {no_args, 0, NULL};
+static args_frame_t *args_frame = &top_frame;
+
+/**
+ * script_new - Wrap parsed commands and their tokens into a script
+ * @tokens: The tokens
+ * @root: The tree parsed from the tokens
+ *
+ * Return: The script, with one reference, or NULL on failure
+ */
+script_t *script_new(char ***tokens, node_t *root)
+{
+	script_t *script = malloc(sizeof(script_t));
+
+	if (!script)
+		return (NULL);
+	script->tokens = tokens;
+	script->root = root;
+	script->refs = 1;
+	return (script);
+}
+
+/**
+ * script_release - Drop a reference to a script
+ * @script: The script, may be NULL
+ *
+ * The tree and the tokens are freed with the last reference, so a
+ * function outlives the line that defined it.
+ */
+void script_release(script_t *script)
+{
+	if (!script || --script->refs > 0)
+		return;
+	node_free(script->root);
+	free_tokens(script->tokens);
+	free(script);
+}
+
+/**
+ * script_run - Run the commands of a script
+ * @script: The script
+ * @program_name: Name of the shell program
+ * @line_count: Line of the first command
+ *
+ * Functions defined while the script runs keep a reference to it.
+ *
+ * Return: Status of the last command
+ */
+int script_run(script_t *script, char *program_name, int line_count)
+{
+	script_t *caller = current_script;
+	int status;
+
+	current_script = script;
+	status = eval_list(script->root, program_name, line_count);
+	current_script = caller;
+	return (status);
+}
+
+/**
+ * func_find - Find a function
+ * @name: Name of the function
+ *
+ * Return: The function, or NULL if none has that name
+ */
+static func_t *func_find(const char *name)
+{
+	int sym = intern_find(name, _strlen(name));
+	func_t *f;
+
+	if (sym == -1)
+		return (NULL);
+	for (f = func_table[intern_hash_of(sym) % FUNC_BUCKETS]; f; f = f->next)
+		if (f->sym == sym)
+			return (f);
+	return (NULL);
+}
+
+/**
+ * func_define - Define or redefine a function
+ * @name: Name of the function
+ * @body: Compound command of the function, from the running script
+ *
+ * The body is not copied: the function keeps the running script alive.
+ *
+ * Return: 0 on success, -1 on failure
+ */
+int func_define(const char *name, node_t *body)
+{
+	func_t *f = func_find(name);
+	unsigned int h;
+	int sym;
+
+	if (!current_script)
+		return (-1);
+	current_script->refs++;
+	if (f)
+	{
+		script_release(f->script);
+		f->body = body;
+		f->script = current_script;
+		return (0);
+	}
+	sym = intern(name, _strlen(name));
+	f = sym == -1 ? NULL : malloc(sizeof(func_t));
+	if (!f)
+	{
+		script_release(current_script);
+		return (-1);
+	}
+	f->sym = sym;
+	f->body = body;
+	f->script = current_script;
+	h = intern_hash_of(sym) % FUNC_BUCKETS;
+	f->next = func_table[h];
+	func_table[h] = f;
+	return (0);
+}
+
+/**
+ * is_function - Tell whether a command name is a function
+ * @name: The command name
+ *
+ * Return: 1 if it is, 0 otherwise
+ */
+int is_function(const char *name)
+{
+	return (name && func_find(name) != NULL);
+}
+
+/**
+ * func_call - Call a function in the running shell
+ * @args: Name of the function followed by its arguments
+ * @program_name: Name of the shell program
+ * @line_count: Line of the call
+ *
+ * The arguments become the positional parameters and a scope is opened
+ * for local variables; both are dropped when the function returns.
+ *
+ * Example:
+ *   greet() { echo "hi $1"; }
+ *   func_call({"greet", "bob", NULL}, ...) - Prints "hi bob"
+ *
+ * Return: Status of the function, 127 if there is none with that name
+ */
+int func_call(char **args, char *program_name, int line_count)
+{
+	func_t *f = func_find(args[0]);
+	args_frame_t frame;
+	script_t *script, *caller = current_script;
+	int status;
+
+	if (!f)
+		return (127);
+	if (var_scope_push() == -1)
+		return (1);
+	frame.argv = args + 1;
+	for (frame.argc = 0; frame.argv[frame.argc]; frame.argc++)
+		;
+	frame.up = args_frame;
+	args_frame = &frame;
+
+	/* The function may redefine itself while it runs */
+	script = f->script;
+	script->refs++;
+	current_script = script;
+	status = eval_function(f->body, program_name, line_count);
+	current_script = caller;
+	script_release(script);
+
+	args_frame = frame.up;
+	var_scope_pop();
+	return (status);
+}
+
+/**
+ * positional_args - Get the positional parameters
+ * @count: Set to the number of parameters, $#
+ *
+ * Return: The parameters, $1 first, NULL-terminated
+ */
+char **positional_args(int *count)
+{
+	*count = args_frame->argc;
+	return (args_frame->argv);
+}
+
+/**
+ * func_free_all - Free every function
+ */
+void func_free_all(void)
+{
+	func_t *f, *next;
+	int i;
+
+	for (i = 0; i < FUNC_BUCKETS; i++)
+	{
+		for (f = func_table[i]; f; f = next)
+		{
+			next = f->next;
+			script_release(f->script);
+			free(f);
+		}
+		func_table[i] = NULL;
+	}
+}
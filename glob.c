@@ -0,0 +1,544 @@
+#include "hsh.h"
+
+#define GLOB_LITERAL 0
+#define GLOB_PATTERN 1
+
+#define GLOB_DIRBUF (256 * 1024)
+
+/**
+ * struct dirent64_s - Directory entry as returned by getdents64
+ * @d_ino: Inode number
+ * @d_off: Offset of the next entry
+ * @d_reclen: Size of this entry
+ * @d_type: Type of the file, DT_UNKNOWN if the filesystem does not say
+ * @d_name: Null-terminated name
+ */
+typedef struct dirent64_s
+{
+	uint64_t		d_ino;
+	int64_t			d_off;
+	unsigned short	d_reclen;
+	unsigned char	d_type;
+	char			d_name[];
+} dirent64_t;
+
+/**
+ * struct dir_cache_s - Listing of a directory read for pathname expansion
+ * @path: The directory, "" for the current one
+ * @names: Names of the entries, each null-terminated, one after the other
+ * @offsets: Offset of each name in names
+ * @types: d_type of each entry
+ * @count: Number of entries
+ * @cap: Allocated number of entries
+ * @names_len: Used size of names
+ * @names_cap: Allocated size of names
+ * @next: Next directory read by the same command
+ */
+struct dir_cache_s
+{
+	char				*path;
+	char				*names;
+	size_t				*offsets;
+	unsigned char		*types;
+	size_t				count;
+	size_t				cap;
+	size_t				names_len;
+	size_t				names_cap;
+	struct dir_cache_s	*next;
+};
+
+/**
+ * struct glob_part_s - Compiled component of a pattern
+ * @compiled: The compiled component, for GLOB_PATTERN
+ * @lit: The component without escapes, for GLOB_LITERAL
+ * @lit_len: Length of lit
+ * @kind: GLOB_LITERAL or GLOB_PATTERN
+ * @dot: Set when the component starts with a literal '.', and may match
+ * hidden names
+ */
+typedef struct glob_part_s
+{
+	pattern_t	*compiled;
+	char		*lit;
+	size_t		lit_len;
+	int			kind;
+	int			dot;
+} glob_part_t;
+
+/**
+ * struct glob_state_s - Pathname expansion of one pattern
+ * @parts: Compiled components
+ * @nparts: Number of components
+ * @dirs_only: Set when the pattern ends with '/'
+ * @cache: Directories already read by the command
+ * @path: Path being built
+ * @matches: Paths found
+ * @count: Number of paths found
+ * @cap: Allocated number of paths
+ * @failed: Set when an allocation failed
+ */
+typedef struct glob_state_s
+{
+	glob_part_t	*parts;
+	int			nparts;
+	int			dirs_only;
+	dir_cache_t	**cache;
+	char		path[PATH_MAX];
+	char		**matches;
+	size_t		count;
+	size_t		cap;
+	int			failed;
+} glob_state_t;
+
+/**
+ * glob_special - Find the next unescaped pattern character
+ * @s: The pattern, with backslash escapes
+ * @end: Where to stop looking
+ *
+ * A '[' only counts when a ']' closes it.
+ *
+ * Return: Pointer to the character, or NULL if there is none
+ */
+static const char *glob_special(const char *s, const char *end)
+{
+	const char *c;
+
+	for (; s < end && *s; s++)
+	{
+		if (*s == '\\' && s + 1 < end)
+			s++;
+		else if (*s == '*' || *s == '?')
+			return (s);
+		else if (*s == '[')
+		{
+			for (c = s + 1; c < end && *c && *c != ']'; c++)
+				;
+			if (c < end && *c == ']')
+				return (s);
+		}
+	}
+	return (NULL);
+}
+
+/**
+ * glob_pattern - Tell whether a word needs pathname expansion
+ * @word: The word, quoted pattern characters escaped with a backslash
+ *
+ * Return: 1 if it contains an unquoted '*', '?' or '[...]', 0 otherwise
+ */
+int glob_pattern(const char *word)
+{
+	return (glob_special(word, word + _strlen(word)) != NULL);
+}
+
+/**
+ * glob_unescape - Remove the backslash escapes of a pattern, in place
+ * @s: The pattern
+ * @len: Length of the pattern
+ *
+ * Return: Length of the result
+ */
+size_t glob_unescape(char *s, size_t len)
+{
+	size_t i, j;
+
+	for (i = 0, j = 0; i < len; i++, j++)
+	{
+		if (s[i] == '\\' && i + 1 < len)
+			i++;
+		s[j] = s[i];
+	}
+	s[j] = '\0';
+	return (j);
+}
+
+/**
+ * glob_compile - Split a pattern into compiled components
+ * @g: The expansion
+ * @pattern: The pattern, modified in place
+ *
+ * A component without pattern characters is looked up directly; others
+ * are compiled once and matched against every name of the directory.
+ *
+ * Return: 0 on success, -1 on failure
+ */
+static int glob_compile(glob_state_t *g, char *pattern)
+{
+	char *s, *slash;
+	glob_part_t *part;
+	int n = 1;
+
+	for (s = pattern; *s; s++)
+		n += *s == '/';
+	g->parts = malloc(sizeof(glob_part_t) * n);
+	if (!g->parts)
+		return (-1);
+	for (s = pattern; *s == '/'; s++)
+		;
+	g->nparts = 0;
+	while (*s)
+	{
+		slash = _strchr(s, '/');
+		if (slash)
+			*slash = '\0';
+		part = &g->parts[g->nparts++];
+		part->dot = s[0] == '.' || (s[0] == '\\' && s[1] == '.');
+		part->kind = GLOB_PATTERN;
+		part->lit = s;
+		part->lit_len = 0;
+		part->compiled = NULL;
+		if (!glob_special(s, s + _strlen(s)))
+		{
+			part->kind = GLOB_LITERAL;
+			part->lit_len = glob_unescape(s, _strlen(s));
+		}
+		else if (!(part->compiled = pattern_compile(s)))
+			return (-1);
+		if (!slash)
+			break;
+		for (s = slash + 1; *s == '/'; s++)
+			;
+		g->dirs_only = *s == '\0';
+	}
+	return (0);
+}
+
+/**
+ * glob_match - Match a name against a compiled component
+ * @part: The component
+ * @name: The name
+ *
+ * Return: 1 if it matches, 0 otherwise
+ */
+static int glob_match(glob_part_t *part, const char *name)
+{
+	if (name[0] == '.' && !part->dot)
+		return (0);
+	return (pattern_match(part->compiled, name));
+}
+
+/**
+ * dir_append - Append an entry to a directory listing
+ * @d: The listing
+ * @name: Name of the entry
+ * @type: d_type of the entry
+ *
+ * Return: 0 on success, -1 on failure
+ */
+static int dir_append(dir_cache_t *d, const char *name, unsigned char type)
+{
+	size_t len = _strlen(name) + 1;
+	char *names;
+	size_t *offsets;
+	unsigned char *types;
+
+	if (d->names_len + len > d->names_cap)
+	{
+		names = malloc((d->names_len + len) * 2);
+		if (!names)
+			return (-1);
+		if (d->names)
+			memcpy(names, d->names, d->names_len);
+		free(d->names);
+		d->names = names;
+		d->names_cap = (d->names_len + len) * 2;
+	}
+	if (d->count == d->cap)
+	{
+		offsets = malloc(sizeof(size_t) * (d->cap ? d->cap * 2 : 256));
+		types = malloc(d->cap ? d->cap * 2 : 256);
+		if (!offsets || !types)
+		{
+			free(offsets);
+			free(types);
+			return (-1);
+		}
+		if (d->count)
+		{
+			memcpy(offsets, d->offsets, sizeof(size_t) * d->count);
+			memcpy(types, d->types, d->count);
+		}
+		free(d->offsets);
+		free(d->types);
+		d->offsets = offsets;
+		d->types = types;
+		d->cap = d->cap ? d->cap * 2 : 256;
+	}
+	memcpy(d->names + d->names_len, name, len);
+	d->offsets[d->count] = d->names_len;
+	d->types[d->count++] = type;
+	d->names_len += len;
+	return (0);
+}
+
+/**
+ * dir_read - Read a whole directory with getdents64
+ * @path: The directory, "" for the current one
+ *
+ * Entries are read in large batches, straight into one block of names;
+ * "." and ".." are left out. An unreadable directory has no entries.
+ *
+ * Return: The listing, or NULL on failure
+ */
+static dir_cache_t *dir_read(const char *path)
+{
+	dir_cache_t *d = malloc(sizeof(dir_cache_t));
+	dirent64_t *ent;
+	char *buf;
+	long n, pos;
+	int fd, failed = 0;
+
+	if (!d)
+		return (NULL);
+	memset(d, 0, sizeof(dir_cache_t));
+	d->path = _strdup((char *)path);
+	buf = malloc(GLOB_DIRBUF);
+	if (!d->path || !buf)
+	{
+		free(buf);
+		dir_cache_free(d);
+		return (NULL);
+	}
+	fd = open(*path ? path : ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	while (fd != -1 && !failed &&
+		(n = syscall(SYS_getdents64, fd, buf, GLOB_DIRBUF)) > 0)
+	{
+		for (pos = 0; pos < n && !failed; pos += ent->d_reclen)
+		{
+			ent = (dirent64_t *)(buf + pos);
+			if (ent->d_name[0] == '.' && (!ent->d_name[1] ||
+				(ent->d_name[1] == '.' && !ent->d_name[2])))
+				continue;
+			failed = dir_append(d, ent->d_name, ent->d_type) == -1;
+		}
+	}
+	if (fd != -1)
+		close(fd);
+	free(buf);
+	if (failed)
+	{
+		dir_cache_free(d);
+		return (NULL);
+	}
+	return (d);
+}
+
+/**
+ * dir_get - Get the listing of a directory, reading it at most once
+ * @cache: Directories already read by the command
+ * @path: The directory
+ *
+ * Return: The listing, or NULL on failure
+ */
+static dir_cache_t *dir_get(dir_cache_t **cache, const char *path)
+{
+	dir_cache_t *d;
+
+	for (d = *cache; d; d = d->next)
+		if (_strcmp(d->path, path) == 0)
+			return (d);
+	d = dir_read(path);
+	if (!d)
+		return (NULL);
+	d->next = *cache;
+	*cache = d;
+	return (d);
+}
+
+/**
+ * dir_cache_free - Free the directories read by a command
+ * @cache: First directory, may be NULL
+ */
+void dir_cache_free(dir_cache_t *cache)
+{
+	dir_cache_t *next;
+
+	for (; cache; cache = next)
+	{
+		next = cache->next;
+		free(cache->path);
+		free(cache->names);
+		free(cache->offsets);
+		free(cache->types);
+		free(cache);
+	}
+}
+
+/**
+ * glob_add - Add the path being built to the matches
+ * @g: The expansion
+ */
+static void glob_add(glob_state_t *g)
+{
+	char **tmp;
+
+	if (g->count + 1 >= g->cap)
+	{
+		tmp = malloc(sizeof(char *) * (g->cap ? g->cap * 2 : 16));
+		if (!tmp)
+		{
+			g->failed = 1;
+			return;
+		}
+		if (g->matches)
+			memcpy(tmp, g->matches, sizeof(char *) * g->count);
+		free(g->matches);
+		g->matches = tmp;
+		g->cap = g->cap ? g->cap * 2 : 16;
+	}
+	/* A pattern ending with '/' only matches directories, and keeps it */
+	g->matches[g->count] = malloc(_strlen(g->path) + 2);
+	if (g->matches[g->count])
+	{
+		_strcpy(g->matches[g->count], g->path);
+		if (g->dirs_only)
+			_strcat(g->matches[g->count], "/");
+	}
+	if (!g->matches[g->count])
+		g->failed = 1;
+	else
+		g->count++;
+}
+
+/**
+ * glob_is_dir - Tell whether an entry is a directory
+ * @g: The expansion, with the entry's path built
+ * @type: d_type of the entry
+ *
+ * Only entries the filesystem cannot type, and symbolic links, are
+ * stat'ed.
+ *
+ * Return: 1 if it is, 0 otherwise
+ */
+static int glob_is_dir(glob_state_t *g, unsigned char type)
+{
+	struct stat st;
+
+	if (type == DT_DIR)
+		return (1);
+	if (type != DT_UNKNOWN && type != DT_LNK)
+		return (0);
+	return (stat(g->path, &st) == 0 && S_ISDIR(st.st_mode));
+}
+
+/**
+ * glob_walk - Match the components of a pattern from a directory
+ * @g: The expansion
+ * @len: Length of the directory path built so far
+ * @i: Index of the component to match
+ */
+static void glob_walk(glob_state_t *g, size_t len, int i)
+{
+	glob_part_t *part = &g->parts[i];
+	int last = i == g->nparts - 1;
+	dir_cache_t *d;
+	size_t k, name_len;
+	const char *name;
+	struct stat st;
+
+	if (part->kind == GLOB_LITERAL)
+	{
+		if (len + part->lit_len + 2 > sizeof(g->path))
+			return;
+		memcpy(g->path + len, part->lit, part->lit_len + 1);
+		if (!last)
+		{
+			g->path[len + part->lit_len] = '/';
+			g->path[len + part->lit_len + 1] = '\0';
+			glob_walk(g, len + part->lit_len + 1, i + 1);
+		}
+		else if (g->dirs_only ? stat(g->path, &st) == 0 && S_ISDIR(st.st_mode) :
+			lstat(g->path, &st) == 0)
+			glob_add(g);
+		return;
+	}
+
+	g->path[len] = '\0';
+	d = dir_get(g->cache, g->path);
+	for (k = 0; d && k < d->count && !g->failed; k++)
+	{
+		name = d->names + d->offsets[k];
+		name_len = _strlen(name);
+		if (!glob_match(part, name) ||
+			len + name_len + 2 > sizeof(g->path))
+			continue;
+		memcpy(g->path + len, name, name_len + 1);
+		if (last && !g->dirs_only)
+			glob_add(g);
+		else if (glob_is_dir(g, d->types[k]))
+		{
+			if (last)
+				glob_add(g);
+			else
+			{
+				g->path[len + name_len] = '/';
+				g->path[len + name_len + 1] = '\0';
+				glob_walk(g, len + name_len + 1, i + 1);
+			}
+		}
+	}
+}
+
+/**
+ * glob_compare - Compare two paths byte by byte, for qsort
+ * @a: Pointer to the first path
+ * @b: Pointer to the second path
+ *
+ * Return: Negative, zero or positive, as strcmp
+ */
+static int glob_compare(const void *a, const void *b)
+{
+	return (_strcmp(*(char *const *)a, *(char *const *)b));
+}
+
+/**
+ * glob_expand - Expand a pattern into the paths it matches
+ * @pattern: The pattern, quoted pattern characters escaped with a backslash
+ * @cache: Directories already read by the command, updated
+ *
+ * Directories are read once per command, whatever the number of patterns
+ * walking them. Only the last component is matched without any stat.
+ *
+ * Example:
+ *   glob_expand("src/?.c", &cache) - {"src/a.c", "src/b.c", NULL}
+ *
+ * Return: Newly allocated sorted paths, NULL when nothing matches or on
+ * failure
+ */
+char **glob_expand(const char *pattern, dir_cache_t **cache)
+{
+	glob_state_t *g = malloc(sizeof(glob_state_t));
+	char *copy = _strdup((char *)pattern), **matches = NULL;
+
+	if (!g || !copy)
+	{
+		free(g);
+		free(copy);
+		return (NULL);
+	}
+	memset(g, 0, sizeof(glob_state_t));
+	g->cache = cache;
+	if (glob_compile(g, copy) == 0 && g->nparts > 0)
+	{
+		g->path[0] = pattern[0] == '/' ? '/' : '\0';
+		glob_walk(g, pattern[0] == '/', 0);
+	}
+	if (g->failed || !g->count)
+	{
+		while (g->count > 0)
+			free(g->matches[--g->count]);
+		free(g->matches);
+	}
+	else
+	{
+		qsort(g->matches, g->count, sizeof(char *), glob_compare);
+		g->matches[g->count] = NULL;
+		matches = g->matches;
+	}
+	while (g->parts && g->nparts > 0)
+		pattern_free(g->parts[--g->nparts].compiled);
+	free(g->parts);
+	free(copy);
+	free(g);
+	return (matches);
+}
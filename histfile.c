@@ -0,0 +1,213 @@
+#include "hsh.h"
+
+/**
+ * struct hist_file_s - Persistent history file
+ * @fd: Descriptor opened with O_APPEND, -1 when persistence is off
+ * @pos: Offset below which lines have not been loaded yet
+ * @chunk: Buffer used to read the file backwards
+ */
+typedef struct hist_file_s
+{
+	int		fd;
+	off_t	pos;
+	char	*chunk;
+} hist_file_t;
+
+static hist_file_t hfile = {-1, 0, NULL};
+
+/**
+ * hist_file_path - Build the path of the history file
+ * @buf: Buffer receiving the path
+ * @size: Size of the buffer
+ *
+ * HISTFILE is used when set; an empty HISTFILE turns persistence off.
+ * Otherwise the file is ~/.hsh_history.
+ *
+ * Return: 0 on success, -1 if no history file should be used
+ */
+static int hist_file_path(char *buf, size_t size)
+{
+	char *histfile = _getenv("HISTFILE"), *home;
+
+	if (histfile)
+	{
+		if (!*histfile || (size_t)_strlen(histfile) >= size)
+			return (-1);
+		_strcpy(buf, histfile);
+		return (0);
+	}
+
+	home = _getenv("HOME");
+	if (!home || !*home)
+		return (-1);
+	if (snprintf(buf, size, "%s/.hsh_history", home) >= (int)size)
+		return (-1);
+	return (0);
+}
+
+/**
+ * hist_file_open - Open the history file and load its tail
+ *
+ * Only the last HIST_CHUNK bytes are read, whatever the size of the file.
+ * Older lines are read on demand by hist_file_load.
+ *
+ * Example:
+ *   HISTFILE=/tmp/h ./hsh   - Lines typed are appended to /tmp/h
+ *
+ * Return: 0 on success, -1 if history is not persisted
+ */
+int hist_file_open(void)
+{
+	char path[PATH_MAX];
+
+	if (hfile.fd != -1)
+		return (0);
+	if (hist_file_path(path, sizeof(path)) == -1)
+		return (-1);
+
+	hfile.fd = redirect_reserve(open(path, O_RDWR | O_APPEND | O_CREAT |
+		O_CLOEXEC, 0600));
+	if (hfile.fd == -1)
+		return (-1);
+	hfile.pos = lseek(hfile.fd, 0, SEEK_END);
+	if (hfile.pos == -1)
+		hfile.pos = 0;
+
+	hist_file_load();
+	return (0);
+}
+
+/**
+ * hist_file_append - Append one line to the history file
+ * @line: The line
+ * @len: Length of the line
+ *
+ * The line and its newline go out in a single writev on an O_APPEND
+ * descriptor, so concurrent shells never interleave partial lines.
+ */
+void hist_file_append(const char *line, size_t len)
+{
+	struct iovec iov[2];
+
+	if (hfile.fd == -1)
+		return;
+
+	iov[0].iov_base = (void *)line;
+	iov[0].iov_len = len;
+	iov[1].iov_base = "\n";
+	iov[1].iov_len = 1;
+	writev(hfile.fd, iov, 2);
+}
+
+/**
+ * hist_file_skip - Find the start of a line longer than a block
+ * @pos: Offset inside the line
+ *
+ * Blocks are read backwards from pos until a newline shows up.
+ *
+ * Return: Offset just after that newline, 0 if the line starts the file,
+ * -1 on a read error
+ */
+static off_t hist_file_skip(off_t pos)
+{
+	off_t start;
+	ssize_t got;
+	char *nl;
+
+	while (pos > 0)
+	{
+		start = pos > HIST_CHUNK ? pos - HIST_CHUNK : 0;
+		got = pread(hfile.fd, hfile.chunk, pos - start, start);
+		if (got <= 0)
+			return (-1);
+		nl = memrchr(hfile.chunk, '\n', got);
+		if (nl)
+			return (start + (nl - hfile.chunk) + 1);
+		pos = start;
+	}
+	return (0);
+}
+
+/**
+ * hist_file_load - Load the next block of older lines
+ *
+ * Reads at most HIST_CHUNK bytes ending at the load position, and prepends
+ * every complete line to the history ring, newest first. A line cut by the
+ * start of the block is left for the next call; a line longer than a whole
+ * block is skipped, as it could never be loaded whole. The newline ending
+ * the block belongs to its last line, so it does not mark a cut.
+ *
+ * Return: Number of lines loaded, 0 when nothing is left
+ */
+int hist_file_load(void)
+{
+	off_t start;
+	ssize_t got;
+	char *end, *line, *nl;
+	int loaded = 0;
+
+	if (hfile.fd == -1 || hfile.pos <= 0)
+		return (0);
+	if (!hfile.chunk)
+	{
+		hfile.chunk = malloc(HIST_CHUNK);
+		if (!hfile.chunk)
+			return (0);
+	}
+
+	start = hfile.pos > HIST_CHUNK ? hfile.pos - HIST_CHUNK : 0;
+	got = pread(hfile.fd, hfile.chunk, hfile.pos - start, start);
+	if (got <= 0)
+	{
+		hfile.pos = 0;
+		return (0);
+	}
+
+	line = hfile.chunk;
+	end = hfile.chunk + got;
+	/* Skip the partial line at the start of the block, past its newline */
+	if (start > 0)
+	{
+		nl = memchr(line, '\n', got - 1);
+		if (!nl)
+		{
+			hfile.pos = hist_file_skip(start);
+			return (hist_file_load());
+		}
+		line = nl + 1;
+	}
+	hfile.pos = start + (line - hfile.chunk);
+
+	/* Walk the block backwards, one line at a time */
+	if (end > line && end[-1] == '\n')
+		end--;
+	while (end > line)
+	{
+		nl = memrchr(line, '\n', end - line);
+		nl = nl ? nl + 1 : line;
+		if (end > nl)
+		{
+			if (hist_prepend(nl, end - nl) == -1)
+			{
+				hfile.pos = 0;
+				break;
+			}
+			loaded++;
+		}
+		end = nl > line ? nl - 1 : line;
+	}
+	return (loaded ? loaded : hist_file_load());
+}
+
+/**
+ * hist_file_close - Close the history file
+ */
+void hist_file_close(void)
+{
+	if (hfile.fd != -1)
+		close(hfile.fd);
+	free(hfile.chunk);
+	hfile.fd = -1;
+	hfile.pos = 0;
+	hfile.chunk = NULL;
+}
@@ -0,0 +1,322 @@
+#include "hsh.h"
+
+/**
+ * struct hist_entry_s - One history line inside the arena
+ * @off: Offset of the line in the arena
+ * @len: Length of the line, without the terminating null byte
+ * @mask: Bitmask of the characters present in the line
+ */
+typedef struct hist_entry_s
+{
+	uint32_t	off;
+	uint32_t	len;
+	uint64_t	mask;
+} hist_entry_t;
+
+/**
+ * struct hist_s - Fixed-size history ring
+ * @ent: Ring of entries, HIST_MAX slots
+ * @arena: Ring of line bytes, HIST_ARENA bytes
+ * @first: Slot of the oldest entry
+ * @count: Number of live entries
+ * @head_off: Arena offset of the oldest line
+ * @tail_off: Arena offset one past the newest line
+ * @sealed: Set once a line was evicted, older lines can no longer be added
+ *
+ * Both rings are anonymous mappings, so untouched pages cost nothing until
+ * history actually grows into them.
+ */
+typedef struct hist_s
+{
+	hist_entry_t	*ent;
+	char			*arena;
+	size_t			first;
+	size_t			count;
+	size_t			head_off;
+	size_t			tail_off;
+	int				sealed;
+} hist_t;
+
+static hist_t hist;
+
+/**
+ * hist_char_bit - Map a character to its bit in an entry mask
+ * @c: The character
+ *
+ * Return: A 64-bit value with exactly one bit set
+ */
+static uint64_t hist_char_bit(unsigned char c)
+{
+	return (1ULL << (((uint32_t)c * 0x9E3779B1u) >> 26));
+}
+
+/**
+ * hist_mask - Compute the character mask of a string
+ * @s: The string
+ * @len: Length of the string
+ *
+ * Return: The OR of the bits of every character in s
+ */
+static uint64_t hist_mask(const char *s, size_t len)
+{
+	uint64_t mask = 0;
+	size_t i;
+
+	for (i = 0; i < len; i++)
+		mask |= hist_char_bit((unsigned char)s[i]);
+	return (mask);
+}
+
+/**
+ * hist_init - Map the entry ring and the line arena on first use
+ *
+ * Return: 0 on success, -1 on failure
+ */
+static int hist_init(void)
+{
+	if (hist.ent)
+		return (0);
+
+	hist.ent = mmap(NULL, sizeof(hist_entry_t) * HIST_MAX,
+		PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (hist.ent == MAP_FAILED)
+	{
+		hist.ent = NULL;
+		return (-1);
+	}
+	hist.arena = mmap(NULL, HIST_ARENA, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (hist.arena == MAP_FAILED)
+	{
+		munmap(hist.ent, sizeof(hist_entry_t) * HIST_MAX);
+		hist.ent = NULL;
+		hist.arena = NULL;
+		return (-1);
+	}
+	return (0);
+}
+
+/**
+ * hist_evict - Drop the oldest entry of the ring
+ */
+static void hist_evict(void)
+{
+	hist.sealed = 1;
+	hist.first = (hist.first + 1) % HIST_MAX;
+	hist.count--;
+	if (hist.count == 0)
+	{
+		hist.head_off = 0;
+		hist.tail_off = 0;
+		return;
+	}
+	hist.head_off = hist.ent[hist.first].off;
+}
+
+/**
+ * hist_fits - Check that an arena range does not overlap live lines
+ * @a: Start offset of the range
+ * @n: Size of the range
+ *
+ * A one-byte gap is always kept in front of the oldest line so that a full
+ * ring can never be mistaken for an empty one.
+ *
+ * Return: 1 if the range is free, 0 otherwise
+ */
+static int hist_fits(size_t a, size_t n)
+{
+	if (a + n > HIST_ARENA)
+		return (0);
+	if (hist.count == 0)
+		return (1);
+	/* Live bytes are [head, tail) */
+	if (hist.tail_off > hist.head_off)
+		return (a >= hist.tail_off || a + n < hist.head_off);
+	/* Live bytes wrap: [head, end) and [0, tail) */
+	return (a >= hist.tail_off && a + n < hist.head_off);
+}
+
+/**
+ * hist_add - Append a line to the history ring
+ * @line: The line to remember
+ *
+ * Empty lines and repeats of the newest entry are ignored. When the ring
+ * is full the oldest entries are evicted to make room.
+ *
+ * Example:
+ *   hist_add("ls -l");
+ *   hist_get(0) now returns "ls -l"
+ *
+ * Return: 0 on success, -1 on failure
+ */
+int hist_add(const char *line)
+{
+	size_t len, n, a, slot;
+	const char *newest;
+
+	if (!line || !*line || hist_init() == -1)
+		return (-1);
+
+	len = _strlen(line);
+	n = len + 1;
+	if (n > HIST_ARENA / 4)
+		return (-1);
+
+	newest = hist_get(0);
+	if (newest && _strcmp(newest, line) == 0)
+		return (0);
+
+	if (hist.count == HIST_MAX)
+		hist_evict();
+
+	/* Place the line after the newest one, wrapping to the start */
+	a = hist.tail_off;
+	if (a + n > HIST_ARENA)
+		a = 0;
+	while (hist.count && !hist_fits(a, n))
+		hist_evict();
+	if (hist.count == 0)
+		a = 0;
+
+	memcpy(hist.arena + a, line, n);
+	slot = (hist.first + hist.count) % HIST_MAX;
+	hist.ent[slot].off = a;
+	hist.ent[slot].len = len;
+	hist.ent[slot].mask = hist_mask(line, len);
+	hist.count++;
+	hist.tail_off = a + n;
+	hist.head_off = hist.ent[hist.first].off;
+	hist_file_append(line, len);
+	return (0);
+}
+
+/**
+ * hist_prepend - Insert a line older than every line in the ring
+ * @line: The line
+ * @len: Length of the line
+ *
+ * Used when loading older lines from the history file. Nothing is evicted:
+ * once the ring is full, older lines are simply refused.
+ *
+ * Return: 0 on success, -1 if there is no room left
+ */
+int hist_prepend(const char *line, size_t len)
+{
+	size_t n = len + 1, a;
+
+	if (len == 0 || hist.sealed || hist.count == HIST_MAX ||
+		n > HIST_ARENA / 4 || hist_init() == -1)
+		return (-1);
+
+	if (hist.count == 0)
+		a = 0;
+	else if (hist.head_off >= n && (hist.tail_off > hist.head_off ||
+		hist.head_off - n > hist.tail_off))
+		a = hist.head_off - n;
+	else if (hist.tail_off > hist.head_off && HIST_ARENA - n > hist.tail_off)
+		a = HIST_ARENA - n;
+	else
+		return (-1);
+
+	memcpy(hist.arena + a, line, len);
+	hist.arena[a + len] = '\0';
+	hist.first = (hist.first + HIST_MAX - 1) % HIST_MAX;
+	hist.ent[hist.first].off = a;
+	hist.ent[hist.first].len = len;
+	hist.ent[hist.first].mask = hist_mask(line, len);
+	if (hist.count == 0)
+		hist.tail_off = n;
+	hist.count++;
+	hist.head_off = a;
+	return (0);
+}
+
+/**
+ * hist_count - Get the number of lines in the history
+ *
+ * Return: The number of entries currently held
+ */
+int hist_count(void)
+{
+	return ((int)hist.count);
+}
+
+/**
+ * hist_get - Get a history line by age
+ * @age: 0 for the newest line, 1 for the one before, and so on
+ *
+ * Older lines are pulled from the history file when age goes past the
+ * oldest line in memory.
+ *
+ * Return: Pointer to the line inside the arena, or NULL if out of range
+ */
+const char *hist_get(int age)
+{
+	size_t slot;
+
+	if (age < 0)
+		return (NULL);
+	while ((size_t)age >= hist.count)
+		if (hist_file_load() <= 0)
+			return (NULL);
+
+	slot = (hist.first + hist.count - 1 - age) % HIST_MAX;
+	return (hist.arena + hist.ent[slot].off);
+}
+
+/**
+ * hist_search - Find the newest line containing a substring
+ * @query: The substring to look for
+ * @from: Age to start searching from
+ *
+ * The character mask of each entry rejects most lines without touching
+ * their bytes, so the scan stays interactive on a full ring.
+ *
+ * Example:
+ *   age = hist_search("make", 0);
+ *   age = hist_search("make", age + 1);   - next older match
+ *
+ * Return: Age of the matching line, or -1 if none matches
+ */
+int hist_search(const char *query, int from)
+{
+	size_t qlen, age, slot;
+	uint64_t qmask;
+	hist_entry_t *e;
+
+	if (!query || from < 0)
+		return (-1);
+
+	qlen = _strlen(query);
+	qmask = hist_mask(query, qlen);
+	for (age = from; age < hist.count ||
+		(age == hist.count && hist_file_load() > 0); age++)
+	{
+		slot = (hist.first + hist.count - 1 - age) % HIST_MAX;
+		e = &hist.ent[slot];
+		if ((e->mask & qmask) != qmask || e->len < qlen)
+			continue;
+		if (memmem(hist.arena + e->off, e->len, query, qlen))
+			return ((int)age);
+	}
+	return (-1);
+}
+
+/**
+ * hist_free - Release the history ring
+ */
+void hist_free(void)
+{
+	hist_file_close();
+	if (!hist.ent)
+		return;
+	munmap(hist.ent, sizeof(hist_entry_t) * HIST_MAX);
+	munmap(hist.arena, HIST_ARENA);
+	hist.ent = NULL;
+	hist.arena = NULL;
+	hist.first = 0;
+	hist.count = 0;
+	hist.head_off = 0;
+	hist.tail_off = 0;
+	hist.sealed = 0;
+}
@@ -1,20 +1,55 @@
 #ifndef HSH_H
 #define HSH_H
 
+#define _GNU_SOURCE
+
+#include <ctype.h>
+#include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <pthread.h>
 #include <signal.h>
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <sys/file.h>
+#include <sys/inotify.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
 #include <stddef.h>
 #include <sys/types.h>
+#include <sys/uio.h>
+#include <sys/un.h>
 #include <sys/wait.h>
+#include <termios.h>
+#include <time.h>
 #include <unistd.h>
 
 #define PATH_MAX 4096
 #define MAX_TOKENS 64
+#define HIST_MAX 100000
+#define HIST_ARENA (16 * 1024 * 1024)
+#define HIST_CHUNK (64 * 1024)
+#define INPUT_BUF (64 * 1024)
+#define FANOUT_MAX 16
+#define REDIR_FDS 10
+#define REDIR_CLOSED (-2)
+
+#define PARSE_OK 0
+#define PARSE_INCOMPLETE 1
+#define PARSE_ERROR 2
+
+#define EXPAND_SPLIT 1
+#define EXPAND_PATTERN 2
+#define EXPAND_HEREDOC 4
+#define EXPAND_GLOB 8
 
 extern char **environ;
 
@@ -22,31 +57,433 @@ extern char **environ;
  * struct prompt_s - Structure to hold command information
  * @input: The input string for the command
  * @size: The size of the input string
+ * @capacity: The allocated size of the input buffer
  * @line_count: The number of lines in the input
  */
 typedef struct prompt_s
 {
 	char	*input;
 	int		size;
+	size_t	capacity;
 	int		line_count;
 } prompt_t;
 
+/**
+ * struct input_s - Buffered reader on a file descriptor
+ * @fd: The file descriptor
+ * @buf: Read buffer
+ * @cap: Size of the read buffer
+ * @start: Offset of the first unconsumed byte
+ * @end: Offset one past the last buffered byte
+ * @eof: Set once the descriptor reported end of input
+ * @seekable: Set when unconsumed bytes can be given back with lseek
+ * @bytewise: Set to read one byte at a time, leaving what follows the line
+ * to whoever reads the descriptor next
+ * @dev: Device of the file read, to know it again
+ * @ino: Inode of the file read
+ */
+typedef struct input_s
+{
+	int		fd;
+	char	*buf;
+	size_t	cap;
+	size_t	start;
+	size_t	end;
+	int		eof;
+	int		seekable;
+	int		bytewise;
+	dev_t	dev;
+	ino_t	ino;
+} input_t;
+
+/**
+ * struct source_s - Where the commands of the shell are read from
+ * @in: Reader of a file, a string or stdin, used when prompt is NULL
+ * @prompt: Prompt of an interactive shell, or NULL
+ * @line_count: Number of lines read so far
+ * @last: Set when the shell ends with this source, so its final simple
+ * command may replace the shell instead of running in a child
+ */
+typedef struct source_s
+{
+	input_t		*in;
+	prompt_t	*prompt;
+	int			line_count;
+	int			last;
+} source_t;
+
+/**
+ * enum node_type_e - Kinds of commands in a parsed tree
+ * @NODE_COMMAND: Simple commands, possibly joined by pipes
+ * @NODE_PIPE: Pipe with a compound command on one side
+ * @NODE_AND: left && right
+ * @NODE_OR: left || right
+ * @NODE_NOT: ! left
+ * @NODE_BRACE: { left; }
+ * @NODE_SUBSHELL: ( left )
+ * @NODE_IF: if left; then right; else alt; fi
+ * @NODE_WHILE: while left; do right; done
+ * @NODE_UNTIL: until left; do right; done
+ * @NODE_FOR: for name in words; do right; done
+ * @NODE_CASE: case name in arms; esac
+ * @NODE_FUNCTION: name() left
+ */
+typedef enum node_type_e
+{
+	NODE_COMMAND,
+	NODE_PIPE,
+	NODE_AND,
+	NODE_OR,
+	NODE_NOT,
+	NODE_BRACE,
+	NODE_SUBSHELL,
+	NODE_IF,
+	NODE_WHILE,
+	NODE_UNTIL,
+	NODE_FOR,
+	NODE_CASE,
+	NODE_FUNCTION
+} node_type_t;
+
+/**
+ * enum tok_kind_e - Kinds of tokens
+ * @TOK_WORD: Not an operator: a word
+ * @TOK_PIPE: |
+ * @TOK_OR: ||
+ * @TOK_BACKGROUND: &
+ * @TOK_AND: &&
+ * @TOK_SEMI: ;
+ * @TOK_DSEMI: ;;
+ * @TOK_IN: <
+ * @TOK_HEREDOC: <<
+ * @TOK_OUT: >
+ * @TOK_APPEND: >>
+ * @TOK_DUP_IN: <&
+ * @TOK_DUP_OUT: >&
+ * @TOK_LPAREN: (
+ * @TOK_RPAREN: )
+ * @TOK_NEWLINE: End of a line
+ * @TOK_COUNT: Number of kinds
+ */
+typedef enum tok_kind_e
+{
+	TOK_WORD,
+	TOK_PIPE,
+	TOK_OR,
+	TOK_BACKGROUND,
+	TOK_AND,
+	TOK_SEMI,
+	TOK_DSEMI,
+	TOK_IN,
+	TOK_HEREDOC,
+	TOK_OUT,
+	TOK_APPEND,
+	TOK_DUP_IN,
+	TOK_DUP_OUT,
+	TOK_LPAREN,
+	TOK_RPAREN,
+	TOK_NEWLINE,
+	TOK_COUNT
+} tok_kind_t;
+
+struct node_s;
+
+/* Compiled shell pattern, private to pattern.c */
+typedef struct pattern_s pattern_t;
+
+/**
+ * struct case_arm_s - One arm of a case command
+ * @patterns: NULL-terminated patterns, pointing into the tokens
+ * @compiled: Each pattern as last expanded and compiled, or NULL
+ * @body: Commands run when a pattern matches
+ * @next: Next arm
+ */
+typedef struct case_arm_s
+{
+	char				**patterns;
+	pattern_t			**compiled;
+	struct node_s		*body;
+	struct case_arm_s	*next;
+} case_arm_t;
+
+/**
+ * struct node_s - Parsed command
+ * @type: Kind of command
+ * @cmd: Segments run by execute_command, for NODE_COMMAND
+ * @redirs: Redirections of a compound command, or NULL
+ * @left: First operand, condition or body
+ * @right: Second operand or body
+ * @alt: Else branch of an if
+ * @name: Variable of a for loop, word of a case, name of a function
+ * @words: Words of a for loop
+ * @arms: Arms of a case
+ * @next: Next command of the list this command belongs to
+ *
+ * Strings point into the tokens the tree was parsed from; nothing is
+ * copied, so a loop body is parsed once and run as many times as needed.
+ */
+typedef struct node_s
+{
+	node_type_t		type;
+	char			***cmd;
+	char			***redirs;
+	struct node_s	*left;
+	struct node_s	*right;
+	struct node_s	*alt;
+	char			*name;
+	char			**words;
+	case_arm_t		*arms;
+	struct node_s	*next;
+} node_t;
+
+/**
+ * struct script_s - Commands parsed from a source, with their tokens
+ * @tokens: The tokens the tree points into
+ * @root: First command of the tree
+ * @refs: Number of owners: the source running it and each function
+ * defined in it
+ */
+typedef struct script_s
+{
+	char	***tokens;
+	node_t	*root;
+	int		refs;
+} script_t;
+
+/**
+ * enum stat_id_e - Counters kept by stats.c
+ * @STAT_COMMANDS: Simple commands run, in the shell or in a child
+ * @STAT_FORKS: Processes forked
+ * @STAT_EXECS: Programs executed
+ * @STAT_PATH_LOOKUPS: Command names looked up in PATH
+ * @STAT_PATH_STATS: stat calls made looking commands up
+ * @STAT_PATH_SHM_HITS: Commands found in the index shared by shells
+ * @STAT_HEREDOC_BYTES: Bytes of heredoc bodies written
+ * @STAT_TOKENIZER_ALLOCS: Allocations made by the tokenizer
+ * @STAT_COUNT: Number of counters
+ */
+typedef enum stat_id_e
+{
+	STAT_COMMANDS,
+	STAT_FORKS,
+	STAT_EXECS,
+	STAT_PATH_LOOKUPS,
+	STAT_PATH_STATS,
+	STAT_PATH_SHM_HITS,
+	STAT_HEREDOC_BYTES,
+	STAT_TOKENIZER_ALLOCS,
+	STAT_COUNT
+} stat_id_t;
+
+/**
+ * struct redir_save_s - Descriptors replaced by the redirections of a command
+ * @fds: Copy of each descriptor from 0 to 9 as it was before, -1 if it was
+ * left alone, REDIR_CLOSED if it was not open
+ * @fanout: Process id of the fan-out helper when stdout goes to several
+ * files, or -1
+ */
+typedef struct redir_save_s
+{
+	int		fds[REDIR_FDS];
+	pid_t	fanout;
+} redir_save_t;
+
+/* Directories read by pathname expansion, private to glob.c */
+typedef struct dir_cache_s dir_cache_t;
+
+/* Input */
+void		input_init(void);
+int			shell_interactive(void);
+int			shell_line_editing(void);
+input_t		*input_stdin(void);
+input_t		*input_open(int fd);
+input_t		*input_string(const char *s);
+void		input_close(input_t *in);
+ssize_t		input_line(input_t *in, char **line);
+ssize_t		input_until(input_t *in, int delim, char **line, int *ended);
+int			input_getc(input_t *in);
+void		input_sync(input_t *in);
+void		input_sync_stdin(void);
+int			input_done(input_t *in);
+input_t		*input_read_stdin(void);
+void		input_stdin_moved(void);
+void		input_end(void);
+
 /* Prompt */
 prompt_t	*init_prompt(void);
 void		*free_prompt(void *prompt);
-int			get_prompt(prompt_t *prompt);
+int			get_prompt(prompt_t *prompt, const char *prompt_str);
+
+/* Line editor */
+int			line_edit(prompt_t *prompt, const char *prompt_str);
+void		line_edit_free(void);
+
+/* History */
+int			hist_add(const char *line);
+int			hist_count(void);
+const char	*hist_get(int age);
+int			hist_search(const char *query, int from);
+int			hist_prepend(const char *line, size_t len);
+void		hist_free(void);
+int			hist_file_open(void);
+void		hist_file_append(const char *line, size_t len);
+int			hist_file_load(void);
+void		hist_file_close(void);
+
+/* Completion */
+int			complete_word(const char *line, size_t pos, size_t *start,
+				char ***list);
+void		free_matches(char **list, int count);
+void		path_index_enable(void);
+void		path_index_invalidate(void);
+void		path_index_refresh(void);
+char		*path_index_lookup(const char *name, int *found);
+size_t		path_index_prefix(const char *prefix, size_t *first);
+const char	*path_index_name(size_t i);
+char		*path_shm_lookup(const char *name);
+void		path_shm_store(const char *name, int dir);
 
-/* Tokenizer */
+/* Startup */
+void		startup_begin(void);
+void		startup_init(char *program_name, int interactive);
+void		startup_report(void);
+int			source_file(const char *path, char *program_name);
+
+/* Tokenizer and parser */
 char		***tokenize_command(char *input);
+char		***tokens_append(char ***tokens, char ***more);
+char		quote_open(char *input);
+const char	*skip_subst(const char *s);
+tok_kind_t	token_kind(const char *token);
 void		free_tokens(char ***tokens);
+int			is_operator(const char *s);
+int			is_redirection(char **segment);
+int			parse_tokens(char ***tokens, node_t **root, const char **what);
+void		parse_report(char *program_name, int line_count, int state,
+				const char *what);
+void		node_free(node_t *node);
+
+/* Expansion and variables */
+char		*expand_string(const char *word, int flags);
+char		**expand_args(char **words, dir_cache_t **cache);
+char		***expand_tokens(char ***tokens);
+pattern_t	*pattern_compile(const char *pattern);
+int			pattern_match(pattern_t *p, const char *s);
+const char	*pattern_source(const pattern_t *p);
+void		pattern_free(pattern_t *p);
+int			glob_pattern(const char *word);
+size_t		glob_unescape(char *s, size_t len);
+char		**glob_expand(const char *pattern, dir_cache_t **cache);
+void		dir_cache_free(dir_cache_t *cache);
+int			arith_eval(const char *expr, long *result, const char **error);
+size_t		var_name_length(const char *s);
+const char	*var_lookup(const char *name, size_t len);
+const char	*var_get(const char *name);
+int			var_set(const char *name, const char *value);
+int			var_assign(const char *word);
+void		var_unset(const char *name);
+int			var_scope_push(void);
+void		var_scope_pop(void);
+int			var_local(const char *word);
+int			var_prefix_push(char **words, int n);
+void		var_free_all(void);
+
+/* Interned names */
+uint32_t	intern_hash(const char *s, size_t len);
+int			intern_find(const char *s, size_t len);
+int			intern(const char *s, size_t len);
+const char	*intern_name(int id);
+uint32_t	intern_hash_of(int id);
+void		intern_free(void);
+
+/* Functions */
+script_t	*script_new(char ***tokens, node_t *root);
+void		script_release(script_t *script);
+int			script_run(script_t *script, char *program_name, int line_count);
+int			func_define(const char *name, node_t *body);
+int			is_function(const char *name);
+int			func_call(char **args, char *program_name, int line_count);
+char		**positional_args(int *count);
+void		func_free_all(void);
 
 /* Interpreter */
-int			interpret_tokens(char ***tokens, char *program_name, int line_count);
+int			run_source(source_t *src, char *program_name);
+void		shell_set_tail(node_t *root);
+int			serve(const char *path, char *program_name);
+int			eval_node(node_t *node, char *program_name, int line_count);
+int			eval_list(node_t *node, char *program_name, int line_count);
+int			eval_function(node_t *body, char *program_name, int line_count);
+int			execute_command(char ***tokens, char *program_name, int line_count,
+				int in_place);
+int			setup_redirections(char ***tokens, int idx, redir_save_t *saved,
+				char *program_name, int line_count);
+void		restore_redirections(redir_save_t *saved);
+void		redirect_keep(void);
+int			redirect_reserve(int fd);
+void		exec_args(char **args, char *program_name, int line_count);
+pid_t		fanout_start(int *fds, int n);
+void		fanout_detach(pid_t helper);
+void		shell_init(char *program_name);
+char		*shell_name(void);
+pid_t		shell_pid(void);
+int			shell_line(void);
+int			shell_status(void);
+void		shell_set_status(int status);
+void		shell_exit(int status);
+int			shell_exiting(void);
+void		shell_set_interactive(int interactive);
+int			shell_expand_error(void);
+int			loop_control(int levels, int is_continue);
+int			shell_return(int status);
+
+/* Built-in pipeline stages */
+int			stage_start(char **args, int in, int out, char *program_name,
+				int line_count);
+int			stage_join(void);
+void		stage_forget(void);
+
+/* Process substitution */
+int			subst_open(const char *command, int reading);
+int			subst_mark(void);
+void		subst_close(int mark);
+int			subst_reaped(pid_t pid);
 
 /* Builtins */
 int			handle_builtin(char **args, int *status, char *program_name, int line_count);
+const char	*builtin_name(int i);
+int			builtin_index(const char *name);
+int			builtin_threadable(int i);
+int			is_builtin(const char *name);
+int			builtin_test(char **args, char *program_name, int line_count);
 int			builtin_setenv(char **args, char *program_name, int line_count);
 int			builtin_unsetenv(char **args, char *program_name, int line_count);
+int			builtin_read(char **args, char *program_name, int line_count);
+int			builtin_timeout(char **args, char *program_name, int line_count);
+
+/* Statistics */
+void		stats_init(void);
+void		stats_add(stat_id_t id, unsigned long n);
+void		stats_builtin(int i);
+pid_t		stats_wait(pid_t pid, int *status);
+void		stats_report(int fd, int machine);
+int			stats_exit_pending(void);
+int			builtin_stats(char **args, char *program_name, int line_count);
+
+/* Buffered output */
+int			out_write(int fd, const char *s, size_t len);
+int			out_puts(int fd, const char *s);
+int			out_printf(int fd, const char *format, ...);
+int			out_flush(int fd);
+void		out_flush_all(void);
+void		out_redirect(int fd, int to);
+
+/* Memory pool */
+void		*pool_alloc(size_t size);
+void		pool_free(void *ptr);
+size_t		pool_size(const void *ptr);
+void		*pool_resize(void *ptr, size_t size);
+void		pool_release(void);
+void		pool_report(void);
 
 /* Prohibited functions */
 long		_strtol(const char *str, char **endptr, int base);
@@ -62,6 +499,7 @@ int			_setenv(const char *name, const char *value);
 char		*_strcat(char *dest, const char *src);
 int			_setenv(const char *name, const char *value);
 int			_putenv(char *string);
+int			_unsetenv(const char *name);
 void		cleanup_environment(void);
 char		*_strcpy(char *dest, const char *src);
 void		*_realloc(void *ptr, size_t size);
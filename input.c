@@ -0,0 +1,450 @@
+#include "hsh.h"
+
+#define INPUT_READERS 4
+
+/**
+ * struct input_state_s - Input state shared by the whole shell
+ * @interactive: Whether stdin was a terminal at startup
+ * @editing: Whether stdout was a terminal too, so lines can be edited
+ * @in: Reader of the shell's standard input
+ * @current: Reader the read built-in takes stdin from, NULL until stdin
+ * is checked again after it moved
+ * @reads: Readers the read built-in used on stdin, most recent first
+ */
+typedef struct input_state_s
+{
+	int		interactive;
+	int		editing;
+	input_t	*in;
+	input_t	*current;
+	input_t	*reads[INPUT_READERS];
+} input_state_t;
+
+static input_state_t input_state;
+
+/**
+ * input_init - Check once whether the shell's stdin is a terminal
+ *
+ * Every later question about interactivity is answered from this check.
+ */
+void input_init(void)
+{
+	input_state.interactive = isatty(STDIN_FILENO);
+	input_state.editing = input_state.interactive && isatty(STDOUT_FILENO);
+}
+
+/**
+ * shell_interactive - Tell whether stdin was a terminal at startup
+ *
+ * Return: 1 if it was, 0 otherwise
+ */
+int shell_interactive(void)
+{
+	return (input_state.interactive);
+}
+
+/**
+ * shell_line_editing - Tell whether lines are read through the line editor
+ *
+ * Return: 1 if both stdin and stdout were terminals at startup, 0 otherwise
+ */
+int shell_line_editing(void)
+{
+	return (input_state.editing);
+}
+
+/**
+ * input_stdin - Get the reader of the shell's standard input
+ *
+ * Return: The reader, created on first use, or NULL on failure
+ */
+input_t *input_stdin(void)
+{
+	if (!input_state.in)
+		input_state.in = input_open(STDIN_FILENO);
+	return (input_state.in);
+}
+
+/**
+ * input_open - Create a buffered reader on a file descriptor
+ * @fd: The file descriptor
+ *
+ * Return: The reader, or NULL on failure
+ */
+input_t *input_open(int fd)
+{
+	struct stat st;
+	input_t *in;
+
+	in = malloc(sizeof(input_t));
+	if (!in)
+		return (NULL);
+	in->buf = malloc(INPUT_BUF);
+	if (!in->buf)
+	{
+		free(in);
+		return (NULL);
+	}
+	in->fd = fd;
+	in->cap = INPUT_BUF;
+	in->start = 0;
+	in->end = 0;
+	in->eof = 0;
+	in->seekable = lseek(fd, 0, SEEK_CUR) != -1;
+	in->bytewise = 0;
+	in->dev = 0;
+	in->ino = 0;
+	if (fstat(fd, &st) == 0)
+	{
+		in->dev = st.st_dev;
+		in->ino = st.st_ino;
+	}
+	return (in);
+}
+
+/**
+ * input_string - Create a reader over a string
+ * @s: The string, copied
+ *
+ * Example:
+ *   in = input_string("echo a\necho b");   - Two lines, then end of input
+ *
+ * Return: The reader, or NULL on failure
+ */
+input_t *input_string(const char *s)
+{
+	size_t len = _strlen(s);
+	input_t *in;
+
+	in = malloc(sizeof(input_t));
+	if (!in)
+		return (NULL);
+	in->buf = malloc(len + 1);
+	if (!in->buf)
+	{
+		free(in);
+		return (NULL);
+	}
+	memcpy(in->buf, s, len);
+	in->fd = -1;
+	in->cap = len + 1;
+	in->start = 0;
+	in->end = len;
+	in->eof = 1;
+	in->seekable = 0;
+	in->bytewise = 0;
+	in->dev = 0;
+	in->ino = 0;
+	return (in);
+}
+
+/**
+ * input_close - Free a reader without closing its descriptor
+ * @in: The reader
+ */
+void input_close(input_t *in)
+{
+	if (!in)
+		return;
+	if (in == input_state.in)
+		input_state.in = NULL;
+	if (in == input_state.current)
+		input_state.current = NULL;
+	free(in->buf);
+	free(in);
+}
+
+/**
+ * input_fill - Read more bytes into the buffer
+ * @in: The reader
+ *
+ * Unconsumed bytes are moved to the front first; the buffer only grows
+ * when a single line does not fit in it. A bytewise reader asks for one
+ * byte only.
+ *
+ * Return: Number of bytes read, 0 at end of input, -1 on error
+ */
+static ssize_t input_fill(input_t *in)
+{
+	ssize_t n;
+	char *tmp;
+
+	if (in->eof)
+		return (0);
+	if (in->start > 0)
+	{
+		memmove(in->buf, in->buf + in->start, in->end - in->start);
+		in->end -= in->start;
+		in->start = 0;
+	}
+	if (in->end + 1 >= in->cap)
+	{
+		tmp = malloc(in->cap * 2);
+		if (!tmp)
+			return (-1);
+		memcpy(tmp, in->buf, in->end);
+		free(in->buf);
+		in->buf = tmp;
+		in->cap *= 2;
+	}
+
+	do {
+		n = read(in->fd, in->buf + in->end,
+			in->bytewise ? 1 : in->cap - in->end - 1);
+	} while (n == -1 && errno == EINTR);
+	if (n <= 0)
+	{
+		in->eof = 1;
+		return (n);
+	}
+	in->end += n;
+	return (n);
+}
+
+/**
+ * input_until - Read up to the next delimiter
+ * @in: The reader
+ * @delim: The delimiter byte
+ * @line: Set to the bytes read, inside the reader's buffer
+ * @ended: Set to 1 if the delimiter was found, 0 at end of input; may be
+ * NULL
+ *
+ * The delimiter is consumed and replaced by a null byte. The line stays
+ * valid until the next call on the same reader.
+ *
+ * Example:
+ *   input_until(in, '\0', &line, &ended)   - Reads a find -print0 name
+ *
+ * Return: Length of the line, or -1 at end of input
+ */
+ssize_t input_until(input_t *in, int delim, char **line, int *ended)
+{
+	char *nl;
+	size_t scanned = 0, len;
+
+	while (1)
+	{
+		nl = memchr(in->buf + in->start + scanned, delim,
+			in->end - in->start - scanned);
+		if (nl)
+			break;
+		scanned = in->end - in->start;
+		if (input_fill(in) <= 0)
+		{
+			if (in->end == in->start)
+				return (-1);
+			/* Last line without a delimiter */
+			nl = in->buf + in->end;
+			break;
+		}
+	}
+
+	*line = in->buf + in->start;
+	len = nl - *line;
+	if (ended)
+		*ended = nl < in->buf + in->end;
+	*nl = '\0';
+	in->start += len + (nl < in->buf + in->end);
+	if (in->start > in->end)
+		in->start = in->end;
+	return ((ssize_t)len);
+}
+
+/**
+ * input_line - Read the next line
+ * @in: The reader
+ * @line: Set to the line, inside the reader's buffer
+ *
+ * The newline is replaced by a null byte. The line stays valid until the
+ * next call on the same reader.
+ *
+ * Example:
+ *   while ((len = input_line(in, &line)) != -1)
+ *       handle(line);
+ *
+ * Return: Length of the line, or -1 at end of input
+ */
+ssize_t input_line(input_t *in, char **line)
+{
+	return (input_until(in, '\n', line, NULL));
+}
+
+/**
+ * input_done - Tell whether a reader has nothing left to give
+ * @in: The reader
+ *
+ * A string is done once consumed; a regular file once the shell has read
+ * up to its size. A pipe or a terminal is only known to be done after a
+ * read returned end of input.
+ *
+ * Return: 1 if no line is left, 0 if there may be more
+ */
+int input_done(input_t *in)
+{
+	struct stat st;
+	off_t pos;
+
+	if (in->start < in->end)
+		return (0);
+	if (in->eof)
+		return (1);
+	if (!in->seekable || fstat(in->fd, &st) == -1 || !S_ISREG(st.st_mode))
+		return (0);
+	pos = lseek(in->fd, 0, SEEK_CUR);
+	return (pos != -1 && pos >= st.st_size);
+}
+
+/**
+ * input_getc - Read the next byte
+ * @in: The reader
+ *
+ * Return: The byte, or -1 at end of input
+ */
+int input_getc(input_t *in)
+{
+	if (in->start == in->end && input_fill(in) <= 0)
+	{
+		/* A terminal may deliver more after an end-of-file key */
+		in->eof = 0;
+		return (-1);
+	}
+	return ((unsigned char)in->buf[in->start++]);
+}
+
+/**
+ * input_sync - Give unread bytes back to the file before a fork
+ * @in: The reader, may be NULL
+ *
+ * On a seekable descriptor the file offset is moved back over whatever was
+ * buffered but not consumed, so a child reading the same descriptor starts
+ * where the shell stopped. Pipes and terminals cannot be rewound.
+ */
+void input_sync(input_t *in)
+{
+	if (!in || !in->seekable || in->start == in->end)
+		return;
+	if (lseek(in->fd, -(off_t)(in->end - in->start), SEEK_CUR) == -1)
+		return;
+	in->start = 0;
+	in->end = 0;
+	in->eof = 0;
+}
+
+/**
+ * input_on_stdin - Tell whether stdin points to the file a reader reads
+ * @in: The reader, may be NULL
+ *
+ * Return: 1 if it does, 0 otherwise
+ */
+static int input_on_stdin(input_t *in)
+{
+	struct stat st;
+
+	if (!in || in->fd != STDIN_FILENO || fstat(STDIN_FILENO, &st) == -1)
+		return (0);
+	return (in->dev == st.st_dev && in->ino == st.st_ino);
+}
+
+/**
+ * input_sync_stdin - Rewind the shell's standard input before a fork
+ *
+ * Whichever reader stdin points to is rewound: the shell's own, or the
+ * one the read built-in uses while stdin is redirected. Rewinding the
+ * shell's reader while stdin points elsewhere would move the wrong file.
+ */
+void input_sync_stdin(void)
+{
+	if (!input_state.current && input_on_stdin(input_state.in))
+		input_state.current = input_state.in;
+	input_sync(input_state.current);
+}
+
+/**
+ * input_read_stdin - Get the reader the read built-in takes stdin from
+ *
+ * While stdin is still the shell's own input, this is the shell's reader,
+ * so a script and the lines it reads share one buffer. Otherwise a reader
+ * is kept per file stdin pointed to. A file is read in blocks and rewound
+ * over what was not used before anyone else reads it; a pipe or terminal
+ * cannot be rewound, so it is read a byte at a time, as POSIX requires,
+ * and the next reader of it finds everything after the line. stdin is
+ * only looked at again, with one fstat, after input_stdin_moved.
+ *
+ * Return: The reader, or NULL on failure
+ */
+input_t *input_read_stdin(void)
+{
+	input_t **reads = input_state.reads, *in;
+	struct stat st;
+	int i;
+
+	if (input_state.current)
+		return (input_state.current);
+	if (input_on_stdin(input_state.in))
+		return (input_state.current = input_state.in);
+	if (fstat(STDIN_FILENO, &st) == -1)
+		return (NULL);
+
+	for (i = 0; i < INPUT_READERS && reads[i]; i++)
+		if (reads[i]->dev == st.st_dev && reads[i]->ino == st.st_ino)
+			break;
+	if (i == INPUT_READERS || !reads[i])
+	{
+		/* Make room by dropping the reader used least recently */
+		if (i == INPUT_READERS)
+			input_close(reads[--i]);
+		reads[i] = input_open(STDIN_FILENO);
+		if (!reads[i])
+			return (NULL);
+		reads[i]->bytewise = !reads[i]->seekable;
+	}
+	in = reads[i];
+	memmove(reads + 1, reads, sizeof(input_t *) * i);
+	reads[0] = in;
+	return (input_state.current = in);
+}
+
+/**
+ * input_stdin_moved - Note that stdin is about to point somewhere else
+ *
+ * Called before a redirection or a pipe replaces stdin and before it is
+ * restored. What the read built-in buffered from a file is given back
+ * while stdin still points to it; bytes from a pipe cannot be, so its
+ * reader is kept for when stdin points to the pipe again.
+ */
+void input_stdin_moved(void)
+{
+	input_t **reads = input_state.reads;
+	int i, kept = 0;
+
+	if (input_state.current != input_state.in)
+		input_sync(input_state.current);
+	input_state.current = NULL;
+	for (i = 0; i < INPUT_READERS && reads[i]; i++)
+	{
+		if (reads[i]->start < reads[i]->end)
+			reads[kept++] = reads[i];
+		else
+			input_close(reads[i]);
+		if (i >= kept)
+			reads[i] = NULL;
+	}
+}
+
+/**
+ * input_end - Give back buffered input and free the read readers at exit
+ *
+ * A parent sharing the descriptor then goes on from where the shell
+ * stopped, as after `(read line) < file`.
+ */
+void input_end(void)
+{
+	int i;
+
+	input_sync_stdin();
+	for (i = 0; i < INPUT_READERS; i++)
+	{
+		input_close(input_state.reads[i]);
+		input_state.reads[i] = NULL;
+	}
+}
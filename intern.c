@@ -0,0 +1,195 @@
+#include "hsh.h"
+
+/**
+ * struct symbol_s - Interned name
+ * @name: The name, owned by the table
+ * @len: Length of the name
+ * @hash: FNV-1a hash of the name, computed once
+ */
+typedef struct symbol_s
+{
+	char		*name;
+	size_t		len;
+	uint32_t	hash;
+} symbol_t;
+
+/**
+ * struct intern_s - Table of interned names
+ * @syms: The names, indexed by id; ids never change
+ * @count: Number of names
+ * @cap: Allocated number of names
+ * @slots: Open addressing table of ids, -1 for an empty slot
+ * @mask: Number of slots minus one, a power of two minus one
+ */
+typedef struct intern_s
+{
+	symbol_t	*syms;
+	int			count;
+	int			cap;
+	int			*slots;
+	size_t		mask;
+} intern_t;
+
+static intern_t tab;
+
+/**
+ * intern_hash - Hash a name
+ * @s: The name, not necessarily null-terminated
+ * @len: Length of the name
+ *
+ * Return: The FNV-1a hash
+ */
+uint32_t intern_hash(const char *s, size_t len)
+{
+	uint32_t h = 2166136261u;
+	size_t i;
+
+	for (i = 0; i < len; i++)
+		h = (h ^ (unsigned char)s[i]) * 16777619u;
+	return (h);
+}
+
+/**
+ * intern_slot - Find the slot of a name
+ * @s: The name
+ * @len: Length of the name
+ * @h: Hash of the name
+ *
+ * Return: Index of the slot holding the name, or of the empty slot where
+ * it would go
+ */
+static size_t intern_slot(const char *s, size_t len, uint32_t h)
+{
+	size_t i = h & tab.mask;
+	symbol_t *sym;
+
+	while (tab.slots[i] != -1)
+	{
+		sym = &tab.syms[tab.slots[i]];
+		if (sym->hash == h && sym->len == len && memcmp(sym->name, s, len) == 0)
+			break;
+		i = (i + 1) & tab.mask;
+	}
+	return (i);
+}
+
+/**
+ * intern_grow - Make room for one more name
+ *
+ * The slots are kept at most half full.
+ *
+ * Return: 0 on success, -1 on failure
+ */
+static int intern_grow(void)
+{
+	symbol_t *syms;
+	size_t size, i;
+	int *slots, id;
+
+	if (tab.count == tab.cap)
+	{
+		syms = _realloc(tab.syms, sizeof(symbol_t) * (tab.cap ? tab.cap * 2 : 64));
+		if (!syms)
+			return (-1);
+		tab.syms = syms;
+		tab.cap = tab.cap ? tab.cap * 2 : 64;
+	}
+	if (tab.slots && (size_t)tab.count * 2 < tab.mask + 1)
+		return (0);
+	size = tab.slots ? (tab.mask + 1) * 2 : 128;
+	slots = malloc(sizeof(int) * size);
+	if (!slots)
+		return (-1);
+	for (i = 0; i < size; i++)
+		slots[i] = -1;
+	free(tab.slots);
+	tab.slots = slots;
+	tab.mask = size - 1;
+	for (id = 0; id < tab.count; id++)
+		tab.slots[intern_slot(tab.syms[id].name, tab.syms[id].len,
+			tab.syms[id].hash)] = id;
+	return (0);
+}
+
+/**
+ * intern_find - Get the id of a name without adding it
+ * @s: The name, not necessarily null-terminated
+ * @len: Length of the name
+ *
+ * A name that was never interned names nothing the shell keeps, so
+ * lookups of unknown names leave the table as it is.
+ *
+ * Return: The id, or -1 if the name was never interned
+ */
+int intern_find(const char *s, size_t len)
+{
+	if (!tab.slots)
+		return (-1);
+	return (tab.slots[intern_slot(s, len, intern_hash(s, len))]);
+}
+
+/**
+ * intern - Get the id of a name, adding it if needed
+ * @s: The name, not necessarily null-terminated
+ * @len: Length of the name
+ *
+ * Example:
+ *   intern("PATH", 4) == intern_find("PATH=/bin", 4)
+ *
+ * Return: The id, stable for the life of the shell, or -1 on failure
+ */
+int intern(const char *s, size_t len)
+{
+	uint32_t h = intern_hash(s, len);
+	symbol_t *sym;
+	size_t i;
+
+	if (tab.slots && tab.slots[i = intern_slot(s, len, h)] != -1)
+		return (tab.slots[i]);
+	if (intern_grow() == -1)
+		return (-1);
+	sym = &tab.syms[tab.count];
+	sym->name = malloc(len + 1);
+	if (!sym->name)
+		return (-1);
+	memcpy(sym->name, s, len);
+	sym->name[len] = '\0';
+	sym->len = len;
+	sym->hash = h;
+	tab.slots[intern_slot(s, len, h)] = tab.count;
+	return (tab.count++);
+}
+
+/**
+ * intern_name - Get an interned name
+ * @id: Id of the name
+ *
+ * Return: The name
+ */
+const char *intern_name(int id)
+{
+	return (tab.syms[id].name);
+}
+
+/**
+ * intern_hash_of - Get the hash of an interned name
+ * @id: Id of the name
+ *
+ * Return: The hash, as computed by intern_hash
+ */
+uint32_t intern_hash_of(int id)
+{
+	return (tab.syms[id].hash);
+}
+
+/**
+ * intern_free - Free the table of names
+ */
+void intern_free(void)
+{
+	while (tab.count > 0)
+		free(tab.syms[--tab.count].name);
+	pool_free(tab.syms);
+	free(tab.slots);
+	memset(&tab, 0, sizeof(tab));
+}
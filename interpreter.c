@@ -4,6 +4,9 @@
  * find_command_path - Find the full path of a command using PATH
  * @command: The command to find
  *
+ * When the PATH index is enabled it answers without walking PATH; so does
+ * the index shared by shells, for commands one of them already found.
+ *
  * Return: The full path of the command, or NULL if not found
  *
  * Example:
@@ -13,7 +16,7 @@
 static char *find_command_path(char *command)
 {
 	char *path_env, *path_copy, *path_token, *file_path;
-	int command_len, dir_len;
+	int command_len, dir_len, found, dir = 0;
 	struct stat buffer;
 
 	/* Validate command input */
@@ -23,11 +26,21 @@ static char *find_command_path(char *command)
 	/* If command contains '/', treat it as a path */
 	if (_strchr(command, '/') != NULL)
 	{
+		stats_add(STAT_PATH_STATS, 1);
 		if (stat(command, &buffer) == 0 && (buffer.st_mode & S_IXUSR))
 			return (_strdup(command));
 		return (NULL);
 	}
 
+	/* Ask the PATH index first */
+	stats_add(STAT_PATH_LOOKUPS, 1);
+	file_path = path_index_lookup(command, &found);
+	if (found)
+		return (file_path);
+	file_path = path_shm_lookup(command);
+	if (file_path)
+		return (file_path);
+
 	/* Get PATH environment variable */
 	path_env = _getenv("PATH");
 	if (!path_env)
@@ -58,14 +71,17 @@ static char *find_command_path(char *command)
 		_strcat(file_path, command);
 
 		/* Check if file exists and is executable */
+		stats_add(STAT_PATH_STATS, 1);
 		if (stat(file_path, &buffer) == 0 && (buffer.st_mode & S_IXUSR))
 		{
 			free(path_copy);
+			path_shm_store(command, dir);
 			return (file_path);
 		}
 
 		/* Try next directory */
 		free(file_path);
+		dir++;
 		path_token = strtok(NULL, ":");
 	}
 
@@ -76,519 +92,665 @@ static char *find_command_path(char *command)
 
 /**
  * handle_heredoc - Handle heredoc redirection
- * @delimiter: The delimiter string that ends the heredoc
- * @pipefd: Pipe file descriptors for communication
+ * @body: The body of the heredoc, read by the shell with the command
+ *
+ * The body is kept in an anonymous file, so a body larger than a pipe
+ * buffer never blocks the shell.
  *
- * Return: 0 on success, -1 on failure
+ * Return: Descriptor positioned at the start of the body, or -1 on failure
  */
-static int handle_heredoc(char *delimiter, int pipefd[2])
+static int handle_heredoc(const char *body)
 {
-	char *line = NULL;
-	size_t len = 0;
-	ssize_t read_len;
-	int is_interactive = isatty(STDIN_FILENO);
+	size_t len = _strlen(body);
+	ssize_t n;
+	int fd;
+
+	fd = memfd_create("heredoc", MFD_CLOEXEC);
+	if (fd == -1)
+	{
+		perror("memfd_create");
+		return (-1);
+	}
+	while (len > 0 && (n = write(fd, body, len)) > 0)
+	{
+		stats_add(STAT_HEREDOC_BYTES, n);
+		body += n;
+		len -= n;
+	}
+	lseek(fd, 0, SEEK_SET);
+	return (fd);
+}
 
-	/* Display prompt if in interactive mode */
-	if (is_interactive)
-		write(STDOUT_FILENO, "> ", 2);
+/* Set by exec without a command, so its redirections outlive it */
+static int keep_redirections;
+
+/**
+ * redirect_save - Keep a copy of a descriptor before a redirection
+ * replaces it
+ * @saved: Descriptors saved so far for the command
+ * @fd: The descriptor, from 0 to 9
+ *
+ * The copy sits above the descriptors redirections name and is closed on
+ * exec, so neither the command nor a later redirection sees it.
+ *
+ * Return: 0 on success, -1 on error
+ */
+static int redirect_save(redir_save_t *saved, int fd)
+{
+	if (saved->fds[fd] != -1)
+		return (0);
+	saved->fds[fd] = fcntl(fd, F_DUPFD_CLOEXEC, REDIR_FDS);
+	if (saved->fds[fd] == -1 && errno == EBADF)
+		saved->fds[fd] = REDIR_CLOSED;
+	return (saved->fds[fd] == -1 ? -1 : 0);
+}
 
-	while ((read_len = getline(&line, &len, stdin)) != -1)
+/**
+ * redirect_move - Put a descriptor in place of another
+ * @from: The descriptor to use, closed once moved
+ * @to: The descriptor it replaces
+ * @saved: Descriptors saved so far for the command
+ *
+ * Return: 0 on success, -1 on error
+ */
+static int redirect_move(int from, int to, redir_save_t *saved)
+{
+	if (redirect_save(saved, to) == -1)
 	{
-		/* Remove newline if present */
-		if (read_len > 0 && line[read_len - 1] == '\n')
-			line[read_len - 1] = '\0';
+		close(from);
+		return (-1);
+	}
+	if (to == STDIN_FILENO)
+		input_stdin_moved();
+	if (from != to)
+	{
+		dup2(from, to);
+		close(from);
+	}
+	return (0);
+}
 
-		/* Check if line matches delimiter exactly */
-		if (strcmp(line, delimiter) == 0)
-			break;
+/**
+ * redirect_output - Open the output files of a command and connect stdout
+ * @tokens: The array of tokens
+ * @outs: Index of each output operator in tokens
+ * @n: Number of output operators
+ * @saved: Descriptors saved so far, stdout and the fan-out helper set here
+ *
+ * With several files, as in "cmd > a > b", every file gets the whole
+ * output through a fan-out helper instead of only the last one.
+ *
+ * Return: 0 on success, -1 on error
+ */
+static int redirect_output(char ***tokens, int *outs, int n, redir_save_t *saved)
+{
+	int fds[FANOUT_MAX], flags, i;
 
-		/* Write the line to the pipe with a newline */
-		write(pipefd[1], line, _strlen(line));
-		write(pipefd[1], "\n", 1);
+	for (i = 0; i < n; i++)
+	{
+		flags = O_WRONLY | O_CREAT |
+			(token_kind(tokens[outs[i]][0]) == TOK_APPEND ? O_APPEND : O_TRUNC);
+		fds[i] = open(tokens[outs[i] + 1][0], flags, 0644);
+		if (fds[i] == -1)
+		{
+			fprintf(stderr, "%s: %d: %s: Permission denied\n", shell_name(),
+				shell_line(), tokens[outs[i] + 1][0]);
+			while (i > 0)
+				close(fds[--i]);
+			return (-1);
+		}
+	}
 
-		/* Display prompt for next line if in interactive mode */
-		if (is_interactive)
-			write(STDOUT_FILENO, "> ", 2);
+	if (n == 1)
+		return (redirect_move(fds[0], STDOUT_FILENO, saved));
+	/* Save original stdout and redirect */
+	if (redirect_save(saved, STDOUT_FILENO) == -1)
+	{
+		while (n > 0)
+			close(fds[--n]);
+		return (-1);
 	}
+	saved->fanout = fanout_start(fds, n);
+	return (saved->fanout == -1 ? -1 : 0);
+}
 
-	/* Clean up */
-	free(line);
+/**
+ * redirect_dup - Apply a redirection that copies or closes a descriptor
+ * @fd: The descriptor redirected
+ * @word: Number of the descriptor to copy, or "-" to close fd
+ * @saved: Descriptors saved so far for the command
+ *
+ * Example:
+ *   "2>&1"   - redirect_dup(2, "1", saved)
+ *   "3>&-"   - redirect_dup(3, "-", saved)
+ *
+ * Return: 0 on success, -1 on error
+ */
+static int redirect_dup(int fd, const char *word, redir_save_t *saved)
+{
+	int from = -1;
+
+	if (_strcmp(word, "-") != 0)
+	{
+		if (word[0] < '0' || word[0] > '9' || word[1])
+		{
+			fprintf(stderr, "%s: %d: %s: Bad fd number\n", shell_name(),
+				shell_line(), word);
+			return (-1);
+		}
+		from = word[0] - '0';
+		if (fcntl(from, F_GETFD) == -1)
+		{
+			fprintf(stderr, "%s: %d: %d: Bad file descriptor\n", shell_name(),
+				shell_line(), from);
+			return (-1);
+		}
+	}
+	if (redirect_save(saved, fd) == -1)
+		return (-1);
+	if (fd == STDIN_FILENO && from != fd)
+		input_stdin_moved();
+	if (from == -1)
+		close(fd);
+	else if (from != fd)
+		dup2(from, fd);
 	return (0);
 }
 
 /**
- * setup_redirections - Configure input and output redirections
+ * redirect_one - Apply a redirection other than stdout to a file
+ * @tokens: The array of tokens
+ * @i: Index of the redirection operator
+ * @fd: The descriptor redirected
+ * @saved: Descriptors saved so far for the command
+ *
+ * Return: 0 on success, -1 on error
+ */
+static int redirect_one(char ***tokens, int i, int fd, redir_save_t *saved)
+{
+	tok_kind_t kind = token_kind(tokens[i][0]);
+	char *name = tokens[i + 1][0];
+	int from;
+
+	if (kind == TOK_DUP_IN || kind == TOK_DUP_OUT)
+		return (redirect_dup(fd, name, saved));
+	/* Handle heredoc (<<), its body was read with the command */
+	if (kind == TOK_HEREDOC)
+		from = handle_heredoc(tokens[i + 1][1] ? tokens[i + 1][1] : "");
+	else if (kind == TOK_IN)
+		from = open(name, O_RDONLY);
+	else
+		from = open(name, O_WRONLY | O_CREAT |
+			(kind == TOK_APPEND ? O_APPEND : O_TRUNC), 0644);
+	if (from == -1 && kind != TOK_HEREDOC)
+	{
+		/* Print more specific error message */
+		if (access(name, F_OK) == -1 && kind == TOK_IN)
+			fprintf(stderr, "%s: %d: %s: No such file or directory\n",
+				shell_name(), shell_line(), name);
+		else
+			fprintf(stderr, "%s: %d: %s: Permission denied\n", shell_name(),
+				shell_line(), name);
+	}
+	if (from == -1)
+		return (-1);
+	return (redirect_move(from, fd, saved));
+}
+
+/**
+ * redirect_fd - Get the descriptor a redirection applies to
+ * @segment: The redirection operator and its descriptor number, if any
+ *
+ * Return: The number written before the operator, or 0 for input and 1
+ * for output
+ */
+static int redirect_fd(char **segment)
+{
+	tok_kind_t kind = token_kind(segment[0]);
+
+	if (segment[1])
+		return (segment[1][0] - '0');
+	return (kind == TOK_IN || kind == TOK_HEREDOC || kind == TOK_DUP_IN ?
+		STDIN_FILENO : STDOUT_FILENO);
+}
+
+/**
+ * setup_redirections - Configure the redirections of a command
  * @tokens: The array of tokens
  * @idx: Current position in the token array
- * @saved_fds: Array to save original stdin (0) and stdout (1)
+ * @saved: Where to save the descriptors replaced, for restore_redirections
  * @program_name: Name of the shell program
  * @line_count: Current line count for error messages
  *
+ * Redirections apply from left to right, so "cmd >out 2>&1" sends both to
+ * out. Files stdout goes to are opened together where the first of them
+ * is written.
+ *
  * Return: Index of the next command, or -1 on error
  */
-static int setup_redirections(char ***tokens, int idx, int saved_fds[2], char *program_name, int line_count)
+int setup_redirections(char ***tokens, int idx, redir_save_t *saved,
+	char *program_name, int line_count)
 {
-	int fd, i = idx;
+	int i, fd, outs[FANOUT_MAX], n_outs = 0;
+	tok_kind_t kind;
 
-	/* Initialize saved file descriptors as -1 (unset) */
-	saved_fds[0] = -1;
-	saved_fds[1] = -1;
+	for (fd = 0; fd < REDIR_FDS; fd++)
+		saved->fds[fd] = -1;
+	saved->fanout = -1;
 
-	while (tokens[i] != NULL)
+	/* Output buffered so far belongs to the descriptors being replaced */
+	out_flush_all();
+
+	/* Find the files stdout goes to, up to the pipe ending the command */
+	for (i = idx; tokens[i] && token_kind(tokens[i][0]) != TOK_PIPE; i++)
 	{
-		/* Skip non-redirection tokens */
-		if (!tokens[i][0] || !tokens[i][0][0] ||
-			(tokens[i][0][0] != '<' && tokens[i][0][0] != '>' && tokens[i][0][0] != '|'))
+		if (!is_redirection(tokens[i]))
+			continue;
+		if (!tokens[i + 1] || !tokens[i + 1][0])
+			return (-1);
+		kind = token_kind(tokens[i][0]);
+		if ((kind == TOK_OUT || kind == TOK_APPEND) &&
+			redirect_fd(tokens[i]) == STDOUT_FILENO)
+		{
+			if (n_outs == FANOUT_MAX)
 			{
-				i++;
-				continue;
+				fprintf(stderr, "%s: %d: too many output files\n",
+					program_name, line_count);
+				return (-1);
 			}
+			outs[n_outs++] = i;
+		}
+		i++;
+	}
 
-		/* Handle redirections */
-		if (tokens[i][0][0] == '<' || tokens[i][0][0] == '>')
+	for (i = idx; tokens[i] && token_kind(tokens[i][0]) != TOK_PIPE; i++)
+	{
+		if (!is_redirection(tokens[i]))
+			continue;
+		kind = token_kind(tokens[i][0]);
+		fd = redirect_fd(tokens[i]);
+		if ((kind == TOK_OUT || kind == TOK_APPEND) && fd == STDOUT_FILENO)
 		{
-			int is_input = (tokens[i][0][0] == '<');
-			int is_append = (_strcmp(tokens[i][0], ">>") == 0);
-			int is_heredoc = (_strcmp(tokens[i][0], "<<") == 0);
-			int target_fd = is_input ? STDIN_FILENO : STDOUT_FILENO;
-			int flags;
-
-			/* Check if filename/delimiter exists */
-			if (!tokens[i + 1] || !tokens[i + 1][0])
+			if (i == outs[0] &&
+				redirect_output(tokens, outs, n_outs, saved) == -1)
 				return (-1);
+		}
+		else if (redirect_one(tokens, i, fd, saved) == -1)
+			return (-1);
+		i++;
+	}
+	return (i);
+}
 
-			/* Handle heredoc (<<) */
-			if (is_heredoc)
-			{
-				char *delimiter = tokens[i + 1][0];
-				int pipefd[2];
+/**
+ * restore_redirections - Undo redirections made in the shell itself
+ * @saved: Descriptors saved by setup_redirections
+ *
+ * Restoring stdout closes the pipe of a fan-out; the helper is then
+ * waited for, so the files are complete before the next command runs.
+ * After exec without a command, the saved copies are dropped instead and
+ * the redirections stay.
+ */
+void restore_redirections(redir_save_t *saved)
+{
+	int fd;
 
-				/* Create a pipe */
-				if (pipe(pipefd) == -1)
-				{
-					perror("pipe");
-					return (-1);
-				}
+	/* Output buffered for the redirected stdout goes there first */
+	out_flush_all();
+	if (saved->fds[0] != -1 && !keep_redirections)
+		input_stdin_moved();
+	for (fd = 0; fd < REDIR_FDS; fd++)
+	{
+		if (saved->fds[fd] >= 0)
+		{
+			if (!keep_redirections)
+				dup2(saved->fds[fd], fd);
+			close(saved->fds[fd]);
+		}
+		else if (saved->fds[fd] == REDIR_CLOSED && !keep_redirections)
+			close(fd);
+		saved->fds[fd] = -1;
+	}
+	if (saved->fanout != -1 && !keep_redirections)
+		stats_wait(saved->fanout, NULL);
+	saved->fanout = -1;
+	keep_redirections = 0;
+}
 
-				/* Save original stdin */
-				saved_fds[0] = dup(STDIN_FILENO);
-				if (saved_fds[0] == -1)
-				{
-					close(pipefd[0]);
-					close(pipefd[1]);
-					return (-1);
-				}
+/**
+ * redirect_keep - Keep the redirections of the running built-in
+ *
+ * Called by exec without a command: restore_redirections then leaves the
+ * shell's descriptors as the built-in's redirections made them.
+ */
+void redirect_keep(void)
+{
+	keep_redirections = 1;
+}
 
-				/* Handle heredoc input */
-				if (handle_heredoc(delimiter, pipefd) == -1)
-				{
-					close(pipefd[0]);
-					close(pipefd[1]);
-					return (-1);
-				}
+/**
+ * redirect_reserve - Move a descriptor the shell keeps open out of the way
+ * @fd: The descriptor, closed when it moves
+ *
+ * Redirections name descriptors 0 to 9; one the shell holds for itself,
+ * such as a file being sourced, sits above them, so "exec 3>log" cannot
+ * replace it.
+ *
+ * Return: The descriptor to use from then on
+ */
+int redirect_reserve(int fd)
+{
+	int high;
+
+	if (fd < 0 || fd >= REDIR_FDS)
+		return (fd);
+	high = fcntl(fd, F_DUPFD_CLOEXEC, REDIR_FDS);
+	if (high == -1)
+		return (fd);
+	close(fd);
+	return (high);
+}
 
-				/* Connect pipe to stdin */
-				dup2(pipefd[0], STDIN_FILENO);
-				close(pipefd[0]);
-				close(pipefd[1]);
+/**
+ * assign_count - Count the assignments written before a command
+ * @args: The command and its arguments
+ *
+ * Example:
+ *   args={"IFS=", "read", "-r", "l", NULL} - 1
+ *
+ * Return: Number of leading "name=value" words
+ */
+static int assign_count(char **args)
+{
+	size_t len;
+	int n = 0;
 
-				i += 2;
-			}
-			else
-			{
-				/* Set file open flags */
-				if (is_input)
-					flags = O_RDONLY;
-				else
-					flags = O_WRONLY | O_CREAT | (is_append ? O_APPEND : O_TRUNC);
-
-				/* Open file */
-				fd = open(tokens[i + 1][0], flags, 0644);
-				if (fd == -1)
-				{
-					/* Print more specific error message */
-					if (is_input && access(tokens[i + 1][0], F_OK) == -1)
-						fprintf(stderr, "%s: %d: %s: No such file or directory\n", program_name, line_count, tokens[i + 1][0]);
-					else if (is_input)
-						fprintf(stderr, "%s: %d: %s: Permission denied\n", program_name, line_count, tokens[i + 1][0]);
-					else
-						fprintf(stderr, "%s: %d: %s: Permission denied\n", program_name, line_count, tokens[i + 1][0]);
-					return (-1);
-				}
+	while (args[n] && (len = var_name_length(args[n])) && args[n][len] == '=')
+		n++;
+	return (n);
+}
 
-				/* Save original fd and redirect */
-				saved_fds[is_input ? 0 : 1] = dup(target_fd);
-				if (saved_fds[is_input ? 0 : 1] == -1)
-				{
-					close(fd);
-					return (-1);
-				}
-				dup2(fd, target_fd);
-				close(fd);
-				i += 2;
-			}
-		}
-		/* Return index when pipe is found */
-		else if (tokens[i][0][0] == '|')
-			return (i);
-	}
-	return (i);
+/**
+ * assign_prefix - Export the assignments written before a command
+ * @args: The command and its arguments
+ *
+ * Only called in the child about to run the command.
+ *
+ * Example:
+ *   args={"LANG=C", "sort", NULL} - Exports LANG=C, returns {"sort", NULL}
+ *
+ * Return: The arguments following the assignments
+ */
+static char **assign_prefix(char **args)
+{
+	int i, n = assign_count(args);
+
+	for (i = 0; i < n; i++)
+		_putenv(args[i]);
+	return (args + n);
 }
 
 /**
- * execute_command - Execute commands with or without pipeline
- * @tokens: The array of tokenized commands
+ * exec_args - Run a command in a child and exit with its status
+ * @args: The command and its arguments, without assignments
  * @program_name: Name of the shell program
  * @line_count: Current line count for error messages
  *
- * Return: Exit status of the last command
+ * Functions are tried first, then built-ins, then programs found in PATH,
+ * which replace the child. A command not found exits with 127, a program
+ * that cannot be run with 126.
  */
-static int execute_command(char ***tokens, char *program_name, int line_count)
+void exec_args(char **args, char *program_name, int line_count)
 {
-	int i = 0, status = 0;
-	int pipe_fds[2][2], curr_pipe = 0;
-	int saved_fds[2] = {-1, -1};
-	pid_t pid;
+	char *command_path;
+	int status;
 
-	/* Check for builtin exit command at the beginning to avoid unnecessary fork */
-	if (tokens[0] && tokens[0][0])
+	if (is_function(args[0]))
 	{
-		/* First check if it's the exit command to handle it specially */
-		if (_strcmp(tokens[0][0], "exit") == 0)
-		{
-			int exit_result = handle_builtin(tokens[0], &status, program_name, line_count);
-			if (exit_result == -1)
-				return (status); /* Return with the exit status */
-		}
-
-		/* Then check if it's any other builtin command without pipes or redirections */
-		int j, has_pipe = 0, has_redir = 0;
-		for (j = 0; tokens[j] != NULL; j++)
-		{
-			if (tokens[j][0])
-			{
-				if (_strcmp(tokens[j][0], "|") == 0)
-					has_pipe = 1;
-				else if (_strchr("><", tokens[j][0][0]) != NULL)
-					has_redir = 1;
-			}
-		}
+		status = func_call(args, program_name, line_count);
+		exit(shell_exiting() ? shell_status() : status);
+	}
+	if (handle_builtin(args, &status, program_name, line_count) != 0)
+		exit(status);
 
-		/* Execute builtin directly if no pipes or redirections are present */
-		if (!has_pipe && !has_redir)
-		{
-			int builtin_result = handle_builtin(tokens[0], &status, program_name, line_count);
-			if (builtin_result == 1)
-				return (status); /* Builtin executed successfully */
-			else if (builtin_result == -1)
-				return (status); /* Exit requested */
-		}
+	command_path = find_command_path(args[0]);
+	if (!command_path)
+	{
+		fprintf(stderr, "%s: %d: %s: not found\n", program_name, line_count, args[0]);
+		exit(127);
 	}
+	stats_add(STAT_EXECS, 1);
+	execve(command_path, args, environ);
+	perror("execve");
+	free(command_path);
+	exit(126);
+}
 
+/**
+ * next_command - Find the command after the next pipe
+ * @tokens: The array of tokenized commands
+ * @i: Index of the current command
+ *
+ * Return: Index of the next command, or -1 if there is none
+ */
+static int next_command(char ***tokens, int i)
+{
+	i++;
 	while (tokens[i] != NULL)
 	{
-		/* Skip empty commands and operators */
-		if (!tokens[i][0] || !tokens[i][0][0] ||
-			_strchr("<>|;", tokens[i][0][0]) ||
-			_strcmp(tokens[i][0], "&&") == 0 ||
-			_strcmp(tokens[i][0], "||") == 0)
+		if (token_kind(tokens[i][0]) == TOK_PIPE)
 		{
 			i++;
-			continue;
+			break;
 		}
+		i++;
+	}
+	return (tokens[i] != NULL ? i : -1);
+}
 
-		 /* Handle builtin commands without forking if not in a pipeline */
-		int j, has_pipe = 0;
+/**
+ * execute_command - Execute commands with or without pipeline
+ * @tokens: The array of tokenized commands, already expanded
+ * @program_name: Name of the shell program
+ * @line_count: Current line count for error messages
+ * @in_place: Set when the shell has nothing left to do after the command
+ *
+ * A function or builtin outside a pipeline runs in the shell, with its
+ * redirections and the assignments written before it applied around it; everything else runs in forked children.
+ * With in_place, a command that is not part of a pipeline replaces the
+ * shell instead: no fork and no wait, the command's status is the shell's.
+ * A stage that is a built-in without redirections runs on a thread.
+ *
+ * Return: Exit status of the last command
+ */
+int execute_command(char ***tokens, char *program_name, int line_count,
+	int in_place)
+{
+	int i = 0, j, status = 0, wstatus, started = 0, threaded = 0, redirected;
+	int pipe_fds[2], prev_in = -1, n;
+	char **cmd;
+	redir_save_t saved;
+	pid_t pid, last = -1;
+
+	/* Run a function or builtin in the shell when not in a pipeline */
+	n = tokens[0] ? assign_count(tokens[0]) : 0;
+	cmd = tokens[0] ? tokens[0] + n : NULL;
+	if (cmd && cmd[0] && (is_function(cmd[0]) || is_builtin(cmd[0])))
+	{
 		for (j = 0; tokens[j] != NULL; j++)
-		{
-			if (tokens[j][0] && _strcmp(tokens[j][0], "|") == 0)
-			{
-				has_pipe = 1;
+			if (token_kind(tokens[j][0]) == TOK_PIPE)
 				break;
-			}
-		}
 
-		if (!has_pipe && tokens[i][0])
+		if (tokens[j] == NULL)
 		{
-			/* Try executing builtin directly */
-			int builtin_result = handle_builtin(tokens[i], &status, program_name, line_count);
-			if (builtin_result == 1)
+			if (setup_redirections(tokens, 1, &saved, program_name, line_count) == -1)
 			{
-				/* Builtin executed successfully */
-				return (status);
+				restore_redirections(&saved);
+				return (1);
 			}
-			else if (builtin_result == -1)
+			/* Assignments before it last as long as the command */
+			if (n && var_prefix_push(tokens[0], n) == -1)
 			{
-				/* Exit requested */
-				exit(status);
+				restore_redirections(&saved);
+				return (1);
 			}
+			stats_add(STAT_COMMANDS, 1);
+			if (is_function(cmd[0]))
+				status = func_call(cmd, program_name, line_count);
+			else if (handle_builtin(cmd, &status, program_name,
+				line_count) == -1)
+				shell_exit(status);
+			if (n)
+				var_scope_pop();
+			restore_redirections(&saved);
+			return (status);
 		}
+	}
 
-		/* Check for pipe after current command */
+	while (tokens[i] != NULL)
+	{
+		/* Skip empty commands and operators */
+		if (!tokens[i][0] || !tokens[i][0][0] || is_operator(tokens[i][0]))
+		{
+			i++;
+			continue;
+		}
+
+		/* Check for pipe after current command and its redirections */
 		int has_next_pipe = 0;
+		redirected = 0;
 		for (j = i + 1; tokens[j] != NULL; j++)
 		{
-			if (tokens[j][0] && _strcmp(tokens[j][0], "|") == 0)
+			if (is_redirection(tokens[j]) && tokens[j + 1])
+			{
+				redirected = 1;
+				j++;
+				continue;
+			}
+			if (token_kind(tokens[j][0]) == TOK_PIPE)
 			{
 				has_next_pipe = 1;
-				if (pipe(pipe_fds[curr_pipe]) == -1)
+				if (pipe(pipe_fds) == -1)
 				{
 					perror("pipe");
+					if (prev_in != -1)
+						close(prev_in);
+					stage_join();
 					return (1);
 				}
-				break;
 			}
-			if (tokens[j][0] && !_strchr("<>", tokens[j][0][0]) && tokens[j][0][0] != '\0')
-				break;
+			break;
 		}
 
-		pid = fork();
+		/* Let the child read stdin from where the shell stopped */
+		input_sync_stdin();
+		path_index_refresh();
+		out_flush_all();
+		stats_add(STAT_COMMANDS, 1);
+		if (!redirected && stage_start(tokens[i], prev_in,
+			has_next_pipe ? pipe_fds[1] : -1, program_name, line_count) == 0)
+		{
+			/* The stage owns its pipes; the next reads the new one */
+			threaded = 1;
+			prev_in = has_next_pipe ? pipe_fds[0] : -1;
+			i = next_command(tokens, i);
+			if (i < 0)
+				break;
+			continue;
+		}
+		threaded = 0;
+		pid = in_place && prev_in == -1 && !has_next_pipe ? 0 : fork();
 		if (pid == -1)
 		{
 			perror("fork");
+			if (prev_in != -1)
+				close(prev_in);
+			if (has_next_pipe)
+			{
+				close(pipe_fds[0]);
+				close(pipe_fds[1]);
+			}
+			stage_join();
 			return (1);
 		}
 
 		if (pid == 0)
 		{
 			/* Child process */
-			char *command_path;
+			char **args;
 
+			stage_forget();
 			/* Set up pipe I/O */
-			if (curr_pipe == 1)
+			if (prev_in != -1)
 			{
-				dup2(pipe_fds[0][0], STDIN_FILENO);
-				close(pipe_fds[0][0]);
-				close(pipe_fds[0][1]);
+				input_stdin_moved();
+				dup2(prev_in, STDIN_FILENO);
+				close(prev_in);
 			}
 
 			if (has_next_pipe)
 			{
-				dup2(pipe_fds[curr_pipe][1], STDOUT_FILENO);
-				close(pipe_fds[curr_pipe][0]);
-				close(pipe_fds[curr_pipe][1]);
+				dup2(pipe_fds[1], STDOUT_FILENO);
+				close(pipe_fds[0]);
+				close(pipe_fds[1]);
 			}
 
 			/* Set up redirections - must be done before trying to read input in builtin or exec */
-			if (setup_redirections(tokens, i + 1, saved_fds, program_name, line_count) == -1)
+			if (setup_redirections(tokens, i + 1, &saved, program_name, line_count) == -1)
 				exit(1);
+			if (saved.fanout != -1)
+				fanout_detach(saved.fanout);
 
-			/* Try builtin commands */
-			if (handle_builtin(tokens[i], &status, program_name, line_count) != 0)
-				exit(status);
+			/* Assignments before the command only affect the command */
+			args = assign_prefix(tokens[i]);
+			if (!args[0])
+				exit(0);
 
-			/* Execute external command */
-			command_path = find_command_path(tokens[i][0]);
-			if (!command_path)
-			{
-				fprintf(stderr, "%s: %d: %s: not found\n", program_name, line_count, tokens[i][0]);
-				/* No need to free NULL pointer */
-				free_tokens(tokens);
-				exit(127);
-			}
-			execve(command_path, tokens[i], environ);
-			perror("execve");
-			free(command_path);
-			free_tokens(tokens); /* Free tokens before exit */
-			exit(1);
+			exec_args(args, program_name, line_count);
 		}
 		else
 		{
 			/* Parent process */
-			/* Close previous pipe */
-			if (curr_pipe == 1)
-			{
-				close(pipe_fds[0][0]);
-				close(pipe_fds[0][1]);
-			}
-
+			stats_add(STAT_FORKS, 1);
+			last = pid;
+			started++;
+			/* The next command reads what this one writes */
+			if (prev_in != -1)
+				close(prev_in);
+			prev_in = -1;
 			if (has_next_pipe)
-				curr_pipe = 1 - curr_pipe;
-
-			/* Find next command */
-			int next_cmd = i + 1;
-
-			while (tokens[next_cmd] != NULL)
 			{
-				if (tokens[next_cmd][0] && _strcmp(tokens[next_cmd][0], "|") == 0)
-				{
-					next_cmd++;
-					break;
-				}
-				next_cmd++;
+				close(pipe_fds[1]);
+				prev_in = pipe_fds[0];
 			}
 
-			i = (tokens[next_cmd] != NULL) ? next_cmd : -1;
+			i = next_command(tokens, i);
 			if (i < 0)
 				break;
 		}
 	}
 
-	/* Wait for child processes */
-	while (wait(&status) > 0)
-		;
-
-	/* Restore redirections */
-	for (int j = 0; j < 2; j++)
-		if (saved_fds[j] != -1)
-		{
-			dup2(saved_fds[j], j);
-			close(saved_fds[j]);
-			saved_fds[j] = -1;
-		}
-
-	return (WIFEXITED(status) ? WEXITSTATUS(status) : 1);
-}
-
-/**
- * interpret_tokens - Interpret tokenized commands
- * @tokens: The array of tokenized commands
- * @program_name: Name of the shell program
- * @line_count: Current line count for error messages
- *
- * Return: Exit status of the command
- */
-int interpret_tokens(char ***tokens, char *program_name, int line_count)
-{
-	int i = 0, j, status = 0;
-	int semicolon_found = 0;
-	int logical_op_found = 0;
-	char ***cmd_segment;
-
-	if (!tokens || !tokens[0] || !tokens[0][0])
-		return (0);
-
-	/* Check if there are any semicolons or logical operators in the command */
-	for (j = 0; tokens[j] != NULL; j++)
+	/*
+	 * Join the threaded stages first: they close their pipes only then,
+	 * and a forked stage reading them waits for that to end.
+	 */
+	j = stage_join();
+
+	/*
+	 * Wait for the stages; the status is the last one's. A process
+	 * substitution ending meanwhile is only marked as reaped, and one
+	 * still reading what the stages wrote is not waited for here.
+	 */
+	while (started > 0 && (pid = stats_wait(-1, &wstatus)) > 0)
 	{
-		if (tokens[j][0])
-		{
-			if (_strcmp(tokens[j][0], ";") == 0)
-			{
-				semicolon_found = 1;
-				break;
-			}
-			else if (_strcmp(tokens[j][0], "&&") == 0 || _strcmp(tokens[j][0], "||") == 0)
-			{
-				logical_op_found = 1;
-			}
-		}
-	}
-
-	/* If no semicolons and no logical operators, just execute the command as is */
-	if (!semicolon_found && !logical_op_found)
-		return (execute_command(tokens, program_name, line_count));
-
-	/* Handle logical operators (&& and ||) without semicolons */
-	if (!semicolon_found && logical_op_found)
-	{
-		j = 0;
-		while (tokens[j] != NULL)
-		{
-			/* Find the next logical operator or end of tokens */
-			int op_index = j;
-			while (tokens[op_index] != NULL &&
-				  (tokens[op_index][0] == NULL ||
-				   (_strcmp(tokens[op_index][0], "&&") != 0 &&
-				    _strcmp(tokens[op_index][0], "||") != 0)))
-				op_index++;
-
-			/* Create temporary array for the current command segment */
-			cmd_segment = malloc(sizeof(char **) * (op_index - j + 1));
-			if (!cmd_segment)
-				return (1);
-
-			/* Copy tokens for the current segment */
-			int k;
-			for (k = 0; j + k < op_index; k++)
-				cmd_segment[k] = tokens[j + k];
-			cmd_segment[k] = NULL;
-
-			/* Execute the command segment */
-			if (cmd_segment[0] != NULL && cmd_segment[0][0] != NULL)
-			{
-				status = execute_command(cmd_segment, program_name, line_count);
-
-				/* Free the temporary array */
-				free(cmd_segment);
-
-				/* Check if we've reached the end */
-				if (tokens[op_index] == NULL)
-					return (status);
-
-				/* Handle && (execute next command only if current succeeded) */
-				if (_strcmp(tokens[op_index][0], "&&") == 0)
-				{
-					if (status != 0)
-					{
-						/* Skip to next semicolon or end */
-						while (tokens[op_index] != NULL &&
-							_strcmp(tokens[op_index][0], ";") != 0)
-							op_index++;
-
-						if (tokens[op_index] == NULL)
-							return (status);
-					}
-				}
-				/* Handle || (execute next command only if current failed) */
-				else if (_strcmp(tokens[op_index][0], "||") == 0)
-				{
-					if (status == 0)
-					{
-						/* Skip to next semicolon or end */
-						while (tokens[op_index] != NULL &&
-							_strcmp(tokens[op_index][0], ";") != 0)
-							op_index++;
-
-						if (tokens[op_index] == NULL)
-							return (status);
-					}
-				}
-
-				j = op_index + 1;
-			}
-			else
-			{
-				/* Empty command segment */
-				free(cmd_segment);
-				j = op_index + 1;
-			}
-		}
-		return (status);
-	}
-
-	/* Handle multiple commands separated by semicolons */
-	while (tokens[i] != NULL)
-	{
-		j = i;
-		/* Find the next semicolon or the end of tokens */
-		while (tokens[j] != NULL &&
-			  (tokens[j][0] == NULL || _strcmp(tokens[j][0], ";") != 0))
-			j++;
-
-		/* Create a temporary array for the current command segment */
-		cmd_segment = malloc(sizeof(char **) * (j - i + 1));
-		if (!cmd_segment)
-			return (1);
-
-		/* Copy tokens for the current command segment */
-		int k;
-		for (k = 0; i + k < j; k++)
-			cmd_segment[k] = tokens[i + k];
-		cmd_segment[k] = NULL;
-
-		/* Execute the current command segment */
-		if (cmd_segment[0] != NULL && cmd_segment[0][0] != NULL)
-			status = execute_command(cmd_segment, program_name, line_count);
-
-		/* Free the temporary array (but not its contents) */
-		free(cmd_segment);
-
-		/* Skip the semicolon token */
-		i = j;
-		if (tokens[i] != NULL)
-			i++;
+		if (subst_reaped(pid))
+			continue;
+		started--;
+		if (pid == last)
+			status = wstatus;
 	}
 
-	return (status);
+	if (threaded)
+		return (j);
+	return (WIFEXITED(status) ? WEXITSTATUS(status) : 1);
 }
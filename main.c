@@ -1,22 +1,5 @@
 #include "hsh.h"
 
-/**
- * _is_whitespace_only - Check if a string contains only whitespace
- * @str: The string to check
- *
- * Return: 1 if the string contains only whitespace, 0 otherwise
- */
-static int _is_whitespace_only(const char *str)
-{
-	while (*str)
-	{
-		if (!_isspace((unsigned char)*str))
-			return (0);
-		str++;
-	}
-	return (1);
-}
-
 /**
  * main - Entry point for the shell program
  * @argc: Argument count
@@ -30,102 +13,88 @@ static int _is_whitespace_only(const char *str)
  * Example:
  *   ./hsh
  *   ./hsh "ls -l"
+ *   ./hsh -c "ls -l"
+ *   ./hsh --startup-profile -c true
+ *   ./hsh --serve /run/hsh.sock
  */
 int main(int argc, char **argv)
 {
 	prompt_t *prompt;
-	char ***tokens;
-	int status = 0;
+	source_t src = {NULL, NULL, 0, 1};
+	char *command = NULL, *serve_path = NULL;
+	int status = 0, arg = 1, profile = 0;
 	(void)argc;
 
-	/* Initialize the prompt structure */
-	prompt = init_prompt();
-	if (!prompt)
+	startup_begin();
+	stats_init();
+	atexit(out_flush_all);
+	atexit(input_end);
+	input_init();
+	shell_init(argv[0]);
+
+	/* Parse options */
+	if (argv[arg] && _strcmp(argv[arg], "--startup-profile") == 0)
 	{
-		perror("Failed to initialize prompt");
-		return (EXIT_FAILURE);
+		profile = 1;
+		arg++;
 	}
-
-	/* Handle non-interactive mode with command line argument */
-	if (argv[1])
+	if (argv[arg] && _strcmp(argv[arg], "--serve") == 0)
 	{
-		/* Check if argument is empty or just whitespace */
-		if (!argv[1][0] || _is_whitespace_only(argv[1]))
-		{
-			free_prompt(prompt);
-			return (0);
-		}
-
-		tokens = tokenize_command(argv[1]);
-		if (!tokens)
+		serve_path = argv[arg + 1];
+		if (!serve_path)
 		{
-			perror("Failed to tokenize command");
-			free_prompt(prompt);
-			return (EXIT_FAILURE);
+			fprintf(stderr, "%s: --serve: option requires an argument\n", argv[0]);
+			return (2);
 		}
-		status = interpret_tokens(tokens, argv[0], 0);
-		free_tokens(tokens);
-		free_prompt(prompt);
-		return (status);
 	}
-
-	/* Handle non-interactive mode with stdin input */
-	if (!isatty(STDIN_FILENO))
+	else if (argv[arg] && _strcmp(argv[arg], "-c") == 0)
 	{
-		char *buffer = NULL;
-		size_t buffer_size = 0;
-		ssize_t read_bytes;
-
-		/* Read all commands from stdin */
-		while ((read_bytes = getline(&buffer, &buffer_size, stdin)) != -1)
+		command = argv[arg + 1];
+		if (!command)
 		{
-			/* Remove newline if present */
-			if (read_bytes > 0 && buffer[read_bytes - 1] == '\n')
-				buffer[read_bytes - 1] = '\0';
-
-			/* Skip empty lines or whitespace-only lines */
-			if (buffer[0] == '\0' || _is_whitespace_only(buffer))
-				continue;
-
-			/* Process the command */
-			tokens = tokenize_command(buffer);
-			if (tokens)
-			{
-				status = interpret_tokens(tokens, argv[0], 0);
-				free_tokens(tokens);
-			}
+			fprintf(stderr, "%s: -c: option requires an argument\n", argv[0]);
+			return (2);
 		}
-		free(buffer);
-		cleanup_environment();
-		free_prompt(prompt);
-		return (status);
 	}
+	else
+		command = argv[arg];
 
-	/* Interactive shell mode */
-	while (get_prompt(prompt) != -1)
+	/* Initialize the prompt structure */
+	prompt = init_prompt();
+	if (!prompt)
 	{
-		/* Skip empty lines or whitespace-only lines */
-		if (!prompt->input || prompt->size == 0 || _is_whitespace_only(prompt->input))
-			continue;
+		perror("Failed to initialize prompt");
+		return (EXIT_FAILURE);
+	}
 
-		tokens = tokenize_command(prompt->input);
-		if (!tokens)
-		{
-			fprintf(stderr, "%s: line %d: Failed to tokenize command\n",
-				argv[0], prompt->line_count);
-			continue;
-		}
+	startup_init(argv[0], !command && !serve_path && shell_interactive());
+	if (profile)
+		startup_report();
 
-		status = interpret_tokens(tokens, argv[0], prompt->line_count);
-		free_tokens(tokens);
-	}
+	/* Commands come from clients, the argument, a terminal, or stdin */
+	if (serve_path)
+		status = serve(serve_path, argv[0]);
+	else if (command)
+		src.in = input_string(command);
+	else if (shell_interactive())
+		src.prompt = prompt;
+	else
+		src.in = input_stdin();
+
+	if (src.in || src.prompt)
+		status = run_source(&src, argv[0]);
+	input_close(src.in);
 
-	/* If using interactive mode, print a newline before exiting */
-	if (isatty(STDIN_FILENO))
+	/* At end of input on a terminal, end the prompt line */
+	if (src.prompt && !shell_exiting())
 		write(STDOUT_FILENO, "\n", 1);
 
 	/* Clean up and return the status of the last command */
+	func_free_all();
+	var_free_all();
+	intern_free();
 	cleanup_environment();
 	free_prompt(prompt);
+	pool_release();
 	return (status);
 }
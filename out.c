@@ -0,0 +1,207 @@
+#include "hsh.h"
+
+#define OUT_BUF (64 * 1024)
+
+/**
+ * struct out_s - Pending output of a descriptor
+ * @buf: Bytes not written yet
+ * @len: Number of bytes in buf
+ */
+typedef struct out_s
+{
+	char	buf[OUT_BUF];
+	size_t	len;
+} out_t;
+
+/*
+ * Standard output and standard error, and which was written to last. Each
+ * thread has its own, so a built-in run on a thread writes on its own.
+ */
+static _Thread_local out_t outs[2];
+static _Thread_local int out_last = -1;
+
+/* Descriptor standard output and standard error go to in this thread */
+static _Thread_local int out_fds[2] = {STDOUT_FILENO, STDERR_FILENO};
+
+/**
+ * out_writev - Write whole buffers to a descriptor
+ * @fd: The descriptor
+ * @iov: The buffers, updated as they are written
+ * @count: Number of buffers
+ *
+ * Return: 0 on success, -1 on failure
+ */
+static int out_writev(int fd, struct iovec *iov, int count)
+{
+	ssize_t n;
+
+	while (count > 0)
+	{
+		n = writev(fd, iov, count);
+		if (n == -1 && errno == EINTR)
+			continue;
+		if (n == -1)
+			return (-1);
+		while (count > 0 && (size_t)n >= iov->iov_len)
+		{
+			n -= iov->iov_len;
+			iov++;
+			count--;
+		}
+		if (count > 0)
+		{
+			iov->iov_base = (char *)iov->iov_base + n;
+			iov->iov_len -= n;
+		}
+	}
+	return (0);
+}
+
+/**
+ * out_flush - Write the pending output of a descriptor
+ * @fd: STDOUT_FILENO or STDERR_FILENO
+ *
+ * Return: 0 on success, -1 on failure; the output is dropped either way
+ */
+int out_flush(int fd)
+{
+	struct iovec iov;
+	out_t *o;
+
+	if (fd < 1 || fd > 2 || outs[fd - 1].len == 0)
+		return (0);
+	o = &outs[fd - 1];
+	iov.iov_base = o->buf;
+	iov.iov_len = o->len;
+	o->len = 0;
+	return (out_writev(out_fds[fd - 1], &iov, 1));
+}
+
+/**
+ * out_flush_all - Write all pending output
+ *
+ * Called before the shell forks, execs, moves a descriptor or exits, so
+ * nothing is written twice, lost, or sent to the wrong file.
+ */
+void out_flush_all(void)
+{
+	out_flush(STDOUT_FILENO);
+	out_flush(STDERR_FILENO);
+}
+
+/**
+ * out_write - Write bytes to standard output or standard error
+ * @fd: The descriptor; others are written to directly
+ * @s: The bytes
+ * @len: Number of bytes
+ *
+ * Bytes are kept until the buffer is full or out_flush_all runs. Writing
+ * to the other descriptor first flushes this one, so the order between
+ * the two is kept when they are the same file. Data that does not fit is
+ * written together with the buffer in a single writev.
+ *
+ * Return: 0 on success, -1 on failure
+ */
+int out_write(int fd, const char *s, size_t len)
+{
+	struct iovec iov[2];
+	out_t *o;
+
+	if (fd < 1 || fd > 2)
+	{
+		iov[0].iov_base = (char *)s;
+		iov[0].iov_len = len;
+		return (out_writev(fd, iov, 1));
+	}
+	if (out_last != -1 && out_last != fd)
+		out_flush(out_last);
+	out_last = fd;
+	o = &outs[fd - 1];
+	if (o->len + len <= OUT_BUF)
+	{
+		memcpy(o->buf + o->len, s, len);
+		o->len += len;
+		return (0);
+	}
+	iov[0].iov_base = o->buf;
+	iov[0].iov_len = o->len;
+	iov[1].iov_base = (char *)s;
+	iov[1].iov_len = len;
+	o->len = 0;
+	return (out_writev(out_fds[fd - 1], iov, 2));
+}
+
+/**
+ * out_redirect - Send the output of this thread to another descriptor
+ * @fd: STDOUT_FILENO or STDERR_FILENO
+ * @to: The descriptor to write instead
+ *
+ * Lets a built-in run on a thread write to its own pipe while the shell
+ * keeps its descriptors: fds 0 to 2 are shared by every thread, so they
+ * cannot be moved with dup2.
+ */
+void out_redirect(int fd, int to)
+{
+	if (fd >= 1 && fd <= 2)
+		out_fds[fd - 1] = to;
+}
+
+/**
+ * out_puts - Write a string to standard output or standard error
+ * @fd: The descriptor
+ * @s: The string
+ *
+ * Return: 0 on success, -1 on failure
+ */
+int out_puts(int fd, const char *s)
+{
+	return (out_write(fd, s, _strlen(s)));
+}
+
+/**
+ * out_printf - Write formatted output to standard output or standard error
+ * @fd: The descriptor
+ * @format: printf format
+ *
+ * Formats straight into the buffer when the result fits in it.
+ *
+ * Example:
+ *   out_printf(STDERR_FILENO, "%s: %d: cd: can't cd to %s\n", ...);
+ *
+ * Return: 0 on success, -1 on failure
+ */
+int out_printf(int fd, const char *format, ...)
+{
+	va_list ap;
+	out_t *o;
+	char *tmp;
+	int n, r;
+
+	va_start(ap, format);
+	if (fd >= 1 && fd <= 2 && (out_last == fd || out_last == -1))
+	{
+		o = &outs[fd - 1];
+		n = vsnprintf(o->buf + o->len, OUT_BUF - o->len, format, ap);
+		va_end(ap);
+		if (n >= 0 && o->len + n < OUT_BUF)
+		{
+			o->len += n;
+			out_last = fd;
+			return (0);
+		}
+		va_start(ap, format);
+	}
+	n = vsnprintf(NULL, 0, format, ap);
+	va_end(ap);
+	if (n < 0)
+		return (-1);
+	tmp = malloc(n + 1);
+	if (!tmp)
+		return (-1);
+	va_start(ap, format);
+	vsnprintf(tmp, n + 1, format, ap);
+	va_end(ap);
+	r = out_write(fd, tmp, n);
+	free(tmp);
+	return (r);
+}
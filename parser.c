@@ -0,0 +1,852 @@
+#include "hsh.h"
+
+/**
+ * struct parser_s - Position of the parser in the tokens
+ * @tok: The tokens
+ * @seg: Current segment
+ * @word: Current word in the segment
+ * @state: PARSE_OK, PARSE_INCOMPLETE or PARSE_ERROR
+ * @what: Token found, or keyword expected, when parsing stopped
+ */
+typedef struct parser_s
+{
+	char		***tok;
+	int			seg;
+	int			word;
+	int			state;
+	const char	*what;
+} parser_t;
+
+static node_t *parse_list(parser_t *p);
+static node_t *parse_command(parser_t *p);
+
+/**
+ * is_operator - Tell whether a token is an operator
+ * @s: The token
+ *
+ * Operators are told from words by their kind, not their text, so a word
+ * never counts as one.
+ *
+ * Return: 1 if it is, 0 otherwise
+ */
+int is_operator(const char *s)
+{
+	return (token_kind(s) != TOK_WORD);
+}
+
+/**
+ * peek - Get the current token
+ * @p: The parser
+ *
+ * Return: The token, or NULL at the end of the tokens
+ */
+static char *peek(parser_t *p)
+{
+	while (p->tok[p->seg] && !p->tok[p->seg][p->word])
+	{
+		p->seg++;
+		p->word = 0;
+	}
+	return (p->tok[p->seg] ? p->tok[p->seg][p->word] : NULL);
+}
+
+/**
+ * next - Move past the current token
+ * @p: The parser
+ */
+static void next(parser_t *p)
+{
+	if (peek(p))
+		p->word++;
+}
+
+/**
+ * at - Tell whether the current token is a given one
+ * @p: The parser
+ * @s: The token
+ *
+ * Return: 1 if it is, 0 otherwise
+ */
+static int at(parser_t *p, const char *s)
+{
+	char *t = peek(p);
+
+	return (t && _strcmp(t, s) == 0);
+}
+
+/**
+ * at_op - Tell whether the current token is a given operator
+ * @p: The parser
+ * @kind: The kind of operator
+ *
+ * Return: 1 if it is, 0 otherwise
+ */
+static int at_op(parser_t *p, tok_kind_t kind)
+{
+	char *t = peek(p);
+
+	return (t && token_kind(t) == kind);
+}
+
+/**
+ * fail - Stop parsing at the current token
+ * @p: The parser
+ * @expected: Keyword expected when the tokens ran out, or NULL
+ *
+ * Return: Always NULL
+ */
+static node_t *fail(parser_t *p, const char *expected)
+{
+	if (p->state != PARSE_OK)
+		return (NULL);
+	p->what = peek(p);
+	p->state = p->what ? PARSE_ERROR : PARSE_INCOMPLETE;
+	if (!p->what)
+		p->what = expected;
+	return (NULL);
+}
+
+/**
+ * fail_target - Stop parsing at a redirection without a target
+ * @p: The parser, on the redirection
+ *
+ * Return: Always NULL
+ */
+static node_t *fail_target(parser_t *p)
+{
+	p->seg++;
+	p->word = 0;
+	if (p->state == PARSE_OK)
+	{
+		p->state = PARSE_ERROR;
+		p->what = p->tok[p->seg] ? p->tok[p->seg][0] : "\n";
+	}
+	return (NULL);
+}
+
+/**
+ * expect - Consume a keyword or operator that must come next
+ * @p: The parser
+ * @s: The keyword
+ *
+ * Return: 1 on success, 0 on failure
+ */
+static int expect(parser_t *p, const char *s)
+{
+	if (p->state != PARSE_OK)
+		return (0);
+	if (!at(p, s))
+	{
+		fail(p, s);
+		return (0);
+	}
+	next(p);
+	return (1);
+}
+
+/**
+ * skip_newlines - Move past newlines
+ * @p: The parser
+ */
+static void skip_newlines(parser_t *p)
+{
+	while (at_op(p, TOK_NEWLINE))
+		next(p);
+}
+
+/**
+ * ends_list - Tell whether the current token ends a list
+ * @p: The parser
+ *
+ * Return: 1 if it does, 0 otherwise
+ */
+static int ends_list(parser_t *p)
+{
+	static const char *const ends[] = {
+		"then", "elif", "else", "fi", "do", "done", "esac", "}", NULL
+	};
+	char *t = peek(p);
+	int i;
+
+	if (!t || token_kind(t) == TOK_RPAREN || token_kind(t) == TOK_DSEMI)
+		return (1);
+	if (token_kind(t) != TOK_WORD)
+		return (0);
+	for (i = 0; ends[i]; i++)
+		if (_strcmp(t, ends[i]) == 0)
+			return (1);
+	return (0);
+}
+
+/**
+ * new_node - Allocate a node
+ * @p: The parser
+ * @type: Type of the node
+ *
+ * Return: The node, or NULL on failure
+ */
+static node_t *new_node(parser_t *p, node_type_t type)
+{
+	node_t *node = malloc(sizeof(node_t));
+
+	if (!node)
+	{
+		p->state = PARSE_ERROR;
+		p->what = "out of memory";
+		return (NULL);
+	}
+	memset(node, 0, sizeof(node_t));
+	node->type = type;
+	return (node);
+}
+
+/**
+ * is_compound_start - Tell whether a command starts with a compound keyword
+ * @s: First token of the command
+ *
+ * Return: 1 if it does, 0 otherwise
+ */
+static int is_compound_start(const char *s)
+{
+	return (_strcmp(s, "if") == 0 || _strcmp(s, "while") == 0 ||
+		_strcmp(s, "until") == 0 || _strcmp(s, "for") == 0 ||
+		_strcmp(s, "case") == 0 || _strcmp(s, "{") == 0 ||
+		token_kind(s) == TOK_LPAREN || _strcmp(s, "!") == 0);
+}
+
+/**
+ * parse_simple - Parse a run of simple commands joined by pipes
+ * @p: The parser
+ *
+ * The run is stored as segments for execute_command, pointing into the
+ * tokens. It stops before a pipe into a compound command.
+ *
+ * Return: The node, or NULL on failure
+ */
+static node_t *parse_simple(parser_t *p)
+{
+	char **parts[MAX_TOKENS], *t;
+	int n = 0, seg;
+	node_t *node;
+
+	t = peek(p);
+	if (!is_redirection(p->tok[p->seg]) || p->word)
+	{
+		if (!t || is_operator(t))
+			return (fail(p, NULL));
+		parts[n++] = &p->tok[p->seg][p->word];
+		p->seg++;
+		p->word = 0;
+	}
+	while (p->tok[p->seg] && n < MAX_TOKENS - 3)
+	{
+		if (is_redirection(p->tok[p->seg]))
+		{
+			if (!p->tok[p->seg + 1] || is_operator(p->tok[p->seg + 1][0]))
+				return (fail_target(p));
+			parts[n++] = p->tok[p->seg++];
+			parts[n++] = p->tok[p->seg++];
+			continue;
+		}
+		if (!at_op(p, TOK_PIPE))
+			break;
+		/* Look past the pipe and any newline for a simple command */
+		for (seg = p->seg + 1; p->tok[seg] && token_kind(p->tok[seg][0]) == TOK_NEWLINE;
+			seg++)
+			;
+		if (!p->tok[seg] || is_operator(p->tok[seg][0]) ||
+			is_compound_start(p->tok[seg][0]))
+			break;
+		parts[n++] = p->tok[p->seg];
+		parts[n++] = p->tok[seg];
+		p->seg = seg + 1;
+	}
+
+	node = new_node(p, NODE_COMMAND);
+	if (!node)
+		return (NULL);
+	node->cmd = malloc(sizeof(char **) * (n + 1));
+	if (!node->cmd)
+	{
+		free(node);
+		return (fail(p, NULL));
+	}
+	memcpy(node->cmd, parts, sizeof(char **) * n);
+	node->cmd[n] = NULL;
+	return (node);
+}
+
+/**
+ * parse_redirections - Parse the redirections following a compound command
+ * @p: The parser
+ * @node: The compound command
+ *
+ * Return: The node, or NULL on failure
+ */
+static node_t *parse_redirections(parser_t *p, node_t *node)
+{
+	char **parts[MAX_TOKENS];
+	int n = 0;
+
+	if (!node || !peek(p) || p->word)
+		return (node);
+	while (is_redirection(p->tok[p->seg]) && n < MAX_TOKENS - 2)
+	{
+		if (!p->tok[p->seg + 1] || is_operator(p->tok[p->seg + 1][0]))
+		{
+			node_free(node);
+			return (fail_target(p));
+		}
+		parts[n++] = p->tok[p->seg++];
+		parts[n++] = p->tok[p->seg++];
+	}
+	if (!n)
+		return (node);
+	node->redirs = malloc(sizeof(char **) * (n + 1));
+	if (!node->redirs)
+	{
+		node_free(node);
+		return (fail(p, NULL));
+	}
+	memcpy(node->redirs, parts, sizeof(char **) * n);
+	node->redirs[n] = NULL;
+	return (node);
+}
+
+/**
+ * parse_body - Parse a compound list that may not be empty
+ * @p: The parser
+ * @expected: Keyword that closes the list, for an incomplete input
+ *
+ * Only the body of a case arm may be empty; "while do done" or "f() { }"
+ * are syntax errors.
+ *
+ * Return: The first command, or NULL on failure
+ */
+static node_t *parse_body(parser_t *p, const char *expected)
+{
+	node_t *list = parse_list(p);
+
+	if (!list)
+		fail(p, expected);
+	return (list);
+}
+
+/**
+ * parse_if - Parse an if command
+ * @p: The parser, on "if" or "elif"
+ *
+ * Return: The node, or NULL on failure
+ */
+static node_t *parse_if(parser_t *p)
+{
+	node_t *node = new_node(p, NODE_IF);
+
+	if (!node)
+		return (NULL);
+	next(p);
+	node->left = parse_body(p, "then");
+	if (expect(p, "then"))
+		node->right = parse_body(p, "fi");
+	if (p->state == PARSE_OK && at(p, "elif"))
+		node->alt = parse_if(p);
+	else
+	{
+		if (p->state == PARSE_OK && at(p, "else"))
+		{
+			next(p);
+			node->alt = parse_body(p, "fi");
+		}
+		expect(p, "fi");
+	}
+	if (p->state != PARSE_OK)
+	{
+		node_free(node);
+		return (NULL);
+	}
+	return (node);
+}
+
+/**
+ * parse_loop - Parse a while or until loop
+ * @p: The parser, on "while" or "until"
+ *
+ * Return: The node, or NULL on failure
+ */
+static node_t *parse_loop(parser_t *p)
+{
+	node_t *node = new_node(p, at(p, "while") ? NODE_WHILE : NODE_UNTIL);
+
+	if (!node)
+		return (NULL);
+	next(p);
+	node->left = parse_body(p, "do");
+	if (expect(p, "do"))
+	{
+		node->right = parse_body(p, "done");
+		expect(p, "done");
+	}
+	if (p->state != PARSE_OK)
+	{
+		node_free(node);
+		return (NULL);
+	}
+	return (node);
+}
+
+/**
+ * parse_for - Parse a for loop
+ * @p: The parser, on "for"
+ *
+ * The words of "in" are the rest of the segment, used in place.
+ *
+ * Return: The node, or NULL on failure
+ */
+static node_t *parse_for(parser_t *p)
+{
+	static char *no_words[] = {"\"$@\"", NULL};
+	node_t *node = new_node(p, NODE_FOR);
+	char *t;
+
+	if (!node)
+		return (NULL);
+	next(p);
+	t = peek(p);
+	if (!t || is_operator(t) || var_name_length(t) != (size_t)_strlen(t))
+	{
+		free(node);
+		return (fail(p, "name"));
+	}
+	node->name = t;
+	node->words = no_words;
+	next(p);
+	if (at(p, "in") && p->word)
+	{
+		next(p);
+		node->words = &p->tok[p->seg][p->word];
+		p->seg++;
+		p->word = 0;
+	}
+	if (at_op(p, TOK_SEMI))
+		next(p);
+	skip_newlines(p);
+	if (expect(p, "do"))
+	{
+		node->right = parse_body(p, "done");
+		expect(p, "done");
+	}
+	if (p->state != PARSE_OK)
+	{
+		node_free(node);
+		return (NULL);
+	}
+	return (node);
+}
+
+/**
+ * parse_arm - Parse one arm of a case command
+ * @p: The parser, on the first pattern or its "("
+ *
+ * Return: The arm, or NULL on failure
+ */
+static case_arm_t *parse_arm(parser_t *p)
+{
+	char *patterns[MAX_TOKENS], *t;
+	case_arm_t *arm;
+	int n = 0;
+
+	if (at_op(p, TOK_LPAREN))
+		next(p);
+	do {
+		if (n && at_op(p, TOK_PIPE))
+			next(p);
+		t = peek(p);
+		if (!t || is_operator(t) || n == MAX_TOKENS - 1)
+			return ((case_arm_t *)fail(p, ")"));
+		patterns[n++] = t;
+		next(p);
+	} while (at_op(p, TOK_PIPE));
+	if (!expect(p, ")"))
+		return (NULL);
+
+	arm = malloc(sizeof(case_arm_t));
+	if (arm)
+	{
+		arm->patterns = malloc(sizeof(char *) * (n + 1));
+		arm->compiled = malloc(sizeof(pattern_t *) * n);
+	}
+	if (!arm || !arm->patterns || !arm->compiled)
+	{
+		if (arm)
+		{
+			free(arm->patterns);
+			free(arm->compiled);
+		}
+		free(arm);
+		return ((case_arm_t *)fail(p, NULL));
+	}
+	memcpy(arm->patterns, patterns, sizeof(char *) * n);
+	arm->patterns[n] = NULL;
+	memset(arm->compiled, 0, sizeof(pattern_t *) * n);
+	arm->next = NULL;
+	arm->body = parse_list(p);
+	if (p->state == PARSE_OK && at_op(p, TOK_DSEMI))
+		next(p);
+	skip_newlines(p);
+	return (arm);
+}
+
+/**
+ * parse_case - Parse a case command
+ * @p: The parser, on "case"
+ *
+ * Return: The node, or NULL on failure
+ */
+static node_t *parse_case(parser_t *p)
+{
+	node_t *node = new_node(p, NODE_CASE);
+	case_arm_t **last;
+	char *t;
+
+	if (!node)
+		return (NULL);
+	next(p);
+	t = peek(p);
+	if (!t || is_operator(t))
+	{
+		free(node);
+		return (fail(p, "word"));
+	}
+	node->name = t;
+	next(p);
+	skip_newlines(p);
+	expect(p, "in");
+	skip_newlines(p);
+	last = &node->arms;
+	while (p->state == PARSE_OK && !at(p, "esac"))
+	{
+		*last = parse_arm(p);
+		if (*last)
+			last = &(*last)->next;
+	}
+	expect(p, "esac");
+	if (p->state != PARSE_OK)
+	{
+		node_free(node);
+		return (NULL);
+	}
+	return (node);
+}
+
+/**
+ * parse_group - Parse a { list; } group or a ( list ) subshell
+ * @p: The parser, on "{" or "("
+ *
+ * Return: The node, or NULL on failure
+ */
+static node_t *parse_group(parser_t *p)
+{
+	int subshell = at_op(p, TOK_LPAREN);
+	node_t *node = new_node(p, subshell ? NODE_SUBSHELL : NODE_BRACE);
+
+	if (!node)
+		return (NULL);
+	next(p);
+	node->left = parse_body(p, subshell ? ")" : "}");
+	expect(p, subshell ? ")" : "}");
+	if (p->state != PARSE_OK)
+	{
+		node_free(node);
+		return (NULL);
+	}
+	return (node);
+}
+
+/**
+ * at_function - Tell whether a function definition starts here
+ * @p: The parser
+ *
+ * Return: 1 if the current word is a name followed by "(" and ")"
+ */
+static int at_function(parser_t *p)
+{
+	char *t = peek(p), ***tok = p->tok + p->seg;
+
+	return (t && !is_operator(t) && !tok[0][p->word + 1] &&
+		var_name_length(t) == (size_t)_strlen(t) &&
+		tok[1] && token_kind(tok[1][0]) == TOK_LPAREN &&
+		tok[2] && token_kind(tok[2][0]) == TOK_RPAREN);
+}
+
+/**
+ * parse_function - Parse a function definition
+ * @p: The parser, on the name of the function
+ *
+ * The body is a compound command, kept with its redirections.
+ *
+ * Return: The node, or NULL on failure
+ */
+static node_t *parse_function(parser_t *p)
+{
+	node_t *node = new_node(p, NODE_FUNCTION);
+	char *t;
+
+	if (!node)
+		return (NULL);
+	node->name = peek(p);
+	p->seg += 3;
+	p->word = 0;
+	skip_newlines(p);
+	t = peek(p);
+	if (!t || !is_compound_start(t) || _strcmp(t, "!") == 0)
+	{
+		free(node);
+		return (fail(p, "{"));
+	}
+	node->left = parse_command(p);
+	if (!node->left)
+	{
+		free(node);
+		return (NULL);
+	}
+	return (node);
+}
+
+/**
+ * parse_command - Parse a simple or compound command
+ * @p: The parser
+ *
+ * Return: The node, or NULL on failure
+ */
+static node_t *parse_command(parser_t *p)
+{
+	char *t = peek(p);
+	node_t *node;
+
+	if (!t)
+		return (fail(p, NULL));
+	if (_strcmp(t, "!") == 0)
+	{
+		node = new_node(p, NODE_NOT);
+		if (!node)
+			return (NULL);
+		next(p);
+		node->left = parse_command(p);
+		if (!node->left)
+		{
+			free(node);
+			return (NULL);
+		}
+		return (node);
+	}
+	if (_strcmp(t, "if") == 0)
+		node = parse_if(p);
+	else if (_strcmp(t, "while") == 0 || _strcmp(t, "until") == 0)
+		node = parse_loop(p);
+	else if (_strcmp(t, "for") == 0)
+		node = parse_for(p);
+	else if (_strcmp(t, "case") == 0)
+		node = parse_case(p);
+	else if (_strcmp(t, "{") == 0 || token_kind(t) == TOK_LPAREN)
+		node = parse_group(p);
+	else if (at_function(p))
+		return (parse_function(p));
+	else
+		return (parse_simple(p));
+	return (parse_redirections(p, node));
+}
+
+/**
+ * parse_pipeline - Parse commands joined by pipes
+ * @p: The parser
+ *
+ * Pipes between simple commands stay inside a NODE_COMMAND; a pipe with a
+ * compound command on either side becomes a NODE_PIPE.
+ *
+ * Return: The node, or NULL on failure
+ */
+static node_t *parse_pipeline(parser_t *p)
+{
+	node_t *node = parse_command(p), *pipe_node;
+
+	while (node && at_op(p, TOK_PIPE))
+	{
+		next(p);
+		skip_newlines(p);
+		pipe_node = new_node(p, NODE_PIPE);
+		if (!pipe_node)
+		{
+			node_free(node);
+			return (NULL);
+		}
+		pipe_node->left = node;
+		pipe_node->right = parse_command(p);
+		node = pipe_node;
+		if (!node->right)
+		{
+			node_free(node);
+			return (NULL);
+		}
+	}
+	return (node);
+}
+
+/**
+ * parse_and_or - Parse pipelines joined by && and ||
+ * @p: The parser
+ *
+ * Return: The node, or NULL on failure
+ */
+static node_t *parse_and_or(parser_t *p)
+{
+	node_t *node = parse_pipeline(p), *op;
+
+	while (node && (at_op(p, TOK_AND) || at_op(p, TOK_OR)))
+	{
+		op = new_node(p, at_op(p, TOK_AND) ? NODE_AND : NODE_OR);
+		if (!op)
+		{
+			node_free(node);
+			return (NULL);
+		}
+		next(p);
+		skip_newlines(p);
+		op->left = node;
+		op->right = parse_pipeline(p);
+		node = op;
+		if (!node->right)
+		{
+			node_free(node);
+			return (NULL);
+		}
+	}
+	return (node);
+}
+
+/**
+ * parse_list - Parse commands separated by ';', '&' or newlines
+ * @p: The parser
+ *
+ * The commands are chained through their next pointer. The list ends at
+ * a keyword closing the enclosing command, or at the end of the tokens.
+ *
+ * Return: The first command, or NULL when empty or on failure
+ */
+static node_t *parse_list(parser_t *p)
+{
+	node_t *first = NULL, **last = &first;
+
+	skip_newlines(p);
+	while (p->state == PARSE_OK && !ends_list(p))
+	{
+		*last = parse_and_or(p);
+		if (!*last)
+			break;
+		last = &(*last)->next;
+		if (at_op(p, TOK_SEMI) || at_op(p, TOK_BACKGROUND))
+			next(p);
+		else if (!at_op(p, TOK_NEWLINE) && !ends_list(p))
+			fail(p, NULL);
+		skip_newlines(p);
+	}
+	if (p->state != PARSE_OK)
+	{
+		node_free(first);
+		return (NULL);
+	}
+	return (first);
+}
+
+/**
+ * parse_tokens - Parse tokens into a tree of commands
+ * @tokens: Segments as produced by tokenize_command
+ * @root: Set to the first command, NULL for an empty input
+ * @what: Set to the offending token, or the expected keyword
+ *
+ * The tree points into the tokens, which must outlive it.
+ *
+ * Example:
+ *   "if true; then ls; fi" - PARSE_OK
+ *   "while true; do"       - PARSE_INCOMPLETE, more lines are needed
+ *   "fi"                   - PARSE_ERROR, what is "fi"
+ *
+ * Return: PARSE_OK, PARSE_INCOMPLETE or PARSE_ERROR
+ */
+int parse_tokens(char ***tokens, node_t **root, const char **what)
+{
+	parser_t p = {NULL, 0, 0, PARSE_OK, NULL};
+
+	p.tok = tokens;
+	*root = parse_list(&p);
+	if (p.state == PARSE_OK && peek(&p))
+		fail(&p, NULL);
+	if (p.state != PARSE_OK)
+	{
+		node_free(*root);
+		*root = NULL;
+	}
+	*what = p.what;
+	return (p.state);
+}
+
+/**
+ * parse_report - Print a syntax error
+ * @program_name: Name of the shell program
+ * @line_count: Line of the error
+ * @state: PARSE_INCOMPLETE or PARSE_ERROR
+ * @what: Token or keyword reported by parse_tokens
+ *
+ * Example:
+ *   ./hsh: 3: Syntax error: "fi" unexpected
+ *   ./hsh: 5: Syntax error: end of file unexpected (expecting "done")
+ */
+void parse_report(char *program_name, int line_count, int state,
+	const char *what)
+{
+	if (state == PARSE_INCOMPLETE && what)
+		fprintf(stderr, "%s: %d: Syntax error: end of file unexpected "
+			"(expecting \"%s\")\n", program_name, line_count, what);
+	else if (state == PARSE_INCOMPLETE)
+		fprintf(stderr, "%s: %d: Syntax error: end of file unexpected\n",
+			program_name, line_count);
+	else if (!what || _strcmp(what, "\n") == 0)
+		fprintf(stderr, "%s: %d: Syntax error: newline unexpected\n",
+			program_name, line_count);
+	else
+		fprintf(stderr, "%s: %d: Syntax error: \"%s\" unexpected\n",
+			program_name, line_count, what);
+}
+
+/**
+ * node_free - Free a tree of commands
+ * @node: First command of the tree, may be NULL
+ *
+ * The tokens the tree points into are not freed.
+ */
+void node_free(node_t *node)
+{
+	node_t *next_node;
+	case_arm_t *arm, *next_arm;
+	int i;
+
+	for (; node; node = next_node)
+	{
+		next_node = node->next;
+		node_free(node->left);
+		node_free(node->right);
+		node_free(node->alt);
+		for (arm = node->arms; arm; arm = next_arm)
+		{
+			next_arm = arm->next;
+			for (i = 0; arm->patterns[i]; i++)
+				pattern_free(arm->compiled[i]);
+			free(arm->compiled);
+			free(arm->patterns);
+			node_free(arm->body);
+			free(arm);
+		}
+		free(node->cmd);
+		free(node->redirs);
+		free(node);
+	}
+}
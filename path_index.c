@@ -0,0 +1,460 @@
+#include "hsh.h"
+
+#define DENTS_BUF (32 * 1024)
+#define INOTIFY_MASK (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | \
+	IN_DELETE_SELF | IN_MOVE_SELF)
+
+/**
+ * struct path_entry_s - One command name found in PATH
+ * @name: The command name
+ * @dir: Index of the first PATH directory holding it
+ */
+typedef struct path_entry_s
+{
+	char	*name;
+	int		dir;
+} path_entry_t;
+
+/**
+ * struct path_index_s - Sorted index of the executables in PATH
+ * @enabled: Set when lookups should go through the index
+ * @built: Set once the index matches the current PATH
+ * @path: Copy of PATH, cut into the directory strings
+ * @source: Copy of PATH as it was when the index was built
+ * @dirs: PATH directories, in search order
+ * @wds: Inotify watch of each directory, -1 when not watched
+ * @ndirs: Number of PATH directories
+ * @relative: Index of the first relative directory, such as ".", which is
+ * neither read nor watched; ndirs when there is none
+ * @ifd: Inotify descriptor
+ * @ent: Entries sorted by name
+ * @count: Number of entries
+ * @cap: Allocated number of entries
+ */
+typedef struct path_index_s
+{
+	int				enabled;
+	int				built;
+	char			*path;
+	char			*source;
+	char			**dirs;
+	int				*wds;
+	int				ndirs;
+	int				relative;
+	int				ifd;
+	path_entry_t	*ent;
+	size_t			count;
+	size_t			cap;
+} path_index_t;
+
+static path_index_t pidx = {0, 0, NULL, NULL, NULL, NULL, 0, -1, -1, NULL, 0, 0};
+
+/**
+ * path_index_find - Binary search for the first entry not below a name
+ * @name: The name to look for
+ *
+ * Return: Index of the first entry whose name is >= name
+ */
+static size_t path_index_find(const char *name)
+{
+	size_t lo = 0, hi = pidx.count, mid;
+
+	while (lo < hi)
+	{
+		mid = (lo + hi) / 2;
+		if (strcmp(pidx.ent[mid].name, name) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return (lo);
+}
+
+/**
+ * path_index_grow - Make room for one more entry
+ *
+ * Return: 0 on success, -1 on failure
+ */
+static int path_index_grow(void)
+{
+	path_entry_t *tmp;
+	size_t cap;
+
+	if (pidx.count < pidx.cap)
+		return (0);
+	cap = pidx.cap ? pidx.cap * 2 : 1024;
+	tmp = malloc(sizeof(path_entry_t) * cap);
+	if (!tmp)
+		return (-1);
+	if (pidx.ent)
+		memcpy(tmp, pidx.ent, sizeof(path_entry_t) * pidx.count);
+	free(pidx.ent);
+	pidx.ent = tmp;
+	pidx.cap = cap;
+	return (0);
+}
+
+/**
+ * path_index_put - Record that a directory holds a command
+ * @name: The command name
+ * @dir: Index of the directory
+ *
+ * The entry keeps the directory that comes first in PATH.
+ *
+ * Return: 0 on success, -1 on failure
+ */
+static int path_index_put(const char *name, int dir)
+{
+	size_t i = path_index_find(name);
+	char *dup;
+
+	if (i < pidx.count && strcmp(pidx.ent[i].name, name) == 0)
+	{
+		if (dir < pidx.ent[i].dir)
+			pidx.ent[i].dir = dir;
+		return (0);
+	}
+	dup = _strdup((char *)name);
+	if (!dup || path_index_grow() == -1)
+	{
+		free(dup);
+		return (-1);
+	}
+	memmove(&pidx.ent[i + 1], &pidx.ent[i],
+		sizeof(path_entry_t) * (pidx.count - i));
+	pidx.ent[i].name = dup;
+	pidx.ent[i].dir = dir;
+	pidx.count++;
+	return (0);
+}
+
+/**
+ * path_index_drop - Forget that a directory holds a command
+ * @name: The command name
+ * @dir: Index of the directory it disappeared from
+ *
+ * When a later absolute PATH directory also holds the name, the entry moves
+ * there.
+ */
+static void path_index_drop(const char *name, int dir)
+{
+	size_t i = path_index_find(name);
+	char full[PATH_MAX];
+	int d;
+
+	if (i >= pidx.count || strcmp(pidx.ent[i].name, name) != 0 ||
+		pidx.ent[i].dir != dir)
+		return;
+
+	for (d = dir + 1; d < pidx.ndirs; d++)
+	{
+		if (pidx.dirs[d][0] == '/' &&
+			snprintf(full, sizeof(full), "%s/%s", pidx.dirs[d], name) <
+			(int)sizeof(full) && access(full, X_OK) == 0)
+		{
+			pidx.ent[i].dir = d;
+			return;
+		}
+	}
+	free(pidx.ent[i].name);
+	memmove(&pidx.ent[i], &pidx.ent[i + 1],
+		sizeof(path_entry_t) * (pidx.count - i - 1));
+	pidx.count--;
+}
+
+/**
+ * path_index_cmp - Order entries by name, then by PATH position
+ * @a: First entry
+ * @b: Second entry
+ *
+ * Return: Negative, zero or positive as for strcmp
+ */
+static int path_index_cmp(const void *a, const void *b)
+{
+	const path_entry_t *x = a, *y = b;
+	int cmp = strcmp(x->name, y->name);
+
+	return (cmp ? cmp : x->dir - y->dir);
+}
+
+/**
+ * path_index_scan - Add every entry of a directory to the index
+ * @dir: Index of the directory
+ * @buf: Scratch buffer of DENTS_BUF bytes
+ *
+ * The directory is read in bulk with getdents64; entries are not stat'ed,
+ * only the file type from the directory entry is used. Entries are appended
+ * unsorted, path_index_build sorts them once at the end.
+ */
+static void path_index_scan(int dir, char *buf)
+{
+	struct dirent64 *d;
+	ssize_t n, off;
+	int fd;
+
+	fd = open(pidx.dirs[dir], O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fd == -1)
+		return;
+	while ((n = getdents64(fd, buf, DENTS_BUF)) > 0)
+	{
+		for (off = 0; off < n; off += d->d_reclen)
+		{
+			d = (struct dirent64 *)(buf + off);
+			if (d->d_name[0] == '.' || d->d_type == DT_DIR ||
+				path_index_grow() == -1)
+				continue;
+			pidx.ent[pidx.count].name = _strdup(d->d_name);
+			if (!pidx.ent[pidx.count].name)
+				continue;
+			pidx.ent[pidx.count++].dir = dir;
+		}
+	}
+	close(fd);
+}
+
+/**
+ * path_index_build - Build the index from the current PATH
+ *
+ * Return: 0 on success, -1 on failure
+ */
+static int path_index_build(void)
+{
+	char *path_env = _getenv("PATH"), *token, *saveptr, *buf;
+	int n = 1, i;
+	size_t j, k;
+
+	path_index_invalidate();
+	pidx.path = _strdup(path_env ? path_env : "");
+	pidx.source = _strdup(path_env ? path_env : "");
+	if (!pidx.path || !pidx.source)
+	{
+		path_index_invalidate();
+		return (-1);
+	}
+	for (i = 0; pidx.path[i]; i++)
+		n += pidx.path[i] == ':';
+	pidx.dirs = malloc(sizeof(char *) * n);
+	pidx.wds = malloc(sizeof(int) * n);
+	buf = malloc(DENTS_BUF);
+	if (!pidx.dirs || !pidx.wds || !buf)
+	{
+		free(buf);
+		path_index_invalidate();
+		return (-1);
+	}
+
+	pidx.ifd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	token = _strtok_r(pidx.path, ":", &saveptr);
+	while (token)
+	{
+		i = pidx.ndirs++;
+		pidx.dirs[i] = token;
+		pidx.wds[i] = -1;
+		/* What a relative directory holds changes with the cwd */
+		if (*token == '/')
+		{
+			if (pidx.ifd != -1)
+				pidx.wds[i] = inotify_add_watch(pidx.ifd, token, INOTIFY_MASK);
+			path_index_scan(i, buf);
+		}
+		else if (pidx.relative == -1)
+			pidx.relative = i;
+		token = _strtok_r(NULL, ":", &saveptr);
+	}
+	free(buf);
+	if (pidx.relative == -1)
+		pidx.relative = pidx.ndirs;
+
+	/* Sort once, keeping only the first directory of each name */
+	qsort(pidx.ent, pidx.count, sizeof(path_entry_t), path_index_cmp);
+	for (j = 0, k = 0; j < pidx.count; j++)
+	{
+		if (k > 0 && strcmp(pidx.ent[k - 1].name, pidx.ent[j].name) == 0)
+			free(pidx.ent[j].name);
+		else
+			pidx.ent[k++] = pidx.ent[j];
+	}
+	pidx.count = k;
+	pidx.built = 1;
+	return (0);
+}
+
+/**
+ * path_index_sync - Apply pending inotify events to the index
+ *
+ * Only the shell builds the index and reads the inotify queue. A forked
+ * child uses the index the shell synced before the fork, as it is, and
+ * none at all if the shell had not built one for the current PATH: the
+ * child then walks PATH instead of reading every directory of it.
+ *
+ * Return: 0 if the index is usable, -1 otherwise
+ */
+static int path_index_sync(void)
+{
+	char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	struct inotify_event *ev;
+	char *path = _getenv("PATH");
+	ssize_t n, off;
+	int d, same;
+
+	same = pidx.built && _strcmp(pidx.source, path ? path : "") == 0;
+	if (getpid() != shell_pid())
+		return (same ? 0 : -1);
+	if (!same)
+		return (path_index_build());
+	if (pidx.ifd == -1)
+		return (0);
+
+	while ((n = read(pidx.ifd, buf, sizeof(buf))) > 0)
+	{
+		for (off = 0; off < n; off += sizeof(*ev) + ev->len)
+		{
+			ev = (struct inotify_event *)(buf + off);
+			if (ev->mask & (IN_Q_OVERFLOW | IN_DELETE_SELF | IN_MOVE_SELF))
+				return (path_index_build());
+			for (d = 0; d < pidx.ndirs && pidx.wds[d] != ev->wd; d++)
+				;
+			if (d == pidx.ndirs || !ev->len || ev->name[0] == '.' ||
+				(ev->mask & IN_ISDIR))
+				continue;
+			if (ev->mask & (IN_CREATE | IN_MOVED_TO))
+				path_index_put(ev->name, d);
+			else
+				path_index_drop(ev->name, d);
+		}
+	}
+	return (0);
+}
+
+/**
+ * path_index_enable - Serve command lookups from the index
+ *
+ * The index itself is built on first use. Short-lived shells leave it off,
+ * since a single lookup is cheaper than reading every PATH directory.
+ */
+void path_index_enable(void)
+{
+	pidx.enabled = 1;
+}
+
+/**
+ * path_index_refresh - Bring the index up to date before a fork
+ *
+ * The child about to run a command then finds it in the index without
+ * reading the inotify queue, which only the shell does.
+ */
+void path_index_refresh(void)
+{
+	if (pidx.enabled && getpid() == shell_pid())
+		path_index_sync();
+}
+
+/**
+ * path_index_invalidate - Drop the index, to be rebuilt on next use
+ *
+ * Called whenever PATH changes.
+ */
+void path_index_invalidate(void)
+{
+	size_t i;
+
+	for (i = 0; i < pidx.count; i++)
+		free(pidx.ent[i].name);
+	free(pidx.ent);
+	free(pidx.dirs);
+	free(pidx.wds);
+	free(pidx.path);
+	free(pidx.source);
+	if (pidx.ifd != -1)
+		close(pidx.ifd);
+	pidx.ent = NULL;
+	pidx.dirs = NULL;
+	pidx.wds = NULL;
+	pidx.path = NULL;
+	pidx.source = NULL;
+	pidx.ifd = -1;
+	pidx.ndirs = 0;
+	pidx.relative = -1;
+	pidx.count = 0;
+	pidx.cap = 0;
+	pidx.built = 0;
+}
+
+/**
+ * path_index_lookup - Resolve a command name through the index
+ * @name: The command name, without any '/'
+ * @found: Set to 1 when the index found the command, 0 otherwise
+ *
+ * A name the index does not know is not final: it may have been installed
+ * since the child's copy of the index was synced, so the caller walks PATH.
+ * So is one found after a relative PATH directory, which is never read.
+ *
+ * Example:
+ *   path = path_index_lookup("ls", &found);   - "/bin/ls"
+ *
+ * Return: Newly allocated full path, or NULL if the command is unknown
+ */
+char *path_index_lookup(const char *name, int *found)
+{
+	char *full;
+	size_t i;
+	struct stat st;
+
+	*found = 0;
+	if (!pidx.enabled || path_index_sync() == -1)
+		return (NULL);
+
+	/* Past a relative directory, the cwd may hold the command first */
+	i = path_index_find(name);
+	if (i >= pidx.count || strcmp(pidx.ent[i].name, name) != 0 ||
+		pidx.ent[i].dir > pidx.relative)
+		return (NULL);
+	*found = 1;
+
+	full = malloc(_strlen(pidx.dirs[pidx.ent[i].dir]) + _strlen(name) + 2);
+	if (!full)
+		return (NULL);
+	_strcpy(full, pidx.dirs[pidx.ent[i].dir]);
+	_strcat(full, "/");
+	_strcat(full, name);
+	stats_add(STAT_PATH_STATS, 1);
+	if (stat(full, &st) == 0 && (st.st_mode & S_IXUSR) && !S_ISDIR(st.st_mode))
+		return (full);
+
+	/* Not executable after all, let the caller walk PATH */
+	free(full);
+	*found = 0;
+	return (NULL);
+}
+
+/**
+ * path_index_prefix - Find the commands starting with a prefix
+ * @prefix: The prefix
+ * @first: Set to the index of the first match
+ *
+ * Return: Number of matches; names are read with path_index_name
+ */
+size_t path_index_prefix(const char *prefix, size_t *first)
+{
+	size_t i, len = _strlen(prefix);
+
+	*first = 0;
+	if (path_index_sync() == -1)
+		return (0);
+	*first = path_index_find(prefix);
+	for (i = *first; i < pidx.count; i++)
+		if (strncmp(pidx.ent[i].name, prefix, len) != 0)
+			break;
+	return (i - *first);
+}
+
+/**
+ * path_index_name - Get the name of an index entry
+ * @i: Index of the entry
+ *
+ * Return: The command name
+ */
+const char *path_index_name(size_t i)
+{
+	return (i < pidx.count ? pidx.ent[i].name : NULL);
+}
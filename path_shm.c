@@ -0,0 +1,529 @@
+#include "hsh.h"
+
+#define PSHM_MAGIC 0x68736870u
+#define PSHM_VERSION 1u
+#define PSHM_PATHS 16
+#define PSHM_DIRS 32
+#define PSHM_PATH_LEN 1024
+#define PSHM_SLOTS 8192
+#define PSHM_NAME 56
+#define PSHM_PROBE 8
+#define PSHM_TRUST_NS 1000000000LL
+
+/**
+ * struct pshm_path_s - A PATH the shared index has entries for
+ * @seq: Sequence number, odd while a writer changes the record
+ * @gen: Generation of the entries; entries of another generation are dead
+ * @hash: Hash of the PATH string
+ * @ndirs: Number of directories in the PATH
+ * @checked: CLOCK_MONOTONIC time the mtimes were last found unchanged, ns
+ * @mtime: Modification time of each directory, ns, -1 when it is missing
+ * @path: The PATH string
+ */
+typedef struct pshm_path_s
+{
+	uint32_t	seq;
+	uint32_t	gen;
+	uint32_t	hash;
+	uint32_t	ndirs;
+	int64_t		checked;
+	int64_t		mtime[PSHM_DIRS];
+	char		path[PSHM_PATH_LEN];
+} pshm_path_t;
+
+/**
+ * struct pshm_slot_s - A command found in a PATH
+ * @seq: Sequence number, odd while a writer changes the slot
+ * @gen: Generation of the PATH record when the command was found
+ * @rec: Index of the PATH record
+ * @dir: Index of the directory holding the command in that PATH
+ * @name: The command name
+ */
+typedef struct pshm_slot_s
+{
+	uint32_t	seq;
+	uint32_t	gen;
+	uint16_t	rec;
+	uint16_t	dir;
+	char		name[PSHM_NAME];
+} pshm_slot_t;
+
+/**
+ * struct pshm_s - Layout of the shared file
+ * @magic: PSHM_MAGIC once the file is set up
+ * @version: PSHM_VERSION of the shell that set it up
+ * @gens: Last generation handed out
+ * @next: Next PATH record to reuse
+ * @paths: The PATH records
+ * @slots: Open addressing table of commands
+ */
+typedef struct pshm_s
+{
+	uint32_t	magic;
+	uint32_t	version;
+	uint32_t	gens;
+	uint32_t	next;
+	pshm_path_t	paths[PSHM_PATHS];
+	pshm_slot_t	slots[PSHM_SLOTS];
+} pshm_t;
+
+/**
+ * struct pshm_state_s - This process's view of the shared index
+ * @state: 0 before the first use, 1 when in use, -1 when off
+ * @fd: The file, locked by writers
+ * @pid: Process that opened fd; a child opens its own to lock it
+ * @map: The file, mapped
+ * @file: Path of the file
+ */
+typedef struct pshm_state_s
+{
+	int		state;
+	int		fd;
+	pid_t	pid;
+	pshm_t	*map;
+	char	file[PATH_MAX];
+} pshm_state_t;
+
+static pshm_state_t shm = {0, -1, 0, NULL, ""};
+
+/**
+ * pshm_now - Read the monotonic clock, the same for every process
+ *
+ * Return: The time in ns
+ */
+static int64_t pshm_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec);
+}
+
+/**
+ * pshm_lock - Become the one writer of the index
+ *
+ * flock belongs to an open file, which a forked child shares with its
+ * parent; a child opens the file again so the lock keeps them apart.
+ *
+ * Return: 0 on success, -1 on failure
+ */
+static int pshm_lock(void)
+{
+	if (shm.pid != getpid())
+	{
+		close(shm.fd);
+		shm.fd = redirect_reserve(open(shm.file, O_RDWR | O_NOFOLLOW | O_CLOEXEC));
+		shm.pid = getpid();
+	}
+	return (shm.fd == -1 ? -1 : flock(shm.fd, LOCK_EX));
+}
+
+/**
+ * pshm_begin - Start changing a record or slot
+ * @seq: Its sequence number, even
+ *
+ * Readers seeing the odd number, or a number that changed while they
+ * copied, ignore what they copied.
+ */
+static void pshm_begin(uint32_t *seq)
+{
+	__atomic_store_n(seq, *seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+/**
+ * pshm_end - Finish changing a record or slot
+ * @seq: Its sequence number, odd
+ */
+static void pshm_end(uint32_t *seq)
+{
+	__atomic_store_n(seq, *seq + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * pshm_setup - Map the file, setting it up if it is new
+ *
+ * Return: 0 on success, -1 if the file cannot be used
+ */
+static int pshm_setup(void)
+{
+	struct stat st;
+	void *p;
+
+	if (fstat(shm.fd, &st) == -1 || st.st_uid != geteuid() ||
+		(st.st_mode & 022))
+		return (-1);
+	if (st.st_size != (off_t)sizeof(pshm_t))
+	{
+		/* A file of another size has another layout: leave it alone */
+		if (st.st_size != 0 || flock(shm.fd, LOCK_EX) == -1)
+			return (-1);
+		if (fstat(shm.fd, &st) == -1 || (st.st_size == 0 &&
+			ftruncate(shm.fd, sizeof(pshm_t)) == -1))
+		{
+			flock(shm.fd, LOCK_UN);
+			return (-1);
+		}
+		flock(shm.fd, LOCK_UN);
+	}
+	p = mmap(NULL, sizeof(pshm_t), PROT_READ | PROT_WRITE, MAP_SHARED,
+		shm.fd, 0);
+	if (p == MAP_FAILED)
+		return (-1);
+	shm.map = p;
+	if (__atomic_load_n(&shm.map->magic, __ATOMIC_ACQUIRE) == PSHM_MAGIC)
+		return (shm.map->version == PSHM_VERSION ? 0 : -1);
+	if (flock(shm.fd, LOCK_EX) == -1)
+		return (-1);
+	if (shm.map->magic != PSHM_MAGIC)
+	{
+		shm.map->version = PSHM_VERSION;
+		__atomic_store_n(&shm.map->magic, PSHM_MAGIC, __ATOMIC_RELEASE);
+	}
+	flock(shm.fd, LOCK_UN);
+	return (shm.map->version == PSHM_VERSION ? 0 : -1);
+}
+
+/**
+ * pshm_ready - Open the shared index on first use
+ *
+ * The index is used when HSH_PATH_SHM is set: to the path of the file,
+ * or to anything else for /dev/shm/hsh-path.<uid>.<version>. The file
+ * must belong to the user and be writable by no one else.
+ *
+ * Return: 1 if the index can be used, 0 otherwise
+ */
+static int pshm_ready(void)
+{
+	char *env;
+
+	if (shm.state)
+		return (shm.state == 1);
+	shm.state = -1;
+	env = _getenv("HSH_PATH_SHM");
+	if (!env || !*env)
+		return (0);
+	if (*env == '/')
+		snprintf(shm.file, sizeof(shm.file), "%s", env);
+	else
+		snprintf(shm.file, sizeof(shm.file), "/dev/shm/hsh-path.%u.%u",
+			(unsigned int)geteuid(), PSHM_VERSION);
+	shm.fd = redirect_reserve(open(shm.file,
+		O_RDWR | O_CREAT | O_NOFOLLOW | O_CLOEXEC, 0600));
+	shm.pid = getpid();
+	if (shm.fd == -1)
+		return (0);
+	if (pshm_setup() == -1)
+	{
+		if (shm.map)
+			munmap(shm.map, sizeof(pshm_t));
+		shm.map = NULL;
+		close(shm.fd);
+		shm.fd = -1;
+		return (0);
+	}
+	shm.state = 1;
+	return (1);
+}
+
+/**
+ * pshm_dir - Find a directory of a PATH
+ * @path: The PATH string
+ * @n: Index of the directory, counted as find_command_path walks PATH
+ * @len: Set to the length of the directory
+ *
+ * Return: Start of the directory in path, or NULL past the last one
+ */
+static const char *pshm_dir(const char *path, int n, size_t *len)
+{
+	while (1)
+	{
+		while (*path == ':')
+			path++;
+		if (!*path)
+			return (NULL);
+		for (*len = 0; path[*len] && path[*len] != ':'; (*len)++)
+			;
+		if (n-- == 0)
+			return (path);
+		path += *len;
+	}
+}
+
+/**
+ * pshm_absolute - Tell whether a PATH is searched the same from anywhere
+ * @path: The PATH string
+ * @n: Index of the last directory that matters
+ *
+ * A relative directory such as "." is searched from the current
+ * directory, so what it holds, or hides, cannot be shared.
+ *
+ * Return: 1 if directories 0 to n all start with '/', 0 otherwise
+ */
+static int pshm_absolute(const char *path, int n)
+{
+	const char *dir;
+	size_t len;
+
+	for (; n >= 0; n--)
+	{
+		dir = pshm_dir(path, 0, &len);
+		if (!dir || *dir != '/')
+			return (0);
+		path = dir + len;
+	}
+	return (1);
+}
+
+/**
+ * pshm_mtimes - Read the modification time of every PATH directory
+ * @path: The PATH string
+ * @mtime: Where to store them, in ns, -1 for a missing directory
+ *
+ * Return: Number of directories, or -1 if there are too many
+ */
+static int pshm_mtimes(const char *path, int64_t *mtime)
+{
+	char dir[PATH_MAX];
+	const char *d;
+	struct stat st;
+	size_t len;
+	int n;
+
+	for (n = 0; (d = pshm_dir(path, n, &len)) != NULL; n++)
+	{
+		if (n == PSHM_DIRS || len >= sizeof(dir))
+			return (-1);
+		memcpy(dir, d, len);
+		dir[len] = '\0';
+		stats_add(STAT_PATH_STATS, 1);
+		mtime[n] = stat(dir, &st) == -1 ? -1 :
+			(int64_t)st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+	}
+	return (n);
+}
+
+/**
+ * pshm_find - Find the record of a PATH
+ * @path: The PATH string
+ * @hash: Its hash
+ * @copy: Where to copy the record
+ *
+ * The record is copied without a lock and dropped if a writer changed it
+ * meanwhile.
+ *
+ * Return: Index of the record, or -1 if there is none
+ */
+static int pshm_find(const char *path, uint32_t hash, pshm_path_t *copy)
+{
+	pshm_path_t *r;
+	uint32_t seq;
+	int i;
+
+	for (i = 0; i < PSHM_PATHS; i++)
+	{
+		r = &shm.map->paths[i];
+		seq = __atomic_load_n(&r->seq, __ATOMIC_ACQUIRE);
+		if ((seq & 1) || __atomic_load_n(&r->hash, __ATOMIC_RELAXED) != hash)
+			continue;
+		memcpy(copy, r, sizeof(*copy));
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if (__atomic_load_n(&r->seq, __ATOMIC_RELAXED) != seq)
+			continue;
+		copy->path[PSHM_PATH_LEN - 1] = '\0';
+		if (_strcmp(copy->path, path) == 0)
+			return (i);
+	}
+	return (-1);
+}
+
+/**
+ * pshm_renew - Give a PATH record new mtimes and a new generation
+ * @rec: Index of the record
+ * @path: The PATH string
+ * @hash: Its hash
+ *
+ * The entries of the old generation die with it. Called with the lock.
+ *
+ * Return: The new generation, or 0 if the PATH cannot be recorded
+ */
+static uint32_t pshm_renew(int rec, const char *path, uint32_t hash)
+{
+	pshm_path_t *r = &shm.map->paths[rec];
+	int64_t mtime[PSHM_DIRS];
+	int n;
+
+	n = pshm_mtimes(path, mtime);
+	if (n == -1 || _strlen(path) >= PSHM_PATH_LEN)
+		return (0);
+	pshm_begin(&r->seq);
+	r->hash = hash;
+	if (++shm.map->gens == 0)
+		shm.map->gens = 1;
+	r->gen = shm.map->gens;
+	r->ndirs = n;
+	memcpy(r->mtime, mtime, sizeof(int64_t) * n);
+	_strcpy(r->path, path);
+	__atomic_store_n(&r->checked, pshm_now(), __ATOMIC_RELAXED);
+	pshm_end(&r->seq);
+	return (r->gen);
+}
+
+/**
+ * pshm_valid - Tell whether the entries of a PATH record can be trusted
+ * @rec: Index of the record
+ * @copy: Copy of the record
+ * @path: The PATH string
+ *
+ * The directories are stat'ed at most once a second for all the shells
+ * on the host; a shell that finds one changed drops the record's entries.
+ *
+ * Return: 1 if they can, 0 otherwise
+ */
+static int pshm_valid(int rec, pshm_path_t *copy, const char *path)
+{
+	pshm_path_t *r = &shm.map->paths[rec];
+	int64_t now = pshm_now(), mtime[PSHM_DIRS];
+	int n;
+
+	if (now - __atomic_load_n(&r->checked, __ATOMIC_RELAXED) < PSHM_TRUST_NS)
+		return (1);
+	n = pshm_mtimes(path, mtime);
+	if (n == (int)copy->ndirs &&
+		memcmp(mtime, copy->mtime, sizeof(int64_t) * n) == 0)
+	{
+		__atomic_store_n(&r->checked, now, __ATOMIC_RELAXED);
+		return (1);
+	}
+	if (pshm_lock() == -1)
+		return (0);
+	if (r->gen == copy->gen)
+		pshm_renew(rec, path, copy->hash);
+	flock(shm.fd, LOCK_UN);
+	return (0);
+}
+
+/**
+ * pshm_home - First slot to probe for a command
+ * @name: The command name
+ * @rec: Index of the PATH record
+ * @gen: Generation of the record
+ *
+ * Return: Index of the slot
+ */
+static size_t pshm_home(const char *name, int rec, uint32_t gen)
+{
+	return ((intern_hash(name, _strlen(name)) ^ (gen * 2654435761u) ^ rec) &
+		(PSHM_SLOTS - 1));
+}
+
+/**
+ * path_shm_lookup - Resolve a command through the index shared by shells
+ * @name: The command name, without any '/'
+ *
+ * Readers take no lock: each slot is copied and dropped if a writer
+ * changed it meanwhile. A hit costs no stat call at all.
+ *
+ * Example:
+ *   HSH_PATH_SHM=1 hsh -c ls   - After the first run, ls is found in memory
+ *
+ * Return: Newly allocated full path, or NULL when the index does not know
+ * the command
+ */
+char *path_shm_lookup(const char *name)
+{
+	char *path = _getenv("PATH"), copy_name[PSHM_NAME], *full;
+	pshm_path_t copy;
+	pshm_slot_t *s;
+	uint32_t seq, gen;
+	size_t i, p, len;
+	const char *dir;
+	int rec, srec, sdir;
+
+	if (!path || _strlen(name) >= PSHM_NAME || !pshm_ready())
+		return (NULL);
+	rec = pshm_find(path, intern_hash(path, _strlen(path)), &copy);
+	if (rec == -1 || !pshm_valid(rec, &copy, path))
+		return (NULL);
+	i = pshm_home(name, rec, copy.gen);
+	for (p = 0; p < PSHM_PROBE; p++)
+	{
+		s = &shm.map->slots[(i + p) & (PSHM_SLOTS - 1)];
+		seq = __atomic_load_n(&s->seq, __ATOMIC_ACQUIRE);
+		gen = s->gen;
+		srec = s->rec;
+		sdir = s->dir;
+		memcpy(copy_name, s->name, PSHM_NAME);
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if ((seq & 1) || __atomic_load_n(&s->seq, __ATOMIC_RELAXED) != seq ||
+			gen != copy.gen || srec != rec ||
+			_strncmp(copy_name, name, PSHM_NAME) != 0 ||
+			!pshm_absolute(path, sdir))
+			continue;
+		dir = pshm_dir(path, sdir, &len);
+		full = dir ? malloc(len + _strlen(name) + 2) : NULL;
+		if (!full)
+			return (NULL);
+		memcpy(full, dir, len);
+		full[len] = '/';
+		_strcpy(full + len + 1, name);
+		stats_add(STAT_PATH_SHM_HITS, 1);
+		return (full);
+	}
+	return (NULL);
+}
+
+/**
+ * path_shm_store - Record a command found by walking PATH
+ * @name: The command name
+ * @dir: Index of the PATH directory holding it
+ *
+ * Nothing is recorded when a relative directory such as "." comes first,
+ * as the command found depends on the current directory then. Writers
+ * hold an flock on the file, so there is one at a time. A slot is
+ * free when it was never used or when its record was renewed or reused
+ * since; with every probed slot taken, the first one is replaced.
+ */
+void path_shm_store(const char *name, int dir)
+{
+	char *path = _getenv("PATH");
+	pshm_path_t copy;
+	pshm_slot_t *s, *home;
+	uint32_t hash, gen;
+	size_t i, p;
+	int rec;
+
+	if (!path || _strlen(name) >= PSHM_NAME || dir >= PSHM_DIRS ||
+		!pshm_absolute(path, dir) || !pshm_ready() || pshm_lock() == -1)
+		return;
+	hash = intern_hash(path, _strlen(path));
+	rec = pshm_find(path, hash, &copy);
+	if (rec == -1)
+	{
+		rec = shm.map->next++ % PSHM_PATHS;
+		gen = pshm_renew(rec, path, hash);
+	}
+	else
+		gen = copy.gen;
+	if (gen)
+	{
+		i = pshm_home(name, rec, gen);
+		home = &shm.map->slots[i];
+		for (p = 0; p < PSHM_PROBE; p++)
+		{
+			s = &shm.map->slots[(i + p) & (PSHM_SLOTS - 1)];
+			if (!s->gen || s->rec >= PSHM_PATHS ||
+				s->gen != shm.map->paths[s->rec].gen ||
+				(s->gen == gen && _strncmp(s->name, name, PSHM_NAME) == 0))
+				break;
+		}
+		s = p < PSHM_PROBE ? s : home;
+		pshm_begin(&s->seq);
+		s->gen = gen;
+		s->rec = rec;
+		s->dir = dir;
+		memcpy(s->name, name, _strlen(name) + 1);
+		pshm_end(&s->seq);
+	}
+	flock(shm.fd, LOCK_UN);
+}
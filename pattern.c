@@ -0,0 +1,500 @@
+#include "hsh.h"
+
+#define PATTERN_LITERAL 0
+#define PATTERN_ANY 1
+#define PATTERN_PREFIX 2
+#define PATTERN_SUFFIX 3
+#define PATTERN_SUBSTRING 4
+#define PATTERN_DFA 5
+
+#define DFA_MAX_STATES 64
+
+/**
+ * struct atom_s - One element of a compiled pattern
+ * @set: Bytes the element matches, one bit each
+ * @star: Set for a '*', which matches any run of bytes
+ */
+typedef struct atom_s
+{
+	unsigned char	set[32];
+	int				star;
+} atom_t;
+
+/**
+ * struct dfa_state_s - State of the matching automaton
+ * @set: Pattern positions the state stands for, one bit each
+ * @next: State reached on each byte, -1 when not computed yet
+ * @accept: Set when the end of the pattern is among the positions
+ * @dead: Set when no position is left, so nothing can match any more
+ */
+typedef struct dfa_state_s
+{
+	uint64_t	*set;
+	short		next[256];
+	int			accept;
+	int			dead;
+} dfa_state_t;
+
+/**
+ * struct pattern_s - Compiled shell pattern
+ * @source: The pattern as compiled, with its escapes
+ * @kind: PATTERN_LITERAL, _ANY, _PREFIX, _SUFFIX, _SUBSTRING or _DFA
+ * @lit: Literal text of the fast paths
+ * @lit_len: Length of lit
+ * @atoms: Elements of the pattern, for the automaton
+ * @natoms: Number of elements
+ * @words: Number of 64-bit words in a set of positions
+ * @states: States built so far, the cache of the automaton
+ * @nstates: Number of states built
+ * @cap: Allocated number of states
+ * @flushes: Number of times the cache was emptied
+ * @tmp: Scratch set of positions
+ */
+struct pattern_s
+{
+	char		*source;
+	int			kind;
+	char		*lit;
+	size_t		lit_len;
+	atom_t		*atoms;
+	int			natoms;
+	int			words;
+	dfa_state_t	*states;
+	int			nstates;
+	int			cap;
+	unsigned	flushes;
+	uint64_t	*tmp;
+};
+
+/**
+ * parse_named - Parse a character class name such as [:alpha:]
+ * @p: Pattern, on the "[:"
+ * @set: Bytes of the bracket expression, the class is added
+ *
+ * Return: Pointer after the ":]", or NULL when the name is unknown
+ */
+static const char *parse_named(const char *p, unsigned char *set)
+{
+	static const struct
+	{
+		const char *name;
+		int (*is)(int);
+	} classes[] = {
+		{"alnum", isalnum}, {"alpha", isalpha}, {"blank", isblank},
+		{"cntrl", iscntrl}, {"digit", isdigit}, {"graph", isgraph},
+		{"lower", islower}, {"print", isprint}, {"punct", ispunct},
+		{"space", isspace}, {"upper", isupper}, {"xdigit", isxdigit},
+		{NULL, NULL}
+	};
+	const char *end = strstr(p + 2, ":]");
+	int i, c;
+
+	if (!end)
+		return (NULL);
+	for (i = 0; classes[i].name; i++)
+		if ((size_t)(end - p - 2) == (size_t)_strlen(classes[i].name) &&
+			_strncmp(classes[i].name, p + 2, end - p - 2) == 0)
+			break;
+	if (!classes[i].name)
+		return (NULL);
+	for (c = 1; c < 256; c++)
+		if (classes[i].is(c))
+			set[c / 8] |= 1 << (c % 8);
+	return (end + 2);
+}
+
+/**
+ * parse_class - Parse a bracket expression
+ * @p: Pattern, just after the '['
+ * @set: Bytes of the class, filled in
+ *
+ * Ranges, single bytes and the POSIX classes such as [:digit:] mix freely,
+ * as in "[[:alpha:]_-]".
+ *
+ * Return: Pointer after the closing ']', or NULL when the '[' does not
+ * start a bracket expression
+ */
+static const char *parse_class(const char *p, unsigned char *set)
+{
+	int negate = 0, c;
+	unsigned char lo, hi;
+
+	memset(set, 0, 32);
+	if (*p == '!' || *p == '^')
+	{
+		negate = 1;
+		p++;
+	}
+	/* A ']' right after the '[' is part of the class */
+	if (*p == ']')
+	{
+		set[']' / 8] |= 1 << (']' % 8);
+		p++;
+	}
+	while (*p && *p != ']')
+	{
+		if (p[0] == '[' && p[1] == ':')
+		{
+			p = parse_named(p, set);
+			if (!p)
+				return (NULL);
+			continue;
+		}
+		lo = *p == '\\' && p[1] ? *++p : *p;
+		p++;
+		hi = lo;
+		if (*p == '-' && p[1] && p[1] != ']')
+		{
+			hi = p[1] == '\\' && p[2] ? p[2] : p[1];
+			p += p[1] == '\\' && p[2] ? 3 : 2;
+		}
+		for (c = lo; c <= hi; c++)
+			set[c / 8] |= 1 << (c % 8);
+	}
+	if (!*p)
+		return (NULL);
+	if (negate)
+		for (c = 0; c < 32; c++)
+			set[c] = ~set[c];
+	return (p + 1);
+}
+
+/**
+ * atom_char - Get the only byte an element matches
+ * @atom: The element
+ *
+ * Return: The byte, or -1 when the element matches several bytes or none
+ */
+static int atom_char(const atom_t *atom)
+{
+	int c, found = -1;
+
+	if (atom->star)
+		return (-1);
+	for (c = 1; c < 256; c++)
+		if (atom->set[c / 8] & (1 << (c % 8)))
+		{
+			if (found != -1)
+				return (-1);
+			found = c;
+		}
+	return (found);
+}
+
+/**
+ * pattern_parse - Turn a pattern into elements
+ * @p: The compiled pattern, source set
+ *
+ * Return: 0 on success, -1 on failure
+ */
+static int pattern_parse(pattern_t *p)
+{
+	const char *s = p->source, *end;
+	atom_t *atom;
+
+	p->atoms = malloc(sizeof(atom_t) * (_strlen(s) + 1));
+	if (!p->atoms)
+		return (-1);
+	for (p->natoms = 0; *s; p->natoms++)
+	{
+		atom = &p->atoms[p->natoms];
+		memset(atom, 0, sizeof(atom_t));
+		if (*s == '*')
+		{
+			while (*s == '*')
+				s++;
+			atom->star = 1;
+			continue;
+		}
+		if (*s == '?')
+			memset(atom->set, 0xFF, sizeof(atom->set));
+		else if (*s == '[' && (end = parse_class(s + 1, atom->set)) != NULL)
+		{
+			s = end;
+			continue;
+		}
+		else
+		{
+			if (*s == '\\' && s[1])
+				s++;
+			atom->set[(unsigned char)*s / 8] |= 1 << ((unsigned char)*s % 8);
+		}
+		s++;
+	}
+	return (0);
+}
+
+/**
+ * pattern_fast_path - Recognize patterns a plain comparison can match
+ * @p: The compiled pattern, parsed
+ *
+ * "text", "*", "text*", "*text" and "*text*" need no automaton.
+ *
+ * Return: 0 on success, -1 on failure
+ */
+static int pattern_fast_path(pattern_t *p)
+{
+	int first = 0, last = p->natoms, i, c;
+
+	if (p->natoms == 1 && p->atoms[0].star)
+	{
+		p->kind = PATTERN_ANY;
+		return (0);
+	}
+	if (first < last && p->atoms[first].star)
+		first++;
+	if (last > first && p->atoms[last - 1].star)
+		last--;
+	for (i = first; i < last; i++)
+		if (atom_char(&p->atoms[i]) == -1)
+			return (0);
+	p->lit = malloc(last - first + 1);
+	if (!p->lit)
+		return (-1);
+	for (i = first; i < last; i++)
+	{
+		c = atom_char(&p->atoms[i]);
+		p->lit[i - first] = (char)c;
+	}
+	p->lit[last - first] = '\0';
+	p->lit_len = last - first;
+	if (first == 0 && last == p->natoms)
+		p->kind = PATTERN_LITERAL;
+	else if (first == 0)
+		p->kind = PATTERN_PREFIX;
+	else if (last == p->natoms)
+		p->kind = PATTERN_SUFFIX;
+	else
+		p->kind = PATTERN_SUBSTRING;
+	return (0);
+}
+
+/**
+ * pattern_compile - Compile a shell pattern
+ * @pattern: The pattern, with '*', '?', '[...]' and '\' quoting
+ *
+ * Patterns made of literal text around at most a leading and a trailing
+ * '*' are matched with plain comparisons. Others are matched by an
+ * automaton built lazily, one state per set of pattern positions reached,
+ * so matching is a single pass over the subject whatever the pattern,
+ * with no backtracking.
+ *
+ * Example:
+ *   p = pattern_compile("*.log");        - Suffix compare
+ *   p = pattern_compile("*a*a*a*b");     - Automaton
+ *
+ * Return: The compiled pattern, or NULL on failure
+ */
+pattern_t *pattern_compile(const char *pattern)
+{
+	pattern_t *p = malloc(sizeof(pattern_t));
+
+	if (!p)
+		return (NULL);
+	memset(p, 0, sizeof(pattern_t));
+	p->kind = PATTERN_DFA;
+	p->source = _strdup((char *)pattern);
+	if (!p->source || pattern_parse(p) == -1 || pattern_fast_path(p) == -1)
+	{
+		pattern_free(p);
+		return (NULL);
+	}
+	p->words = (p->natoms + 1 + 63) / 64;
+	return (p);
+}
+
+/**
+ * pattern_source - Get the text a pattern was compiled from
+ * @p: The compiled pattern
+ *
+ * Return: The text
+ */
+const char *pattern_source(const pattern_t *p)
+{
+	return (p->source);
+}
+
+/**
+ * pattern_free - Free a compiled pattern
+ * @p: The compiled pattern, may be NULL
+ */
+void pattern_free(pattern_t *p)
+{
+	int i;
+
+	if (!p)
+		return;
+	for (i = 0; i < p->nstates; i++)
+		free(p->states[i].set);
+	free(p->states);
+	free(p->tmp);
+	free(p->atoms);
+	free(p->lit);
+	free(p->source);
+	free(p);
+}
+
+/**
+ * dfa_closure - Add the positions reachable by skipping '*' elements
+ * @p: The compiled pattern
+ * @set: The set of positions, updated
+ */
+static void dfa_closure(pattern_t *p, uint64_t *set)
+{
+	int i;
+
+	/* A '*' matches the empty string, so its next position is reached */
+	for (i = 0; i < p->natoms; i++)
+		if (p->atoms[i].star && (set[i / 64] >> (i % 64) & 1))
+			set[(i + 1) / 64] |= (uint64_t)1 << ((i + 1) % 64);
+}
+
+/**
+ * dfa_state - Find or add the state standing for a set of positions
+ * @p: The compiled pattern
+ * @set: The set of positions
+ *
+ * When the cache is full it is emptied, and states are built again as
+ * the subject needs them.
+ *
+ * Return: Index of the state, or -1 on failure
+ */
+static int dfa_state(pattern_t *p, const uint64_t *set)
+{
+	size_t bytes = sizeof(uint64_t) * p->words;
+	dfa_state_t *st, *tmp;
+	int i, empty = 1;
+
+	for (i = 0; i < p->nstates; i++)
+		if (memcmp(p->states[i].set, set, bytes) == 0)
+			return (i);
+	if (p->nstates == DFA_MAX_STATES)
+	{
+		for (i = 0; i < p->nstates; i++)
+			free(p->states[i].set);
+		p->nstates = 0;
+		p->flushes++;
+	}
+	if (p->nstates == p->cap)
+	{
+		tmp = malloc(sizeof(dfa_state_t) * (p->cap ? p->cap * 2 : 8));
+		if (!tmp)
+			return (-1);
+		if (p->states)
+			memcpy(tmp, p->states, sizeof(dfa_state_t) * p->nstates);
+		free(p->states);
+		p->states = tmp;
+		p->cap = p->cap ? p->cap * 2 : 8;
+	}
+	st = &p->states[p->nstates];
+	st->set = malloc(bytes);
+	if (!st->set)
+		return (-1);
+	memcpy(st->set, set, bytes);
+	memset(st->next, 0xFF, sizeof(st->next));
+	st->accept = (set[p->natoms / 64] >> (p->natoms % 64)) & 1;
+	for (i = 0; i < p->words; i++)
+		empty = empty && !set[i];
+	st->dead = empty;
+	return (p->nstates++);
+}
+
+/**
+ * dfa_step - Compute the state reached from a state on a byte
+ * @p: The compiled pattern
+ * @from: Index of the state
+ * @c: The byte
+ *
+ * Return: Index of the state reached, or -1 on failure
+ */
+static int dfa_step(pattern_t *p, int from, unsigned char c)
+{
+	uint64_t *set = p->states[from].set;
+	unsigned flushes = p->flushes;
+	atom_t *atom;
+	int i, to;
+
+	memset(p->tmp, 0, sizeof(uint64_t) * p->words);
+	for (i = 0; i < p->natoms; i++)
+	{
+		if (!(set[i / 64] >> (i % 64) & 1))
+			continue;
+		atom = &p->atoms[i];
+		if (atom->star)
+			p->tmp[i / 64] |= (uint64_t)1 << (i % 64);
+		else if (atom->set[c / 8] & (1 << (c % 8)))
+			p->tmp[(i + 1) / 64] |= (uint64_t)1 << ((i + 1) % 64);
+	}
+	dfa_closure(p, p->tmp);
+	to = dfa_state(p, p->tmp);
+	/* The cache may have been emptied, taking the old state with it */
+	if (to != -1 && p->flushes == flushes)
+		p->states[from].next[c] = to;
+	return (to);
+}
+
+/**
+ * dfa_match - Run the automaton of a pattern over a string
+ * @p: The compiled pattern
+ * @s: The string
+ *
+ * Return: 1 if the whole string matches, 0 otherwise
+ */
+static int dfa_match(pattern_t *p, const char *s)
+{
+	int state, next;
+
+	if (!p->tmp)
+	{
+		p->tmp = malloc(sizeof(uint64_t) * p->words);
+		if (!p->tmp)
+			return (0);
+	}
+	memset(p->tmp, 0, sizeof(uint64_t) * p->words);
+	p->tmp[0] = 1;
+	dfa_closure(p, p->tmp);
+	state = dfa_state(p, p->tmp);
+	for (; state != -1 && *s; s++)
+	{
+		if (p->states[state].dead)
+			return (0);
+		next = p->states[state].next[(unsigned char)*s];
+		state = next != -1 ? next : dfa_step(p, state, (unsigned char)*s);
+	}
+	return (state != -1 && p->states[state].accept);
+}
+
+/**
+ * pattern_match - Match a string against a compiled pattern
+ * @p: The compiled pattern
+ * @s: The string
+ *
+ * Example:
+ *   pattern_match(pattern_compile("*.c"), "main.c")   - 1
+ *   pattern_match(pattern_compile("[a-c]?"), "bz")    - 1
+ *   pattern_match(pattern_compile("\\*"), "x")        - 0
+ *
+ * Return: 1 if the whole string matches, 0 otherwise
+ */
+int pattern_match(pattern_t *p, const char *s)
+{
+	size_t len;
+
+	switch (p->kind)
+	{
+	case PATTERN_ANY:
+		return (1);
+	case PATTERN_LITERAL:
+		return (_strcmp(p->lit, s) == 0);
+	case PATTERN_PREFIX:
+		return (_strncmp(p->lit, s, p->lit_len) == 0);
+	case PATTERN_SUFFIX:
+		len = _strlen(s);
+		return (len >= p->lit_len &&
+			memcmp(s + len - p->lit_len, p->lit, p->lit_len) == 0);
+	case PATTERN_SUBSTRING:
+		return (strstr(s, p->lit) != NULL);
+	default:
+		return (dfa_match(p, s));
+	}
+}
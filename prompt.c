@@ -25,6 +25,7 @@ prompt_t *init_prompt(void)
 	/* Initialize all fields to default values */
 	prmt->input = NULL;
 	prmt->size = 0;
+	prmt->capacity = 0;
 	prmt->line_count = 0;
 	return (prmt);
 }
@@ -53,67 +54,77 @@ void *free_prompt(void *prmt)
 		return (NULL);
 
 	p = (prompt_t *)prmt;
-	if (p->input)
-		free(p->input);
+	pool_free(p->input);
 	free(p);
+	line_edit_free();
+	hist_free();
+	path_index_invalidate();
 	return (NULL);
 }
 
 /**
  * get_prompt - Display a prompt and read user input
  * @prmt: Pointer to the prompt structure
+ * @prompt_str: The prompt, "($) " or "> " for a continuation line
  *
  * This function displays a prompt to the user, reads input from stdin,
- * and stores it in the prompt structure.
+ * and stores it in the prompt structure. On a terminal the line is read
+ * through the line editor and recorded in the history. The input buffer
+ * is kept from one call to the next and only grows.
  *
  * Example:
  *   // User enters "ls -l" at the prompt
- *   get_prompt(my_prompt);
+ *   get_prompt(my_prompt, "($) ");
  *   // my_prompt->input now contains "ls -l"
  *   // my_prompt->size contains 5
  *
  * Return: 0 on success, -1 on failure or EOF
  */
-int get_prompt(prompt_t *prmt)
+int get_prompt(prompt_t *prmt, const char *prompt_str)
 {
-	size_t bufsize;
 	ssize_t characters;
+	input_t *in;
+	char *line;
 
 	/* Validate input parameter */
 	if (!prmt)
 		return (-1);
 
-	bufsize = 0;
-	if (prmt->input)
+	/* Edit the line in place when talking to a terminal */
+	if (shell_line_editing())
 	{
-		free(prmt->input);
-		prmt->input = NULL;
+		characters = line_edit(prmt, prompt_str);
+		if (characters == -1)
+			return (-1);
+		prmt->size = characters;
+		prmt->line_count++;
+		hist_add(prmt->input);
+		return (0);
 	}
 
 	/* Display prompt if in interactive mode */
-	if (isatty(STDIN_FILENO))
-		write(STDOUT_FILENO, "($) ", 4);
+	if (shell_interactive())
+		write(STDOUT_FILENO, prompt_str, _strlen(prompt_str));
 
-	/* Get input line from user */
-	characters = getline(&(prmt->input), &bufsize, stdin);
-
-	/* Check for EOF or error */
-	if (characters == -1)
+	/* Get input line from user, reusing the buffer */
+	in = input_stdin();
+	if (!in || input_line(in, &line) == -1)
+		return (-1);
+	characters = _strlen(line);
+	if (prmt->capacity < (size_t)characters + 1)
 	{
-		/* Clean up on error */
-		if (prmt->input)
+		pool_free(prmt->input);
+		prmt->capacity = characters + 1;
+		prmt->input = pool_alloc(prmt->capacity);
+		if (!prmt->input)
 		{
-			free(prmt->input);
-			prmt->input = NULL;
+			prmt->capacity = 0;
+			return (-1);
 		}
-		return (-1);
 	}
+	_strcpy(prmt->input, line);
 
-	/* Remove trailing newline if present */
-	if (characters > 0 && prmt->input[characters - 1] == '\n')
-		prmt->input[characters - 1] = '\0';
-
-	prmt->size = _strlen(prmt->input);
+	prmt->size = characters;
 	prmt->line_count++;
 	return (0);
 }
@@ -0,0 +1,256 @@
+#include "hsh.h"
+
+/**
+ * source_line - Read the next line of a source
+ * @src: The source
+ * @line: Set to the line
+ * @more: 1 when the line continues a command, for the "> " prompt
+ *
+ * Return: Length of the line, or -1 at end of input
+ */
+static ssize_t source_line(source_t *src, char **line, int more)
+{
+	ssize_t len;
+
+	if (src->prompt)
+	{
+		/* What built-ins printed shows before the prompt */
+		out_flush_all();
+		if (get_prompt(src->prompt, more ? "> " : "($) ") == -1)
+			return (-1);
+		*line = src->prompt->input;
+		len = src->prompt->size;
+	}
+	else
+		len = input_line(src->in, line);
+	if (len != -1)
+		src->line_count++;
+	return (len);
+}
+
+/**
+ * heredoc_delimiter - Remove the quotes of a heredoc delimiter
+ * @word: The delimiter as written
+ *
+ * Return: Newly allocated delimiter, or NULL on failure
+ */
+static char *heredoc_delimiter(const char *word)
+{
+	char *delim = malloc(_strlen(word) + 1), *d = delim;
+
+	if (!delim)
+		return (NULL);
+	for (; *word; word++)
+	{
+		if (*word == '\\' && word[1])
+			*d++ = *++word;
+		else if (*word != '\'' && *word != '"')
+			*d++ = *word;
+	}
+	*d = '\0';
+	return (delim);
+}
+
+/**
+ * read_heredoc - Read the body of a heredoc from a source
+ * @src: The source
+ * @segment: Pointer to the delimiter segment, replaced by one holding the
+ * delimiter and the body
+ *
+ * Return: 0 on success, -1 on failure
+ */
+static int read_heredoc(source_t *src, char ***segment)
+{
+	char *delim, *line, *body = NULL, *tmp, **seg;
+	size_t len = 0, cap = 0;
+	ssize_t n;
+
+	delim = heredoc_delimiter((*segment)[0]);
+	if (!delim)
+		return (-1);
+	while ((n = source_line(src, &line, 1)) != -1 && _strcmp(line, delim) != 0)
+	{
+		if (len + n + 2 > cap)
+		{
+			cap = (len + n + 2) * 2;
+			tmp = malloc(cap);
+			if (!tmp)
+				break;
+			if (body)
+				memcpy(tmp, body, len);
+			free(body);
+			body = tmp;
+		}
+		memcpy(body + len, line, n);
+		body[len + n] = '\n';
+		len += n + 1;
+	}
+	free(delim);
+
+	seg = malloc(sizeof(char *) * 3);
+	if (!seg)
+	{
+		free(body);
+		return (-1);
+	}
+	if (!body)
+		body = _strdup("");
+	else
+		body[len] = '\0';
+	seg[0] = (*segment)[0];
+	seg[1] = body;
+	seg[2] = NULL;
+	free(*segment);
+	*segment = seg;
+	return (0);
+}
+
+/**
+ * read_quoted - Read lines until a quoted string is closed
+ * @src: The source
+ * @line: The line that left the quote open
+ *
+ * The newlines between the lines are part of the quoted string. Reaching
+ * the end of input first is a syntax error.
+ *
+ * Return: Newly allocated lines, or NULL on error
+ */
+static char *read_quoted(source_t *src, char *line)
+{
+	char *text = _strdup(line), *joined, *next;
+	size_t len;
+
+	while (text && quote_open(text))
+	{
+		if (source_line(src, &next, 1) == -1)
+		{
+			fprintf(stderr, "%s: %d: Syntax error: Unterminated quoted string\n",
+				shell_name(), src->line_count);
+			free(text);
+			shell_set_status(2);
+			/* A script cannot go on after a syntax error */
+			if (!src->prompt)
+				shell_exit(2);
+			return (NULL);
+		}
+		len = _strlen(text);
+		joined = malloc(len + _strlen(next) + 2);
+		if (joined)
+		{
+			_strcpy(joined, text);
+			joined[len] = '\n';
+			_strcpy(joined + len + 1, next);
+		}
+		free(text);
+		text = joined;
+	}
+	return (text);
+}
+
+/**
+ * read_tokens - Read and tokenize one line of a source
+ * @src: The source
+ * @more: 1 when the line continues a command
+ *
+ * A line that leaves a quote open goes on with the next lines. The bodies
+ * of the heredocs started on the line are read right after it.
+ *
+ * Return: The tokens, or NULL at end of input
+ */
+static char ***read_tokens(source_t *src, int more)
+{
+	char ***tokens, *line, *quoted;
+	int i;
+
+	while (source_line(src, &line, more) != -1)
+	{
+		quoted = NULL;
+		if (quote_open(line))
+		{
+			quoted = read_quoted(src, line);
+			if (!quoted)
+			{
+				if (shell_exiting())
+					return (NULL);
+				continue;
+			}
+			line = quoted;
+		}
+		tokens = tokenize_command(line);
+		free(quoted);
+		if (!tokens)
+		{
+			fprintf(stderr, "%s: %d: Failed to tokenize command\n",
+				shell_name(), src->line_count);
+			continue;
+		}
+		for (i = 0; tokens[i]; i++)
+			if (i > 0 && token_kind(tokens[i - 1][0]) == TOK_HEREDOC &&
+				!is_operator(tokens[i][0]) && !tokens[i][1])
+				read_heredoc(src, &tokens[i]);
+		return (tokens);
+	}
+	return (NULL);
+}
+
+/**
+ * run_source - Read and run every command of a source
+ * @src: The source
+ * @program_name: Name of the shell program
+ *
+ * Lines are read until they form complete commands, so a loop or an if
+ * spanning several lines is parsed once, as a whole, before it runs.
+ * Reading stops at end of input or when exit is requested.
+ *
+ * Example:
+ *   source_t src = {input_stdin(), NULL, 0, 1};
+ *   status = run_source(&src, argv[0]);
+ *
+ * Return: Status of the last command
+ */
+int run_source(source_t *src, char *program_name)
+{
+	char ***tokens, ***more;
+	node_t *root;
+	script_t *script;
+	const char *what;
+	int state, first_line, status = shell_status();
+
+	while (!shell_exiting() && (tokens = read_tokens(src, 0)) != NULL)
+	{
+		first_line = src->line_count;
+		while ((state = parse_tokens(tokens, &root, &what)) == PARSE_INCOMPLETE &&
+			(more = read_tokens(src, 1)) != NULL)
+		{
+			tokens = tokens_append(tokens, more);
+			if (!tokens)
+				break;
+		}
+
+		if (!tokens)
+			continue;
+		if (state != PARSE_OK)
+		{
+			parse_report(program_name, src->line_count, state, what);
+			status = 2;
+			shell_set_status(status);
+			/* A script cannot go on after a syntax error */
+			if (!src->prompt)
+				shell_exit(status);
+		}
+		else if ((script = script_new(tokens, root)) != NULL)
+		{
+			/* When nothing follows, the last command may replace the shell */
+			if (src->last && src->in && input_done(src->in))
+				shell_set_tail(root);
+			/* Functions defined here keep the script once it is released */
+			status = script_run(script, program_name, first_line);
+			shell_set_tail(NULL);
+			script_release(script);
+			continue;
+		}
+		node_free(root);
+		free_tokens(tokens);
+	}
+	return (shell_exiting() ? shell_status() : status);
+}
@@ -0,0 +1,252 @@
+#include "hsh.h"
+
+#define SERVE_FDS 3
+#define SERVE_BACKLOG 64
+#define SERVE_MAX_REQUEST (1024 * 1024)
+
+/**
+ * struct serve_request_s - Request read from a client
+ * @buf: The fields, each null-terminated
+ * @len: Length of buf
+ * @fds: Descriptors passed with the request, standard input first
+ * @nfds: Number of descriptors
+ */
+typedef struct serve_request_s
+{
+	char	*buf;
+	size_t	len;
+	int		fds[SERVE_FDS];
+	int		nfds;
+} serve_request_t;
+
+/**
+ * serve_fds - Take the descriptors passed with a message
+ * @req: The request
+ * @msg: The message
+ */
+static void serve_fds(serve_request_t *req, struct msghdr *msg)
+{
+	struct cmsghdr *c;
+	int *fds, n, i;
+
+	for (c = CMSG_FIRSTHDR(msg); c; c = CMSG_NXTHDR(msg, c))
+	{
+		if (c->cmsg_level != SOL_SOCKET || c->cmsg_type != SCM_RIGHTS)
+			continue;
+		fds = (int *)CMSG_DATA(c);
+		n = (c->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+		for (i = 0; i < n; i++)
+		{
+			if (req->nfds < SERVE_FDS)
+				req->fds[req->nfds++] = fds[i];
+			else
+				close(fds[i]);
+		}
+	}
+}
+
+/**
+ * serve_read - Read a whole request
+ * @conn: The connection
+ * @req: The request, filled in
+ *
+ * The descriptors come with the first bytes; the rest of the request is
+ * read until the client shuts down its side of the connection.
+ *
+ * Return: 0 on success, -1 on failure
+ */
+static int serve_read(int conn, serve_request_t *req)
+{
+	union
+	{
+		struct cmsghdr	h;
+		char			buf[CMSG_SPACE(sizeof(int) * SERVE_FDS)];
+	} ctl;
+	struct msghdr msg;
+	struct iovec iov;
+	size_t cap = 4096;
+	ssize_t n;
+	char *tmp;
+
+	req->buf = malloc(cap);
+	if (!req->buf)
+		return (-1);
+	memset(&msg, 0, sizeof(msg));
+	iov.iov_base = req->buf;
+	iov.iov_len = cap - 1;
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = ctl.buf;
+	msg.msg_controllen = sizeof(ctl.buf);
+	n = recvmsg(conn, &msg, MSG_CMSG_CLOEXEC);
+	if (n == -1)
+		return (-1);
+	serve_fds(req, &msg);
+	for (req->len = n; n > 0; req->len += n)
+	{
+		if (req->len + 1 == cap)
+		{
+			if (cap >= SERVE_MAX_REQUEST)
+				return (-1);
+			tmp = malloc(cap * 2);
+			if (!tmp)
+				return (-1);
+			memcpy(tmp, req->buf, req->len);
+			free(req->buf);
+			req->buf = tmp;
+			cap *= 2;
+		}
+		n = read(conn, req->buf + req->len, cap - req->len - 1);
+		if (n == -1)
+			return (-1);
+	}
+	req->buf[req->len] = '\0';
+	return (0);
+}
+
+/**
+ * serve_setup - Prepare a worker to run the command of a request
+ * @req: The request
+ *
+ * The descriptors replace standard input, output and error, in that
+ * order; the first field is the directory to run in, empty to stay; the
+ * next fields up to an empty one change the environment, "NAME=value"
+ * setting and "NAME" unsetting a variable.
+ *
+ * Return: The command, or NULL when the request is invalid
+ */
+static char *serve_setup(serve_request_t *req)
+{
+	char *field = req->buf, *end = req->buf + req->len;
+	size_t len;
+	int i;
+
+	input_stdin_moved();
+	for (i = 0; i < req->nfds; i++)
+	{
+		if (dup2(req->fds[i], i) == -1)
+			return (NULL);
+		close(req->fds[i]);
+	}
+	if (*field && chdir(field) == -1)
+		return (NULL);
+	for (field += _strlen(field) + 1; field < end && *field;
+		field += _strlen(field) + 1)
+	{
+		len = var_name_length(field);
+		if (!len || (field[len] != '=' && field[len] != '\0'))
+			return (NULL);
+		if ((field[len] ? _putenv(field) : _unsetenv(field)) == -1)
+			return (NULL);
+	}
+	/* The command follows the empty field ending the environment */
+	return (field < end ? field + 1 : NULL);
+}
+
+/**
+ * serve_worker - Run one request, in a process of its own
+ * @conn: The connection
+ * @program_name: Name of the shell program
+ *
+ * The status of the command is written back as a decimal line before
+ * the connection is closed, so the worker may not replace itself with the
+ * final command of the request.
+ */
+static void serve_worker(int conn, char *program_name)
+{
+	serve_request_t req = {NULL, 0, {-1, -1, -1}, 0};
+	source_t src = {NULL, NULL, 0, 0};
+	char *command = NULL, reply[16];
+	int status = 2, n;
+
+	signal(SIGCHLD, SIG_DFL);
+	if (serve_read(conn, &req) == 0)
+		command = serve_setup(&req);
+	if (command && (src.in = input_string(command)) != NULL)
+	{
+		status = run_source(&src, program_name);
+		input_close(src.in);
+	}
+	else
+		out_printf(STDERR_FILENO, "%s: --serve: invalid request\n", program_name);
+	out_flush_all();
+	n = snprintf(reply, sizeof(reply), "%d\n", status);
+	write(conn, reply, n);
+	_exit(status);
+}
+
+/**
+ * serve - Run commands sent over a Unix socket
+ * @path: Path of the socket, replaced if a socket is there already
+ * @program_name: Name of the shell program
+ *
+ * Each connection carries one request: up to three descriptors passed with
+ * SCM_RIGHTS, then null-terminated fields, the directory, the environment
+ * changes, an empty field and the command. It runs in a forked worker,
+ * so requests run concurrently and share nothing, and start from a shell
+ * that has already done its startup.
+ *
+ * Example:
+ *   hsh --serve /run/hsh.sock
+ *   request "/tmp\0LANG=C\0\0ls | wc -l\0", fds 0 1 2 - Reply "0\n"
+ *
+ * Return: 2 if the socket cannot be set up; otherwise does not return
+ * until accept fails
+ */
+int serve(const char *path, char *program_name)
+{
+	struct sockaddr_un addr;
+	struct stat st;
+	int fd, conn, exists;
+	pid_t pid;
+
+	if (_strlen(path) >= (int)sizeof(addr.sun_path))
+	{
+		out_printf(STDERR_FILENO, "%s: --serve: %s: path too long\n",
+			program_name, path);
+		return (2);
+	}
+	/* Only a socket left by an earlier server is replaced */
+	exists = lstat(path, &st) == 0;
+	if (exists && !S_ISSOCK(st.st_mode))
+	{
+		out_printf(STDERR_FILENO, "%s: --serve: %s: %s\n", program_name, path,
+			strerror(EEXIST));
+		return (2);
+	}
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	_strcpy(addr.sun_path, path);
+	fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd != -1 && exists)
+		unlink(path);
+	if (fd == -1 || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1 ||
+		listen(fd, SERVE_BACKLOG) == -1)
+	{
+		out_printf(STDERR_FILENO, "%s: --serve: %s: %s\n", program_name, path,
+			strerror(errno));
+		if (fd != -1)
+			close(fd);
+		return (2);
+	}
+
+	/* Workers are never waited for, so they must not linger as zombies */
+	signal(SIGCHLD, SIG_IGN);
+	out_flush_all();
+	while ((conn = accept4(fd, NULL, NULL, SOCK_CLOEXEC)) != -1 || errno == EINTR)
+	{
+		if (conn == -1)
+			continue;
+		pid = fork();
+		if (pid == 0)
+		{
+			close(fd);
+			serve_worker(conn, program_name);
+		}
+		if (pid > 0)
+			stats_add(STAT_FORKS, 1);
+		close(conn);
+	}
+	close(fd);
+	return (1);
+}
@@ -0,0 +1,145 @@
+#include "hsh.h"
+
+/**
+ * struct stage_s - Built-in pipeline stage running on a thread
+ * @thread: The thread
+ * @args: Command and its arguments
+ * @in: Pipe the stage reads, or -1, closed when the thread is joined
+ * @out: Pipe the stage writes, or -1, closed when the thread is joined
+ * @status: Exit status of the built-in
+ * @program_name: Name of the shell program
+ * @line_count: Line of the command
+ * @next: Stage started before this one
+ */
+typedef struct stage_s
+{
+	pthread_t		thread;
+	char			**args;
+	int				in;
+	int				out;
+	int				status;
+	char			*program_name;
+	int				line_count;
+	struct stage_s	*next;
+} stage_t;
+
+/* Stages of the pipeline being started, the last one first */
+static stage_t *stages;
+
+/**
+ * stage_run - Run a built-in stage
+ * @arg: The stage
+ *
+ * SIGPIPE is blocked, so a reader that went away makes the write fail
+ * instead of killing the shell.
+ *
+ * Return: NULL
+ */
+static void *stage_run(void *arg)
+{
+	stage_t *st = arg;
+	sigset_t set;
+
+	sigemptyset(&set);
+	sigaddset(&set, SIGPIPE);
+	pthread_sigmask(SIG_BLOCK, &set, NULL);
+	if (st->out != -1)
+		out_redirect(STDOUT_FILENO, st->out);
+	handle_builtin(st->args, &st->status, st->program_name, st->line_count);
+	out_flush_all();
+	return (NULL);
+}
+
+/**
+ * stage_start - Run a pipeline stage on a thread of the shell
+ * @args: Command and its arguments, without redirections or assignments
+ * @in: Pipe from the previous stage, or -1
+ * @out: Pipe to the next stage, or -1
+ * @program_name: Name of the shell program
+ * @line_count: Line of the command
+ *
+ * Saves the fork of a child that would only call the built-in and exit.
+ * The pipes belong to the stage from then on, until stage_join.
+ *
+ * Example:
+ *   env | grep PATH   - env on a thread, one fork for grep
+ *
+ * Return: 0 if the stage runs, -1 if it must be forked as usual
+ */
+int stage_start(char **args, int in, int out, char *program_name,
+	int line_count)
+{
+	stage_t *st;
+
+	if (!args[0] || !builtin_threadable(builtin_index(args[0])))
+		return (-1);
+	st = malloc(sizeof(*st));
+	if (!st)
+		return (-1);
+	st->args = args;
+	st->in = in;
+	st->out = out;
+	st->status = 0;
+	st->program_name = program_name;
+	st->line_count = line_count;
+	if (pthread_create(&st->thread, NULL, stage_run, st) != 0)
+	{
+		free(st);
+		return (-1);
+	}
+	st->next = stages;
+	stages = st;
+	return (0);
+}
+
+/**
+ * stage_join - Wait for the stages running on threads
+ *
+ * Their pipes are closed here, by the shell, rather than by the threads:
+ * a descriptor number freed while the shell forks could be handed out
+ * again before the child closes it in stage_forget.
+ *
+ * Return: Status of the last stage started, or -1 if there was none
+ */
+int stage_join(void)
+{
+	stage_t *st;
+	int status = -1;
+
+	while (stages)
+	{
+		st = stages;
+		stages = st->next;
+		pthread_join(st->thread, NULL);
+		if (status == -1)
+			status = st->status;
+		if (st->in != -1)
+			close(st->in);
+		if (st->out != -1)
+			close(st->out);
+		free(st);
+	}
+	return (status);
+}
+
+/**
+ * stage_forget - Close the pipes of the threaded stages in a new child
+ *
+ * The threads are not copied into the child; their pipes are, and a child
+ * keeping the write end of a pipe open would never see its end.
+ */
+void stage_forget(void)
+{
+	stage_t *st;
+
+	while (stages)
+	{
+		st = stages;
+		stages = st->next;
+		if (st->in != -1)
+			close(st->in);
+		if (st->out != -1)
+			close(st->out);
+		free(st);
+	}
+}
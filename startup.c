@@ -0,0 +1,155 @@
+#include "hsh.h"
+
+#define STARTUP_PHASES 8
+
+/**
+ * struct startup_s - Timings of the startup phases
+ * @origin: Time at which the shell started
+ * @mark: End of the previous phase
+ * @names: Name of each recorded phase
+ * @usec: Duration of each recorded phase, in microseconds
+ * @count: Number of recorded phases
+ */
+typedef struct startup_s
+{
+	struct timespec	origin;
+	struct timespec	mark;
+	const char		*names[STARTUP_PHASES];
+	long			usec[STARTUP_PHASES];
+	int				count;
+} startup_t;
+
+static startup_t startup;
+
+/**
+ * startup_elapsed - Microseconds between two instants
+ * @from: Start
+ * @to: End
+ *
+ * Return: The elapsed time in microseconds
+ */
+static long startup_elapsed(struct timespec *from, struct timespec *to)
+{
+	return ((to->tv_sec - from->tv_sec) * 1000000L +
+		(to->tv_nsec - from->tv_nsec) / 1000);
+}
+
+/**
+ * startup_phase - Close the current startup phase
+ * @name: Name of the phase that just ended
+ */
+static void startup_phase(const char *name)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	if (startup.count < STARTUP_PHASES)
+	{
+		startup.names[startup.count] = name;
+		startup.usec[startup.count++] = startup_elapsed(&startup.mark, &now);
+	}
+	startup.mark = now;
+}
+
+/**
+ * source_file - Run every line of a file as shell commands
+ * @path: Path of the file
+ * @program_name: Name of the shell program
+ *
+ * A missing file is not an error.
+ *
+ * Example:
+ *   source_file("/home/me/.hshrc", "./hsh");
+ *
+ * Return: Status of the last command, or 0 if the file cannot be read
+ */
+int source_file(const char *path, char *program_name)
+{
+	source_t src = {NULL, NULL, 0, 0};
+	int fd, status;
+
+	fd = redirect_reserve(open(path, O_RDONLY | O_CLOEXEC));
+	if (fd == -1)
+		return (0);
+	src.in = input_open(fd);
+	if (!src.in)
+	{
+		close(fd);
+		return (0);
+	}
+
+	status = run_source(&src, program_name);
+	input_close(src.in);
+	close(fd);
+	return (status);
+}
+
+/**
+ * startup_init - Run the startup phases of the shell
+ * @program_name: Name of the shell program
+ * @interactive: 1 for an interactive shell, 0 otherwise
+ *
+ * An interactive shell reads ~/.hshrc, loads its history and enables the
+ * PATH index used by completion. Any other shell only reads the file named
+ * by ENV, when set, and skips everything else.
+ */
+void startup_init(char *program_name, int interactive)
+{
+	char rc[PATH_MAX], *env, *home;
+
+	rc[0] = '\0';
+	shell_set_interactive(interactive);
+	if (interactive)
+	{
+		home = _getenv("HOME");
+		if (home && *home)
+			snprintf(rc, sizeof(rc), "%s/.hshrc", home);
+	}
+	else
+	{
+		env = _getenv("ENV");
+		if (env && *env && (size_t)_strlen(env) < sizeof(rc))
+			_strcpy(rc, env);
+	}
+	startup_phase("environment");
+
+	if (rc[0])
+		source_file(rc, program_name);
+	startup_phase("rc file");
+
+	if (!interactive)
+		return;
+	hist_file_open();
+	startup_phase("history");
+	path_index_enable();
+	startup_phase("completion");
+}
+
+/**
+ * startup_begin - Record the time at which the shell started
+ */
+void startup_begin(void)
+{
+	clock_gettime(CLOCK_MONOTONIC, &startup.origin);
+	startup.mark = startup.origin;
+}
+
+/**
+ * startup_report - Print the duration of each startup phase on stderr
+ *
+ * Example:
+ *   $ ./hsh --startup-profile -c true
+ *   hsh: startup: environment     0.002 ms
+ *   hsh: startup: rc file         0.001 ms
+ *   hsh: startup: total           0.035 ms
+ */
+void startup_report(void)
+{
+	int i;
+
+	for (i = 0; i < startup.count; i++)
+		fprintf(stderr, "hsh: startup: %-12s %8.3f ms\n",
+			startup.names[i], startup.usec[i] / 1000.0);
+	fprintf(stderr, "hsh: startup: %-12s %8.3f ms\n", "total",
+		startup_elapsed(&startup.origin, &startup.mark) / 1000.0);
+}
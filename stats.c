@@ -0,0 +1,207 @@
+#include "hsh.h"
+
+#define STATS_BUILTINS 32
+#define STATS_SLOTS (STAT_COUNT + STATS_BUILTINS)
+
+static const char *const stat_names[STAT_COUNT] = {
+	"commands", "forks", "execs", "path_lookups", "path_stats",
+	"path_shm_hits", "heredoc_bytes", "tokenizer_allocs"
+};
+
+/* Used until stats_init maps the shared counters, and if mapping fails */
+static unsigned long fallback[STATS_SLOTS];
+static unsigned long *counters = fallback;
+
+/* Time since stats_init and time spent waiting for children, in ns */
+static struct timespec started;
+static unsigned long long wait_ns;
+
+/* Process that asked for a report at exit, and its format */
+static pid_t exit_pid;
+static int exit_machine;
+
+/**
+ * stats_init - Set up the counters
+ *
+ * The counters live in a shared anonymous mapping, so what a forked child
+ * counts, such as the exec of its command, is seen by the shell too. A
+ * process that execs leaves the mapping behind.
+ */
+void stats_init(void)
+{
+	void *p;
+
+	clock_gettime(CLOCK_MONOTONIC, &started);
+	p = mmap(NULL, sizeof(fallback), PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (p != MAP_FAILED)
+		counters = p;
+}
+
+/**
+ * stats_add - Add to a counter
+ * @id: The counter
+ * @n: Amount to add
+ *
+ * A plain addition: no lock and no system call, so counting stays on.
+ * Two processes adding at the same instant may lose one of the updates.
+ */
+void stats_add(stat_id_t id, unsigned long n)
+{
+	counters[id] += n;
+}
+
+/**
+ * stats_builtin - Count a run of a built-in
+ * @i: Index of the built-in, as given to builtin_name
+ */
+void stats_builtin(int i)
+{
+	if (i >= 0 && i < STATS_BUILTINS)
+		counters[STAT_COUNT + i]++;
+}
+
+/**
+ * elapsed_ns - Nanoseconds between two instants
+ * @from: The earlier instant
+ * @to: The later instant
+ *
+ * Return: The difference
+ */
+static unsigned long long elapsed_ns(const struct timespec *from,
+	const struct timespec *to)
+{
+	return ((to->tv_sec - from->tv_sec) * 1000000000ULL +
+		to->tv_nsec - from->tv_nsec);
+}
+
+/**
+ * stats_wait - Wait for a child, counting the time spent waiting
+ * @pid: The child, or -1 for any child
+ * @status: Where to store its status, or NULL
+ *
+ * The clock is read through the vDSO, without a system call.
+ *
+ * Return: Process id of the child reaped, or -1 on failure
+ */
+pid_t stats_wait(pid_t pid, int *status)
+{
+	struct timespec from, to;
+	pid_t r;
+
+	clock_gettime(CLOCK_MONOTONIC, &from);
+	r = waitpid(pid, status, 0);
+	clock_gettime(CLOCK_MONOTONIC, &to);
+	wait_ns += elapsed_ns(&from, &to);
+	return (r);
+}
+
+/**
+ * stats_report - Print the counters
+ * @fd: Where to print them
+ * @machine: 1 for one key=value per line, 0 for aligned columns
+ *
+ * Built-ins never run are left out of the columns but not of the key=value
+ * form, so reports from different hosts have the same keys.
+ *
+ * Example:
+ *   commands            12      commands=12
+ *   forks               10      forks=10
+ *   builtin.cd           1      builtin.cd=1
+ *   shell_time      0.004 s     shell_ns=4012345
+ *   wait_time       1.250 s     wait_ns=1250331220
+ */
+void stats_report(int fd, int machine)
+{
+	struct timespec now;
+	unsigned long long total, shell;
+	const char *name;
+	int i;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	total = elapsed_ns(&started, &now);
+	shell = total > wait_ns ? total - wait_ns : 0;
+	for (i = 0; i < STAT_COUNT; i++)
+		out_printf(fd, machine ? "%s=%lu\n" : "%-18s %10lu\n",
+			stat_names[i], counters[i]);
+	for (i = 0; i < STATS_BUILTINS && (name = builtin_name(i)); i++)
+		if (machine)
+			out_printf(fd, "builtin.%s=%lu\n", name, counters[STAT_COUNT + i]);
+		else if (counters[STAT_COUNT + i])
+			out_printf(fd, "builtin.%-10s %10lu\n", name,
+				counters[STAT_COUNT + i]);
+	if (machine)
+		out_printf(fd, "shell_ns=%llu\nwait_ns=%llu\n", shell, wait_ns);
+	else
+		out_printf(fd, "%-18s %8llu.%03llu s\n%-18s %8llu.%03llu s\n",
+			"shell_time", shell / 1000000000ULL, shell / 1000000 % 1000,
+			"wait_time", wait_ns / 1000000000ULL, wait_ns / 1000000 % 1000);
+}
+
+/**
+ * stats_exit - Print the counters on stderr when the shell exits
+ *
+ * Forked children run the same exit handlers; only the process that asked
+ * for the report prints it.
+ */
+static void stats_exit(void)
+{
+	if (getpid() == exit_pid)
+		stats_report(STDERR_FILENO, exit_machine);
+}
+
+/**
+ * stats_exit_pending - Tell whether the counters are printed at exit
+ *
+ * The shell then may not replace itself with its last command.
+ *
+ * Return: 1 if they are, 0 otherwise
+ */
+int stats_exit_pending(void)
+{
+	return (exit_pid == getpid());
+}
+
+/**
+ * builtin_stats - Handle the stats built-in command
+ * @args: Arguments passed to the stats command
+ * @program_name: Name of the shell program
+ * @line_count: Current line count for error messages
+ *
+ * Examples:
+ *   stats        - Prints the counters in columns
+ *   stats -m     - Prints them as key=value lines
+ *   stats -e     - Prints them on stderr when the shell exits instead
+ *
+ * Return: 0 on success, 2 on a usage error
+ */
+int builtin_stats(char **args, char *program_name, int line_count)
+{
+	int i, j, machine = 0, at_exit = 0;
+
+	for (i = 1; args[i]; i++)
+	{
+		j = args[i][0] == '-' && args[i][1] ? 1 : 0;
+		while (j && (args[i][j] == 'm' || args[i][j] == 'e'))
+		{
+			machine |= args[i][j] == 'm';
+			at_exit |= args[i][j++] == 'e';
+		}
+		if (!j || args[i][j])
+		{
+			out_printf(STDERR_FILENO, "%s: %d: stats: Illegal option %s\n",
+					program_name, line_count, args[i]);
+			return (2);
+		}
+	}
+	if (!at_exit)
+	{
+		stats_report(STDOUT_FILENO, machine);
+		return (0);
+	}
+	if (!exit_pid)
+		atexit(stats_exit);
+	exit_pid = getpid();
+	exit_machine = machine;
+	return (0);
+}
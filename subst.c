@@ -0,0 +1,139 @@
+#include "hsh.h"
+
+/**
+ * struct subst_s - Running process substitution
+ * @pid: Process running the command, 0 once reaped
+ * @fd: The shell's end of the pipe, named /dev/fd/fd on the command line
+ */
+typedef struct subst_s
+{
+	pid_t	pid;
+	int		fd;
+} subst_t;
+
+/* Substitutions of the commands being run, innermost last */
+static subst_t *substs;
+static int subst_count;
+static int subst_cap;
+
+/**
+ * subst_forget - Close the pipes of the substitutions in a new child
+ *
+ * They belong to the parent; the child neither reads them nor waits for
+ * their processes.
+ */
+static void subst_forget(void)
+{
+	while (subst_count > 0)
+		close(substs[--subst_count].fd);
+}
+
+/**
+ * subst_open - Start a process substitution
+ * @command: The command between the parentheses
+ * @reading: 1 for <(command), whose output the shell's command reads; 0
+ * for >(command), which reads what the shell's command writes
+ *
+ * The command runs in a forked shell, the same way as a pipeline stage,
+ * with one end of a pipe as its stdout or stdin. The other end stays open
+ * in the shell, without close-on-exec, so the command given /dev/fd/N
+ * inherits it. No file is created.
+ *
+ * Example:
+ *   diff <(sort a) <(sort b)   - diff /dev/fd/3 /dev/fd/4
+ *
+ * Return: The shell's end of the pipe, or -1 on failure
+ */
+int subst_open(const char *command, int reading)
+{
+	source_t src = {NULL, NULL, 0, 0};
+	subst_t *tmp;
+	int fds[2], status;
+	pid_t pid;
+
+	if (subst_count == subst_cap)
+	{
+		tmp = _realloc(substs, sizeof(subst_t) * (subst_cap ? subst_cap * 2 : 4));
+		if (!tmp)
+			return (-1);
+		substs = tmp;
+		subst_cap = subst_cap ? subst_cap * 2 : 4;
+	}
+	if (pipe(fds) == -1)
+		return (-1);
+	out_flush_all();
+	input_sync_stdin();
+	pid = fork();
+	if (pid == 0)
+	{
+		subst_forget();
+		if (!reading)
+			input_stdin_moved();
+		dup2(fds[reading ? 1 : 0], reading ? STDOUT_FILENO : STDIN_FILENO);
+		close(fds[0]);
+		close(fds[1]);
+		src.in = input_string(command);
+		status = src.in ? run_source(&src, shell_name()) : 1;
+		exit(shell_exiting() ? shell_status() : status);
+	}
+	close(fds[reading ? 1 : 0]);
+	if (pid == -1)
+	{
+		close(fds[reading ? 0 : 1]);
+		return (-1);
+	}
+	stats_add(STAT_FORKS, 1);
+	substs[subst_count].pid = pid;
+	substs[subst_count].fd = fds[reading ? 0 : 1];
+	return (substs[subst_count++].fd);
+}
+
+/**
+ * subst_mark - Remember how many substitutions are running
+ *
+ * Return: The mark, to give to subst_close when the command ends
+ */
+int subst_mark(void)
+{
+	return (subst_count);
+}
+
+/**
+ * subst_close - End the substitutions started since a mark
+ * @mark: The mark, from subst_mark
+ *
+ * The shell's ends of the pipes are closed, so a <(command) still writing
+ * gets SIGPIPE and a >(command) sees end of input, then their processes are
+ * waited for.
+ */
+void subst_close(int mark)
+{
+	subst_t *s;
+
+	while (subst_count > mark)
+	{
+		s = &substs[--subst_count];
+		close(s->fd);
+		if (s->pid > 0)
+			stats_wait(s->pid, NULL);
+	}
+}
+
+/**
+ * subst_reaped - Note that a process was reaped while waiting for others
+ * @pid: The process
+ *
+ * Return: 1 if it ran a process substitution, 0 otherwise
+ */
+int subst_reaped(pid_t pid)
+{
+	int i;
+
+	for (i = 0; i < subst_count; i++)
+		if (substs[i].pid == pid)
+		{
+			substs[i].pid = 0;
+			return (1);
+		}
+	return (0);
+}
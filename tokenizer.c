@@ -1,5 +1,35 @@
 #include "hsh.h"
 
+/*
+ * The one copy of each operator, indexed by kind. Operator tokens point
+ * here instead of to a string of their own, so their kind is known from
+ * the pointer, and a word that reads like an operator, such as a quoted
+ * '|' once expanded, is never taken for one.
+ */
+static char op_text[TOK_COUNT][3] = {
+	"", "|", "||", "&", "&&", ";", ";;", "<", "<<", ">", ">>", "<&", ">&", "(",
+	")", "\n"
+};
+
+/**
+ * token_kind - Get the kind of a token
+ * @token: The token, from tokenize_command or expand_tokens
+ *
+ * Example:
+ *   if (token_kind(tokens[i][0]) == TOK_PIPE)   - No string comparison
+ *
+ * Return: The kind of operator, or TOK_WORD for a word
+ */
+tok_kind_t token_kind(const char *token)
+{
+	uintptr_t p = (uintptr_t)token, base = (uintptr_t)op_text;
+
+	if (p <= base || p >= base + sizeof(op_text) ||
+		(p - base) % sizeof(op_text[0]))
+		return (TOK_WORD);
+	return ((tok_kind_t)((p - base) / sizeof(op_text[0])));
+}
+
 /**
  * free_tokens - Frees the memory allocated for the tokens
  * @tokens: The array of tokens to free
@@ -19,7 +49,8 @@ void free_tokens(char ***tokens)
 	{
 		/* Free each token string in the current command */
 		for (j = 0; tokens[i][j] != NULL; j++)
-			free(tokens[i][j]);
+			if (token_kind(tokens[i][j]) == TOK_WORD)
+				free(tokens[i][j]);
 		/* Free the current command array */
 		free(tokens[i]);
 	}
@@ -27,55 +58,242 @@ void free_tokens(char ***tokens)
 	free(tokens);
 }
 
+/**
+ * token_alloc - Allocate memory for tokens, counting the allocation
+ * @size: Number of bytes
+ *
+ * Return: The memory, or NULL on failure
+ */
+static void *token_alloc(size_t size)
+{
+	stats_add(STAT_TOKENIZER_ALLOCS, 1);
+	return (malloc(size));
+}
+
+/**
+ * grow_array - Keep room for two more entries in an array
+ * @arr: The array
+ * @count: Number of entries in use
+ * @cap: Pointer to the allocated number of entries
+ * @size: Size of one entry
+ *
+ * Return: The array, moved if it had to grow, or NULL on failure
+ */
+static void *grow_array(void *arr, int count, int *cap, size_t size)
+{
+	void *tmp;
+
+	if (count + 2 < *cap)
+		return (arr);
+	tmp = token_alloc(size * *cap * 2);
+	if (!tmp)
+		return (NULL);
+	memcpy(tmp, arr, size * count);
+	free(arr);
+	*cap *= 2;
+	return (tmp);
+}
+
+/**
+ * operator_length - Length of the operator starting a string
+ * @s: The string
+ *
+ * Example:
+ *   operator_length(">> out")   - 2
+ *   operator_length(">&2")      - 2
+ *   operator_length("ls")       - 0
+ *   operator_length("<(ls)")    - 0
+ *
+ * Return: 1 or 2 for an operator, 0 otherwise
+ */
+static int operator_length(const char *s)
+{
+	if (!*s || !_strchr("|&;<>()", *s))
+		return (0);
+	/* "<(" and ">(" start a process substitution, part of a word */
+	if ((*s == '<' || *s == '>') && s[1] == '(')
+		return (0);
+	if (s[1] == s[0] && _strchr("|&;<>", *s))
+		return (2);
+	if ((*s == '<' || *s == '>') && s[1] == '&')
+		return (2);
+	return (1);
+}
+
+/**
+ * io_number - Tell whether a string starts with the descriptor number of a
+ * redirection
+ * @s: The string, at the start of a word
+ *
+ * The number is a single digit written right before the operator.
+ *
+ * Example:
+ *   io_number("2>/dev/null")   - 1
+ *   io_number("2 > out")       - 0
+ *   io_number("12>out")        - 0
+ *
+ * Return: 1 if it does, 0 otherwise
+ */
+static int io_number(const char *s)
+{
+	return (*s >= '0' && *s <= '9' && (s[1] == '<' || s[1] == '>') &&
+		operator_length(s + 1));
+}
+
+/**
+ * skip_arith - Find the end of an arithmetic expansion
+ * @s: The "$((" starting it
+ *
+ * Return: Pointer to the character after the closing "))", or to the end
+ * of the line when it is missing
+ */
+static char *skip_arith(char *s)
+{
+	int depth = 0;
+
+	for (s += 3; *s && *s != '\n'; s++)
+	{
+		if (*s == '(')
+			depth++;
+		else if (*s == ')' && depth > 0)
+			depth--;
+		else if (*s == ')' && s[1] == ')')
+			return (s + 2);
+	}
+	return (s);
+}
+
+/**
+ * skip_subst - Find the end of a process substitution
+ * @s: The "<(" or ">(" starting it
+ *
+ * Parentheses nest; quoted ones and escaped ones do not count.
+ *
+ * Example:
+ *   skip_subst("<(sort 'a)b') | wc")   - Points to " | wc"
+ *
+ * Return: Pointer to the character after the closing ')', or to the end
+ * of the line when it is missing
+ */
+const char *skip_subst(const char *s)
+{
+	int depth = 0;
+	char quote;
+
+	for (s += 2; *s && *s != '\n'; s++)
+	{
+		if (*s == '\\' && s[1])
+			s++;
+		else if (*s == '\'' || *s == '"')
+		{
+			quote = *s;
+			while (s[1] && s[1] != quote)
+				s += (quote == '"' && s[1] == '\\' && s[2]) ? 2 : 1;
+			if (s[1])
+				s++;
+		}
+		else if (*s == '(')
+			depth++;
+		else if (*s == ')' && depth-- == 0)
+			return (s + 1);
+	}
+	return (s);
+}
+
+/**
+ * skip_word - Find the end of a word, stepping over quoted parts
+ * @s: Start of the word
+ * @open: Set to the quote left open at the end of the input, may be NULL
+ *
+ * Quotes and backslashes are kept in the word; they are removed when the
+ * word is expanded. An unterminated quote runs to the end of the input.
+ * An arithmetic expansion or a process substitution is part of the word,
+ * blanks and parentheses included.
+ *
+ * Return: Pointer to the first character after the word
+ */
+static char *skip_word(char *s, char *open)
+{
+	char quote;
+
+	if (open)
+		*open = '\0';
+
+	while (*s && !_strchr(" \t\n", *s) && !operator_length(s))
+	{
+		if (*s == '\\' && s[1])
+			s += 2;
+		else if (s[0] == '$' && s[1] == '(' && s[2] == '(')
+			s = skip_arith(s);
+		else if ((s[0] == '<' || s[0] == '>') && s[1] == '(')
+			s = (char *)skip_subst(s);
+		else if (*s == '\'' || *s == '"')
+		{
+			quote = *s++;
+			while (*s && *s != quote)
+				s += (quote == '"' && *s == '\\' && s[1]) ? 2 : 1;
+			if (*s)
+				s++;
+			else if (open)
+				*open = quote;
+		}
+		else
+			s++;
+	}
+	return (s);
+}
+
 /**
  * tokenize_args - Tokenizes a command and its arguments
- * @command: The command string to tokenize
+ * @input: The input string
+ * @pos: Position of the command, moved past its last word
+ *
+ * Words are separated by blanks and end at an operator, a newline or a
+ * comment. Blanks and operators inside quotes do not split a word.
  *
  * Example:
- *   Input: "ls -l /tmp"
- *   Output: ["ls", "-l", "/tmp", NULL]
+ *   Input: "ls -l 'my file' | wc"
+ *   Output: ["ls", "-l", "'my file'", NULL], pos on the '|'
  *
  * Return: A pointer to an array of strings, or NULL on failure
  */
-static char **tokenize_args(char *command)
+static char **tokenize_args(char *input, int *pos)
 {
-	char **args, *token, *str, *saveptr;
-	int i = 0, j;
+	char **args, **tmp, *end;
+	int i = 0, j, cap = 16;
 
-	/* Check for NULL input */
-	if (!command)
+	args = token_alloc(sizeof(char *) * cap);
+	if (!args)
 		return (NULL);
 
-	/* Allocate memory for arguments array and duplicate command string */
-	args = malloc(sizeof(char *) * MAX_TOKENS);
-	str = _strdup(command);
-	if (!args || !str)
+	while (1)
 	{
-		free(args);
-		free(str);
-		return (NULL);
-	}
+		while (input[*pos] == ' ' || input[*pos] == '\t')
+			(*pos)++;
+		if (!input[*pos] || input[*pos] == '\n' || input[*pos] == '#' ||
+			operator_length(&input[*pos]) || io_number(&input[*pos]))
+			break;
 
-	token = _strtok_r(str, " \t", &saveptr);
-	while (token != NULL && i < MAX_TOKENS - 1)
-	{
-		/* Duplicate each token and store in args array */
-		args[i] = _strdup(token);
+		end = skip_word(&input[*pos], NULL);
+		tmp = grow_array(args, i, &cap, sizeof(char *));
+		if (tmp)
+			args = tmp;
+		args[i] = tmp ? token_alloc(end - &input[*pos] + 1) : NULL;
 		if (!args[i])
 		{
 			/* Clean up if duplication fails */
-			free(str);
 			for (j = 0; j < i; j++)
 				free(args[j]);
 			free(args);
 			return (NULL);
 		}
+		memcpy(args[i], &input[*pos], end - &input[*pos]);
+		args[i][end - &input[*pos]] = '\0';
+		*pos = end - input;
 		i++;
-		token = _strtok_r(NULL, " \t", &saveptr);
 	}
 	/* Terminate args array with NULL */
 	args[i] = NULL;
-	free(str);
 	return (args);
 }
 
@@ -83,40 +301,57 @@ static char **tokenize_args(char *command)
  * handle_operator - Handles an operator token
  * @commands: Array of commands
  * @idx: Current index
- * @op_char: Operator character
- * @is_double: Whether it's a double operator
+ * @op: Operator string
+ * @len: Length of the operator
+ * @io: Descriptor number written before a redirection, or NULL
+ *
+ * An operator points to its copy in op_text; anything else, such as a
+ * heredoc delimiter, is copied. The descriptor number of a redirection
+ * follows the operator in its segment.
  *
  * Example:
- *   op_char = '>', is_double = 1
- *   Result: commands[idx] = [">>", NULL]
+ *   op = ">>", len = 2, io = "2>> log"
+ *   Result: commands[idx] = [">>", "2", NULL]
  *
  * Return: 1 on success, 0 on failure
  */
-static int handle_operator(char ***commands, int idx, char op_char, int is_double)
+static int handle_operator(char ***commands, int idx, const char *op, int len,
+	const char *io)
 {
-	char op[3];
-
-	/* Validate input parameters */
-	if (!commands || idx < 0 || idx >= MAX_TOKENS - 1)
-		return (0);
-
-	/* Create operator string (single or double character) */
-	op[0] = op_char;
-	op[1] = is_double ? op_char : '\0';
-	op[2] = '\0';
+	int kind;
 
 	/* Allocate memory for operator command array */
-	commands[idx] = malloc(sizeof(char *) * 2);
+	commands[idx] = token_alloc(sizeof(char *) * 3);
 	if (!commands[idx])
 		return (0);
+	commands[idx][1] = NULL;
+	commands[idx][2] = NULL;
+	for (kind = TOK_WORD + 1; kind < TOK_COUNT; kind++)
+		if (_strncmp(op_text[kind], op, len) == 0 && !op_text[kind][len])
+		{
+			commands[idx][0] = op_text[kind];
+			if (!io)
+				return (1);
+			commands[idx][1] = token_alloc(2);
+			if (!commands[idx][1])
+			{
+				free(commands[idx]);
+				return (0);
+			}
+			commands[idx][1][0] = *io;
+			commands[idx][1][1] = '\0';
+			return (1);
+		}
 
-	/* Copy operator string and set NULL terminator */
-	commands[idx][0] = _strdup(op);
+	/* Copy the string and set NULL terminator */
+	commands[idx][0] = token_alloc(len + 1);
 	if (!commands[idx][0])
 	{
 		free(commands[idx]);
 		return (0);
 	}
+	memcpy(commands[idx][0], op, len);
+	commands[idx][0][len] = '\0';
 	commands[idx][1] = NULL;
 	return (1);
 }
@@ -125,6 +360,11 @@ static int handle_operator(char ***commands, int idx, char op_char, int is_doubl
  * tokenize_command - Tokenizes a command string with operators
  * @input: The input string to tokenize
  *
+ * Operators are "|", "||", "&", "&&", ";", ";;", "<", "<<", ">", ">>", "<&",
+ * ">&", "(" and ")". A newline becomes a "\n" operator. The word after "<<"
+ * is kept in its own segment; the heredoc body read later is stored after
+ * it. A digit right before a redirection is the descriptor it applies to.
+ *
  * Example:
  *   Input: "ls -l | grep file > output.txt"
  *   Output: [["ls", "-l", NULL], ["|", NULL], ["grep", "file", NULL],
@@ -134,175 +374,150 @@ static int handle_operator(char ***commands, int idx, char op_char, int is_doubl
  */
 char ***tokenize_command(char *input)
 {
-	char *input_copy, ***commands, tmp;
-	int i = 0, j = 0, start, is_double;
+	char ***commands, ***tmp, *end;
+	int i = 0, j = 0, len, cap = 16, ok, io;
 
 	/* Check for NULL input */
 	if (!input)
 		return (NULL);
 
-	/* Create a copy of input and allocate memory for commands array */
-	input_copy = _strdup(input);
-	commands = malloc(sizeof(char **) * MAX_TOKENS);
-	if (!commands || !input_copy)
-	{
-		free(input_copy);
-		free(commands);
+	commands = token_alloc(sizeof(char **) * cap);
+	if (!commands)
 		return (NULL);
-	}
 
-	while (input_copy[j] != '\0' && i < MAX_TOKENS - 1)
+	while (input[j] != '\0')
 	{
 		/* Skip spaces */
-		while (input_copy[j] == ' ' || input_copy[j] == '\t')
+		while (input[j] == ' ' || input[j] == '\t')
 			j++;
-		if (input_copy[j] == '\0')
+		/* A comment runs to the end of the line */
+		if (input[j] == '#')
+		{
+			while (input[j] && input[j] != '\n')
+				j++;
+		}
+		if (input[j] == '\0')
 			break;
 
-		/* Handle operators */
-		if (input_copy[j] == '|' || input_copy[j] == '>' || input_copy[j] == '<' || input_copy[j] == ';' || input_copy[j] == '&')
+		tmp = grow_array(commands, i, &cap, sizeof(char **));
+		if (!tmp)
 		{
-			/* Check for logical operators (|| and &&) */
-			if ((input_copy[j] == '|' && input_copy[j + 1] == '|') ||
-				(input_copy[j] == '&' && input_copy[j + 1] == '&'))
-			{
-				/* Create a separate token for logical operators */
-				char op[3];
-				op[0] = input_copy[j];
-				op[1] = input_copy[j];
-				op[2] = '\0';
-
-				/* Set up the operator token */
-				commands[i] = malloc(sizeof(char *) * 2);
-				if (!commands[i])
-				{
-					free_tokens(commands);
-					free(input_copy);
-					return (NULL);
-				}
-
-				commands[i][0] = _strdup(op);
-				if (!commands[i][0])
-				{
-					free(commands[i]);
-					free_tokens(commands);
-					free(input_copy);
-					return (NULL);
-				}
-				commands[i][1] = NULL;
-
-				i++;
-				j += 2; /* Skip both characters of the logical operator */
-				continue;
-			}
-			else
-			{
-				is_double = (input_copy[j] == '>' || input_copy[j] == '<') &&
-					input_copy[j + 1] == input_copy[j];
-			}
+			commands[i] = NULL;
+			free_tokens(commands);
+			return (NULL);
+		}
+		commands = tmp;
 
-			/* Special handling for heredoc (<<) */
-			if (input_copy[j] == '<' && input_copy[j + 1] == '<')
+		io = io_number(&input[j]);
+		j += io;
+		len = input[j] == '\n' ? 1 : operator_length(&input[j]);
+		if (len)
+		{
+			ok = handle_operator(commands, i, &input[j], len,
+				io ? &input[j - 1] : NULL);
+			j += len;
+			/* The heredoc delimiter is a segment of its own */
+			if (ok && len == 2 && input[j - 1] == '<')
 			{
-				/* Create the << operator token */
-				if (!handle_operator(commands, i, input_copy[j], 1))
-				{
-					free_tokens(commands);
-					free(input_copy);
-					return (NULL);
-				}
-				i++;
-				j += 2;
-
-				/* Skip any whitespace */
-				while (input_copy[j] == ' ' || input_copy[j] == '\t')
-					j++;
-
-				/* Extract the delimiter */
-				start = j;
-				while (input_copy[j] != '\0' && input_copy[j] != ' ' &&
-					input_copy[j] != '\t' && input_copy[j] != '\n' &&
-					input_copy[j] != '|' && input_copy[j] != '>' &&
-					input_copy[j] != '<')
+				commands[++i] = NULL;
+				while (input[j] == ' ' || input[j] == '\t')
 					j++;
-
-				/* Create a token for the delimiter */
-				if (j > start)
-				{
-					tmp = input_copy[j];
-					input_copy[j] = '\0';
-
-					/* Allocate memory for delimiter array */
-					commands[i] = malloc(sizeof(char *) * 2);
-					if (!commands[i])
-					{
-						free_tokens(commands);
-						free(input_copy);
-						return (NULL);
-					}
-
-					/* Copy delimiter string */
-					commands[i][0] = _strdup(&input_copy[start]);
-					if (!commands[i][0])
-					{
-						free(commands[i]);
-						free_tokens(commands);
-						free(input_copy);
-						return (NULL);
-					}
-					commands[i][1] = NULL;
-
-					/* Restore original character */
-					input_copy[j] = tmp;
-					i++;
-				}
-			}
-			else
-			{
-				/* Standard operator handling */
-				if (!handle_operator(commands, i, input_copy[j], is_double))
+				end = skip_word(&input[j], NULL);
+				if (end > &input[j])
 				{
-					free_tokens(commands);
-					free(input_copy);
-					return (NULL);
+					ok = handle_operator(commands, i, &input[j], end - &input[j],
+						NULL);
+					j = end - input;
 				}
-				i++;
-				j += is_double ? 2 : 1;
+				else
+					i--;
 			}
 		}
-		/* Handle regular commands */
 		else
-		{
-			start = j;
-			/* Find the end of the current command (until next operator or end of string) */
-			while (input_copy[j] != '\0' &&
-				   input_copy[j] != '|' &&
-				   input_copy[j] != '>' &&
-				   input_copy[j] != '<' &&
-				   input_copy[j] != ';' &&
-				   input_copy[j] != '&')
-				j++;
+			ok = (commands[i] = tokenize_args(input, &j)) != NULL;
 
-			/* Temporarily null-terminate the command string */
-			tmp = input_copy[j];
-			input_copy[j] = '\0';
-
-			/* Process current command segment with tokenize_args */
-			commands[i] = tokenize_args(&input_copy[start]);
-			if (!commands[i])
-			{
-				/* Clean up on failure */
-				free_tokens(commands);
-				free(input_copy);
-				return (NULL);
-			}
-			i++;
-			/* Restore the original character */
-			input_copy[j] = tmp;
+		if (!ok)
+		{
+			/* Clean up on failure */
+			commands[i] = NULL;
+			free_tokens(commands);
+			return (NULL);
 		}
+		i++;
 	}
 	/* Set NULL terminator for commands array */
 	commands[i] = NULL;
-	free(input_copy);
 	return (commands);
 }
+
+/**
+ * quote_open - Tell whether the input ends inside a quoted string
+ * @input: The input, one or more lines
+ *
+ * Words, comments and operators are stepped over the way tokenize_command
+ * does, so a quote in a comment does not count.
+ *
+ * Example:
+ *   quote_open("echo 'it") - '\''
+ *   quote_open("# it's")   - 0
+ *
+ * Return: The quote left open, or 0 when every quote is closed
+ */
+char quote_open(char *input)
+{
+	char open = '\0';
+	int len;
+
+	while (*input && !open)
+	{
+		while (*input == ' ' || *input == '\t')
+			input++;
+		if (*input == '#')
+			while (*input && *input != '\n')
+				input++;
+		if (!*input)
+			break;
+		input += io_number(input);
+		len = *input == '\n' ? 1 : operator_length(input);
+		if (len)
+			input += len;
+		else
+			input = skip_word(input, &open);
+	}
+	return (open);
+}
+
+/**
+ * tokens_append - Join the tokens of a continuation line to a command
+ * @tokens: Tokens read so far, freed by this call
+ * @more: Tokens of the next line, freed by this call
+ *
+ * A "\n" segment is put between the two, as if they were a single input.
+ *
+ * Return: The joined tokens, or NULL on failure
+ */
+char ***tokens_append(char ***tokens, char ***more)
+{
+	char ***joined;
+	int n = 0, m = 0, i;
+
+	while (tokens[n])
+		n++;
+	while (more[m])
+		m++;
+	joined = token_alloc(sizeof(char **) * (n + m + 2));
+	if (!joined || !handle_operator(joined, n, "\n", 1, NULL))
+	{
+		free(joined);
+		free_tokens(tokens);
+		free_tokens(more);
+		return (NULL);
+	}
+	for (i = 0; i < n; i++)
+		joined[i] = tokens[i];
+	for (i = 0; i <= m; i++)
+		joined[n + 1 + i] = more[i];
+	free(tokens);
+	free(more);
+	return (joined);
+}
@@ -0,0 +1,417 @@
+#include "hsh.h"
+
+#define VAR_BUCKETS 256
+
+/**
+ * struct var_s - Shell variable that is not in the environment
+ * @sym: Interned name of the variable
+ * @value: Value of the variable
+ * @next: Next variable in the same bucket
+ */
+typedef struct var_s
+{
+	int				sym;
+	char			*value;
+	struct var_s	*next;
+} var_t;
+
+/**
+ * struct saved_var_s - Value a local variable hides until its scope ends
+ * @name: Name of the variable
+ * @value: Previous value in the shell table, NULL if it had none
+ * @env: Previous value in the environment, NULL if it had none
+ * @exported: Set when the environment is to be restored too
+ * @next: Next saved variable of the same scope
+ */
+typedef struct saved_var_s
+{
+	char				*name;
+	char				*value;
+	char				*env;
+	int					exported;
+	struct saved_var_s	*next;
+} saved_var_t;
+
+/**
+ * struct var_scope_s - Local variables of a running function
+ * @saved: Values to restore when the scope ends, most recent first
+ * @prefix: Set for the assignments written before a built-in or function,
+ * which local does not add to
+ * @up: Enclosing scope
+ */
+typedef struct var_scope_s
+{
+	saved_var_t			*saved;
+	int					prefix;
+	struct var_scope_s	*up;
+} var_scope_t;
+
+static var_t *var_table[VAR_BUCKETS];
+static var_scope_t *var_scope;
+
+/**
+ * var_find - Find a shell variable
+ * @name: Name of the variable, not necessarily null-terminated
+ * @len: Length of the name
+ *
+ * The name is hashed once, by the intern table; variables of the bucket
+ * are then told apart by their ids.
+ *
+ * Return: The variable, or NULL if it is not set
+ */
+static var_t *var_find(const char *name, size_t len)
+{
+	int sym = intern_find(name, len);
+	var_t *v;
+
+	if (sym == -1)
+		return (NULL);
+	for (v = var_table[intern_hash_of(sym) % VAR_BUCKETS]; v; v = v->next)
+		if (v->sym == sym)
+			return (v);
+	return (NULL);
+}
+
+/**
+ * var_name_length - Length of the variable name starting a string
+ * @s: The string
+ *
+ * Example:
+ *   var_name_length("HOME/bin")   - 4
+ *   var_name_length("1abc")       - 0
+ *
+ * Return: Length of the longest valid name, 0 if there is none
+ */
+size_t var_name_length(const char *s)
+{
+	size_t i = 0;
+
+	if (!((s[0] >= 'a' && s[0] <= 'z') || (s[0] >= 'A' && s[0] <= 'Z') ||
+		s[0] == '_'))
+		return (0);
+	for (i = 1; (s[i] >= 'a' && s[i] <= 'z') || (s[i] >= 'A' && s[i] <= 'Z') ||
+		(s[i] >= '0' && s[i] <= '9') || s[i] == '_'; i++)
+		;
+	return (i);
+}
+
+/**
+ * var_lookup - Get the value of a variable from its name
+ * @name: Name of the variable, not necessarily null-terminated
+ * @len: Length of the name
+ *
+ * Shell variables are looked up first, then the environment.
+ *
+ * Return: The value, or NULL if the variable is not set
+ */
+const char *var_lookup(const char *name, size_t len)
+{
+	var_t *v = var_find(name, len);
+	char **env;
+
+	if (v)
+		return (v->value);
+	for (env = environ; *env; env++)
+		if (_strncmp(*env, name, len) == 0 && (*env)[len] == '=')
+			return (*env + len + 1);
+	return (NULL);
+}
+
+/**
+ * var_get - Get the value of a variable
+ * @name: Name of the variable
+ *
+ * Return: The value, or NULL if the variable is not set
+ */
+const char *var_get(const char *name)
+{
+	return (var_lookup(name, _strlen(name)));
+}
+
+/**
+ * var_store - Set a variable in the shell table
+ * @name: Name of the variable
+ * @value: New value
+ *
+ * Return: 0 on success, -1 on failure
+ */
+static int var_store(const char *name, const char *value)
+{
+	size_t len = _strlen(name);
+	var_t *v = var_find(name, len);
+	unsigned int h;
+	char *dup;
+	int sym;
+
+	dup = _strdup((char *)value);
+	if (!dup)
+		return (-1);
+	if (v)
+	{
+		free(v->value);
+		v->value = dup;
+		return (0);
+	}
+
+	sym = intern(name, len);
+	v = sym == -1 ? NULL : malloc(sizeof(var_t));
+	if (!v)
+	{
+		free(dup);
+		return (-1);
+	}
+	v->sym = sym;
+	v->value = dup;
+	h = intern_hash_of(sym) % VAR_BUCKETS;
+	v->next = var_table[h];
+	var_table[h] = v;
+	return (0);
+}
+
+/**
+ * var_set - Set a variable
+ * @name: Name of the variable
+ * @value: New value
+ *
+ * A variable already in the environment stays there and is updated in
+ * place; any other variable is kept by the shell and not exported.
+ *
+ * Example:
+ *   var_set("i", "3");      - $i expands to 3, children do not see it
+ *   var_set("PATH", "/bin") - Updates the environment
+ *
+ * Return: 0 on success, -1 on failure
+ */
+int var_set(const char *name, const char *value)
+{
+	if (!var_find(name, _strlen(name)) && _getenv(name))
+		return (_setenv(name, value));
+	return (var_store(name, value));
+}
+
+/**
+ * var_assign - Set a variable from a "name=value" word
+ * @word: The word
+ *
+ * Return: 0 on success, -1 if the word is not an assignment or on failure
+ */
+int var_assign(const char *word)
+{
+	size_t len = var_name_length(word);
+	char name[256];
+
+	if (!len || word[len] != '=' || len >= sizeof(name))
+		return (-1);
+	memcpy(name, word, len);
+	name[len] = '\0';
+	return (var_set(name, word + len + 1));
+}
+
+/**
+ * var_unset - Remove a shell variable
+ * @name: Name of the variable
+ */
+void var_unset(const char *name)
+{
+	int sym = intern_find(name, _strlen(name));
+	var_t **link, *v;
+
+	if (sym == -1)
+		return;
+	link = &var_table[intern_hash_of(sym) % VAR_BUCKETS];
+	for (; *link; link = &(*link)->next)
+	{
+		v = *link;
+		if (v->sym == sym)
+		{
+			*link = v->next;
+			free(v->value);
+			free(v);
+			return;
+		}
+	}
+}
+
+/**
+ * var_scope_push - Start a scope for local variables
+ *
+ * Return: 0 on success, -1 on failure
+ */
+int var_scope_push(void)
+{
+	var_scope_t *scope = malloc(sizeof(var_scope_t));
+
+	if (!scope)
+		return (-1);
+	scope->saved = NULL;
+	scope->prefix = 0;
+	scope->up = var_scope;
+	var_scope = scope;
+	return (0);
+}
+
+/**
+ * var_scope_pop - End the innermost scope, restoring what its locals hid
+ */
+void var_scope_pop(void)
+{
+	var_scope_t *scope = var_scope;
+	saved_var_t *sv, *next;
+
+	if (!scope)
+		return;
+	for (sv = scope->saved; sv; sv = next)
+	{
+		next = sv->next;
+		if (sv->value)
+			var_store(sv->name, sv->value);
+		else
+			var_unset(sv->name);
+		if (sv->exported && sv->env)
+			_setenv(sv->name, sv->env);
+		else if (sv->exported)
+			_unsetenv(sv->name);
+		free(sv->name);
+		free(sv->value);
+		free(sv->env);
+		free(sv);
+	}
+	var_scope = scope->up;
+	free(scope);
+}
+
+/**
+ * var_save - Remember the value of a variable until a scope ends
+ * @scope: The scope
+ * @name: Name of the variable
+ *
+ * A variable is saved once per scope, with the value it had first.
+ *
+ * Return: The saved variable, or NULL on failure
+ */
+static saved_var_t *var_save(var_scope_t *scope, const char *name)
+{
+	saved_var_t *sv;
+	var_t *v;
+
+	for (sv = scope->saved; sv; sv = sv->next)
+		if (_strcmp(sv->name, name) == 0)
+			return (sv);
+	sv = malloc(sizeof(saved_var_t));
+	if (!sv || !(sv->name = _strdup((char *)name)))
+	{
+		free(sv);
+		return (NULL);
+	}
+	v = var_find(name, _strlen(name));
+	sv->value = v ? _strdup(v->value) : NULL;
+	sv->env = NULL;
+	sv->exported = 0;
+	sv->next = scope->saved;
+	scope->saved = sv;
+	return (sv);
+}
+
+/**
+ * var_local - Make a variable local to the innermost scope
+ * @word: "name" or "name=value"
+ *
+ * The variable lives in the shell table until the scope ends, hiding any
+ * variable of the same name, even one from the environment; the
+ * environment itself is never modified. Without a value, the variable
+ * keeps the value it had.
+ *
+ * Example:
+ *   var_local("i=0") - In a function, i is 0 until the function returns
+ *
+ * Return: 0 on success, -1 on an invalid name or failure, -2 when no
+ * scope is open
+ */
+int var_local(const char *word)
+{
+	size_t len = var_name_length(word);
+	var_scope_t *scope = var_scope;
+	const char *value;
+	char name[256];
+
+	while (scope && scope->prefix)
+		scope = scope->up;
+	if (!scope)
+		return (-2);
+	if (!len || (word[len] != '=' && word[len]) || len >= sizeof(name))
+		return (-1);
+	memcpy(name, word, len);
+	name[len] = '\0';
+	value = word[len] == '=' ? word + len + 1 : var_get(name);
+	if (!var_save(scope, name))
+		return (-1);
+	return (value ? var_store(name, value) : 0);
+}
+
+/**
+ * var_prefix_push - Apply the assignments written before a built-in or
+ * function run in the shell
+ * @words: The assignments
+ * @n: Number of assignments
+ *
+ * The variables are set and exported, as they would be for a program,
+ * until var_scope_pop ends the scope this opens.
+ *
+ * Example:
+ *   "IFS= read -r line"   - IFS is empty while read runs, line stays set
+ *
+ * Return: 0 on success, -1 on failure, with no scope left open
+ */
+int var_prefix_push(char **words, int n)
+{
+	size_t len;
+	saved_var_t *sv;
+	char name[256], *env;
+	int i;
+
+	if (var_scope_push() == -1)
+		return (-1);
+	var_scope->prefix = 1;
+	for (i = 0; i < n; i++)
+	{
+		len = var_name_length(words[i]);
+		if (!len || words[i][len] != '=' || len >= sizeof(name))
+			continue;
+		memcpy(name, words[i], len);
+		name[len] = '\0';
+		sv = var_save(var_scope, name);
+		if (sv && !sv->exported)
+		{
+			env = _getenv(name);
+			sv->env = env ? _strdup(env) : NULL;
+			sv->exported = !env || sv->env;
+		}
+		if (!sv || !sv->exported || var_store(name, words[i] + len + 1) == -1 ||
+			_setenv(name, words[i] + len + 1) == -1)
+		{
+			var_scope_pop();
+			return (-1);
+		}
+	}
+	return (0);
+}
+
+/**
+ * var_free_all - Free every shell variable
+ */
+void var_free_all(void)
+{
+	var_t *v, *next;
+	int i;
+
+	for (i = 0; i < VAR_BUCKETS; i++)
+	{
+		for (v = var_table[i]; v; v = next)
+		{
+			next = v->next;
+			free(v->value);
+			free(v);
+		}
+		var_table[i] = NULL;
+	}
+}